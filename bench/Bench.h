@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+
+namespace gv {
+namespace bench {
+
+
+/*!
+ * \brief Measure duration of a single run of a function.
+ *
+ * The function is repeated for at least the given time in a few rounds,
+ * the best round is taken to filter out noise of other processes.
+ * \param[in] fn Function to measure.
+ * \param[in] seconds Minimal duration of a round.
+ * \return Seconds per run of the function.
+ */
+template<class Fn>
+double measure( Fn&& fn, double seconds = 0.2 )
+{
+    using Clock = std::chrono::steady_clock;
+    const int rounds = 5;
+    double best = 1.0e300;
+
+    fn();
+
+    for ( int r = 0; r < rounds; ++r )
+    {
+        long runs = 0;
+        const auto start = Clock::now();
+        double elapsed = 0.0;
+
+        do
+        {
+            fn();
+            ++runs;
+            elapsed = std::chrono::duration<double>( Clock::now() - start ).count();
+        }
+        while ( elapsed < seconds / rounds );
+
+        best = std::min( best, elapsed / runs );
+    }
+
+    return best;
+}
+
+
+//! Print one line of results: name, time per run and items per second.
+inline void report( const char* name, double perRun, double items, const char* unit )
+{
+    std::printf( "%-52s %12.3f us %14.0f %s/s\n", name, perRun * 1.0e6, items / perRun, unit );
+}
+
+
+}
+}
@@ -0,0 +1,73 @@
+#include <cstdio>
+
+#include "Allocations.h"
+#include "Bench.h"
+#include "MapHarness.h"
+
+
+/*
+ * Time and heap allocations of a map regeneration, which builds the map
+ * geometry out of tile meshes, for the whole Globe (zoom level 3, the limb
+ * is in the view) and for views of zoom levels 6, 10 and 14 centered at
+ * the projection center, projected on the CPU and on the GPU.
+ *
+ * Rotating moves the projection center by a tiny step every time, so every
+ * tile mesh is tessellated again, as every regeneration did before meshes
+ * were cached. Panning keeps the projection center and the tiles, so meshes
+ * are taken from the cache.
+ */
+
+
+namespace {
+
+
+//! Run a regeneration repeatedly, print time and allocations per run.
+template<class Fn>
+void report( const char* name, Fn&& regenerate )
+{
+    const double perRun = gv::bench::measure( regenerate );
+
+    const int runs = 20;
+    const long before = gv::test::Allocations::count();
+
+    for ( int i = 0; i < runs; ++i )
+    {
+        regenerate();
+    }
+
+    const double allocations = static_cast<double>( gv::test::Allocations::count() - before ) / runs;
+    std::printf( "%-12s %14.1f %14.1f\n", name, perRun * 1.0e6, allocations );
+}
+
+
+}
+
+
+int main()
+{
+    for ( bool gpu : { false, true } )
+    {
+        for ( int z : { 3, 6, 10, 14 } )
+        {
+            std::printf( "%s projection, zoom level %d\n%-12s %14s %14s\n",
+                gpu ? "GPU" : "CPU", z, "", "time, us", "allocations" );
+
+            gv::test::MapHarness harness( gpu, z );
+            double lon = 20.0;
+            int step = 0;
+
+            report( "rotating", [&]()
+                {
+                    lon += 1.0e-5;
+                    harness.rotate( lon, 40.0 );
+                } );
+
+            report( "panning", [&]()
+                {
+                    harness.pan( ++step % 2 ? 4 : -4, 0 );
+                } );
+        }
+    }
+
+    return 0;
+}
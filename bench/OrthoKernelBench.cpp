@@ -0,0 +1,132 @@
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <proj.h>
+
+#include "Bench.h"
+#include "OrthoKernel.h"
+
+
+/*
+ * Points per second of native orthographic kernels for every supported
+ * instruction set compared to PROJ transforming the same arrays.
+ */
+
+
+namespace {
+
+
+using gv::OrthoKernel;
+
+
+const double semiMajor = 6378137.0;
+const std::size_t side = 64;
+const std::size_t count = side * side;
+
+
+const char* setName( OrthoKernel::InstructionSet set )
+{
+    switch ( set )
+    {
+    case OrthoKernel::InstructionSet::Scalar:
+        return "Scalar";
+    case OrthoKernel::InstructionSet::SSE2:
+        return "SSE2";
+    case OrthoKernel::InstructionSet::AVX2:
+        return "AVX2";
+    case OrthoKernel::InstructionSet::NEON:
+        return "NEON";
+    }
+
+    return "unknown";
+}
+
+
+}
+
+
+int main()
+{
+    const double lon0 = 30.0;
+    const double lat0 = 45.0;
+
+    // Visible half of the Globe and a square covering its projection
+    std::vector<double> lon( count ), lat( count ), x( count ), y( count );
+
+    for ( std::size_t j = 0; j < side; ++j )
+    {
+        for ( std::size_t i = 0; i < side; ++i )
+        {
+            lon[j * side + i] = lon0 - 85.0 + 170.0 * i / ( side - 1 );
+            lat[j * side + i] = -85.0 + 170.0 * j / ( side - 1 );
+            x[j * side + i] = semiMajor * ( -1.0 + 2.0 * i / ( side - 1 ) );
+            y[j * side + i] = semiMajor * ( -1.0 + 2.0 * j / ( side - 1 ) );
+        }
+    }
+
+    std::vector<double> outA( count ), outB( count );
+    const auto best = OrthoKernel::best();
+
+    for ( auto shape : { OrthoKernel::Shape::Sphere, OrthoKernel::Shape::Ellipsoid } )
+    {
+        const std::string shapeName = shape == OrthoKernel::Shape::Sphere ? "sphere" : "ellipsoid";
+        const OrthoKernel kernel( lon0, lat0, shape );
+
+        for ( auto set : { OrthoKernel::InstructionSet::Scalar, OrthoKernel::InstructionSet::SSE2,
+            OrthoKernel::InstructionSet::AVX2, OrthoKernel::InstructionSet::NEON } )
+        {
+            if ( !OrthoKernel::select( set ) )
+            {
+                continue;
+            }
+
+            const std::string name = std::string( setName( set ) ) + " " + shapeName;
+            gv::bench::report( ( name + " forward" ).c_str(),
+                gv::bench::measure( [&]() { kernel.forward( lon.data(), lat.data(), outA.data(), outB.data(), count ); } ),
+                count, "points" );
+            gv::bench::report( ( name + " inverse" ).c_str(),
+                gv::bench::measure( [&]() { kernel.inverse( x.data(), y.data(), outA.data(), outB.data(), count ); } ),
+                count, "points" );
+            gv::bench::report( ( name + " inverse to Mercator" ).c_str(),
+                gv::bench::measure( [&]() { kernel.inverseMercator( x.data(), y.data(), outA.data(), outB.data(), count ); } ),
+                count, "points" );
+        }
+
+        PJ_CONTEXT* ctx = proj_context_create();
+        const std::string def = "+proj=ortho " + std::string( shape == OrthoKernel::Shape::Sphere ? "+R=6378137" : "+ellps=WGS84" )
+            + " +lon_0=30 +lat_0=45";
+        PJ* pj = proj_create( ctx, def.c_str() );
+
+        if ( pj )
+        {
+            const auto transform = [&]( PJ_DIRECTION dir, const std::vector<double>& u, const std::vector<double>& v )
+            {
+                outA = u;
+                outB = v;
+                proj_trans_generic( pj, dir, outA.data(), sizeof( double ), count, outB.data(), sizeof( double ), count,
+                    nullptr, 0, 0, nullptr, 0, 0 );
+            };
+
+            std::vector<double> lam( count ), phi( count );
+
+            for ( std::size_t i = 0; i < count; ++i )
+            {
+                lam[i] = proj_torad( lon[i] );
+                phi[i] = proj_torad( lat[i] );
+            }
+
+            gv::bench::report( ( "PROJ " + shapeName + " forward" ).c_str(),
+                gv::bench::measure( [&]() { transform( PJ_FWD, lam, phi ); } ), count, "points" );
+            gv::bench::report( ( "PROJ " + shapeName + " inverse" ).c_str(),
+                gv::bench::measure( [&]() { transform( PJ_INV, x, y ); } ), count, "points" );
+            proj_destroy( pj );
+        }
+
+        proj_context_destroy( ctx );
+    }
+
+    OrthoKernel::select( best );
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "Projection.h"
+#include "Projector.h"
+
+
+/*
+ * Throughput of Projection: projecting arrays of points in one call
+ * compared to calling per point API for every point, both through PROJ
+ * and through the closed form used when it agrees with PROJ.
+ *
+ * Latency of rotation: publishing a new projection center and projecting
+ * the first point with it, as dragging the Globe does.
+ */
+
+
+namespace {
+
+
+using gv::Projection;
+
+
+const double semiMajor = 6378137.0;
+const std::size_t side = 64;
+const std::size_t count = side * side;
+
+
+const char* formName( Projection::ClosedForm form )
+{
+    switch ( form )
+    {
+    case Projection::ClosedForm::None:
+        return "PROJ";
+    case Projection::ClosedForm::Sphere:
+        return "sphere";
+    case Projection::ClosedForm::Ellipsoid:
+        return "ellipsoid";
+    }
+
+    return "unknown";
+}
+
+
+//! Compare per point and array projection of the same points.
+void batchVersusPerPoint()
+{
+    const double lon0 = 30.0;
+    const double lat0 = 45.0;
+
+    std::vector<double> lon( count ), lat( count ), x( count ), y( count );
+
+    for ( std::size_t j = 0; j < side; ++j )
+    {
+        for ( std::size_t i = 0; i < side; ++i )
+        {
+            lon[j * side + i] = lon0 - 85.0 + 170.0 * i / ( side - 1 );
+            lat[j * side + i] = -85.0 + 170.0 * j / ( side - 1 );
+            x[j * side + i] = semiMajor * ( -1.0 + 2.0 * i / ( side - 1 ) );
+            y[j * side + i] = semiMajor * ( -1.0 + 2.0 * j / ( side - 1 ) );
+        }
+    }
+
+    std::vector<double> outA( count ), outB( count );
+
+    for ( auto form : { Projection::ClosedForm::None, Projection::ClosedForm::Sphere, Projection::ClosedForm::Ellipsoid } )
+    {
+        const Projection projection( lon0, lat0, form );
+
+        if ( form != Projection::ClosedForm::None && !projection.validateClosedForm() )
+        {
+            continue;
+        }
+
+        const std::string name = formName( form );
+
+        gv::bench::report( ( name + " forward per point" ).c_str(), gv::bench::measure( [&]()
+            {
+                for ( std::size_t i = 0; i < count; ++i )
+                {
+                    projection.projectFwd( lon[i], lat[i], outA[i], outB[i] );
+                }
+            } ), count, "points" );
+
+        gv::bench::report( ( name + " forward array" ).c_str(), gv::bench::measure( [&]()
+            {
+                projection.projectFwd( lon.data(), lat.data(), outA.data(), outB.data(), count );
+            } ), count, "points" );
+
+        gv::bench::report( ( name + " inverse per point" ).c_str(), gv::bench::measure( [&]()
+            {
+                for ( std::size_t i = 0; i < count; ++i )
+                {
+                    projection.projectInv( x[i], y[i], outA[i], outB[i] );
+                }
+            } ), count, "points" );
+
+        gv::bench::report( ( name + " inverse array" ).c_str(), gv::bench::measure( [&]()
+            {
+                projection.projectInv( x.data(), y.data(), outA.data(), outB.data(), count );
+            } ), count, "points" );
+    }
+}
+
+
+//! Measure rotation to a new center (moving by a drag step) or back to one of two centers.
+void rotation()
+{
+    const double step = 0.01;
+    int turn = 0;
+
+    const auto center = [&]( bool backAndForth )
+    {
+        ++turn;
+        return backAndForth ? ( turn % 2 ) * step : std::fmod( turn * step, 360.0 ) - 180.0;
+    };
+
+    gv::Projector projector;
+    gv::bench::report( "Projector::setProjectionAt", gv::bench::measure( [&]()
+        {
+            projector.setProjectionAt( center( false ), 45.0 );
+        } ), 1, "rotations" );
+
+    // Readers take the projection for every computation, the center stays the same
+    gv::bench::report( "Projector::projection", gv::bench::measure( [&]()
+        {
+            projector.projection();
+        } ), 1, "reads" );
+
+    for ( auto form : { Projection::ClosedForm::None, Projection::ClosedForm::Ellipsoid } )
+    {
+        for ( bool backAndForth : { false, true } )
+        {
+            const std::string name = std::string( "rotation and first point, " ) + formName( form )
+                + ( backAndForth ? ", back and forth" : ", new center" );
+            double x, y;
+
+            gv::bench::report( name.c_str(), gv::bench::measure( [&]()
+                {
+                    const Projection projection( center( backAndForth ), 45.0, form );
+                    projection.projectFwd( 10.0, 40.0, x, y );
+                } ), 1, "rotations" );
+        }
+    }
+}
+
+
+}
+
+
+int main()
+{
+    batchVersusPerPoint();
+    rotation();
+
+    return 0;
+}
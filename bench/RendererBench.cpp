@@ -0,0 +1,318 @@
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Bench.h"
+#include "Defines.h"
+#include "HeadlessContext.h"
+#include "Projection.h"
+#include "Projector.h"
+#include "Renderer.h"
+
+
+/*
+ * Time of rendering a frame of 1024x1024 pixels on the headless context:
+ * Renderer::render alone, which submits the draw list and waits only when
+ * the driver queue is full, and followed by glFinish, which includes drawing
+ * every frame. The graticule and the map are either projected on the CPU
+ * or longitudes and latitudes projected on the GPU.
+ *
+ * The graticule has lines every 10 degrees made of 1 degree segments,
+ * the map is a grid of 64x64 quads textured with an image of 8x4 tiles,
+ * both covering the part of the Globe around the projection center.
+ * Shaders are read from the directory the benchmark is built in.
+ */
+
+
+namespace {
+
+
+using gv::Projection;
+using gv::Renderer;
+
+
+const int viewSide = 1024;          //!< Width and height of the view (in pixels).
+const float unitInMeter = 0.001f;   //!< GL units in one meter.
+const double centerLon = 20.0;      //!< Longitude of the projection center.
+const double centerLat = 40.0;      //!< Latitude of the projection center.
+const int mapQuads = 64;            //!< Quads along a side of the map grid.
+
+
+//! Buffers of a model drawn with indices.
+struct Model
+{
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+    GLsizei num = 0;
+};
+
+
+/*!
+ * \param[in] lon, lat Point (in degrees).
+ * \param[in] geographic True - keep longitude and latitude (in radians), false - project.
+ * \param[out] x, y Vertex coordinates.
+ * \return False if the point is projected and on the far side of the Globe.
+ */
+bool vertex( const Projection& projection, double lon, double lat, bool geographic, GLfloat& x, GLfloat& y )
+{
+    if ( geographic )
+    {
+        x = static_cast<GLfloat>( lon * defs::degToRad );
+        y = static_cast<GLfloat>( lat * defs::degToRad );
+        return true;
+    }
+
+    double px;
+    double py;
+
+    if ( !projection.projectFwd( lon, lat, px, py ) )
+    {
+        return false;
+    }
+
+    x = static_cast<GLfloat>( px * unitInMeter );
+    y = static_cast<GLfloat>( py * unitInMeter );
+    return true;
+}
+
+
+//! Upload vertices of the given number of components and indices into a new vertex array object.
+template<class Index>
+Model upload( const std::vector<GLfloat>& vertices, int components, const std::vector<Index>& indices )
+{
+    Model model;
+    glGenVertexArrays( 1, &model.vao );
+    glGenBuffers( 1, &model.vbo );
+    glGenBuffers( 1, &model.ebo );
+    glBindVertexArray( model.vao );
+    glBindBuffer( GL_ARRAY_BUFFER, model.vbo );
+    glBufferData( GL_ARRAY_BUFFER, vertices.size() * sizeof( GLfloat ), vertices.data(), GL_STATIC_DRAW );
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, model.ebo );
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof( Index ), indices.data(), GL_STATIC_DRAW );
+
+    const GLsizei stride = components * sizeof( GLfloat );
+    glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, stride, ( void* ) 0 );
+    glEnableVertexAttribArray( 0 );
+
+    if ( components == 4 )
+    {
+        glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, stride, ( void* ) ( 2 * sizeof( GLfloat ) ) );
+        glEnableVertexAttribArray( 1 );
+    }
+
+    glBindVertexArray( 0 );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    model.num = static_cast<GLsizei>( indices.size() );
+    return model;
+}
+
+
+//! Circles of latitude and meridians, segments with an end on the far side are left out.
+Model graticule( const Projection& projection, bool geographic )
+{
+    std::vector<GLfloat> vertices;
+    std::vector<GLushort> indices;
+
+    const auto line = [&]( bool meridian, int fixed, int from, int to )
+    {
+        bool previous = false;
+
+        for ( int i = from; i <= to; ++i )
+        {
+            GLfloat x;
+            GLfloat y;
+            const bool visible = meridian
+                ? vertex( projection, fixed, i, geographic, x, y )
+                : vertex( projection, i, fixed, geographic, x, y );
+
+            if ( visible )
+            {
+                if ( previous )
+                {
+                    const GLushort next = static_cast<GLushort>( vertices.size() / 2 );
+                    indices.push_back( next - 1 );
+                    indices.push_back( next );
+                }
+
+                vertices.push_back( x );
+                vertices.push_back( y );
+            }
+
+            previous = visible;
+        }
+    };
+
+    for ( int lon = -180; lon < 180; lon += 10 )
+    {
+        line( true, lon, -80, 80 );
+    }
+
+    for ( int lat = -80; lat <= 80; lat += 10 )
+    {
+        line( false, lat, -180, 180 );
+    }
+
+    return upload( vertices, 2, indices );
+}
+
+
+//! Textured grid around the projection center, quads with a corner on the far side are left out.
+Model map( const Projection& projection, bool geographic )
+{
+    const double lon0 = centerLon - 80.0;
+    const double lon1 = centerLon + 80.0;
+    const double lat0 = centerLat - 70.0;
+    const double lat1 = centerLat + 45.0;
+    const int side = mapQuads + 1;
+
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+    std::vector<GLuint> index( side * side, 0 );
+    std::vector<bool> visible( side * side, false );
+
+    for ( int j = 0; j < side; ++j )
+    {
+        for ( int i = 0; i < side; ++i )
+        {
+            const double s = double( i ) / mapQuads;
+            const double t = double( j ) / mapQuads;
+            GLfloat x;
+            GLfloat y;
+
+            if ( vertex( projection, lon0 + s * ( lon1 - lon0 ), lat0 + t * ( lat1 - lat0 ), geographic, x, y ) )
+            {
+                index[j * side + i] = static_cast<GLuint>( vertices.size() / 4 );
+                visible[j * side + i] = true;
+                vertices.insert( vertices.end(), { x, y, static_cast<GLfloat>( s ), static_cast<GLfloat>( t ) } );
+            }
+        }
+    }
+
+    for ( int j = 0; j < mapQuads; ++j )
+    {
+        for ( int i = 0; i < mapQuads; ++i )
+        {
+            const int a = j * side + i;
+            const int corners[4] = { a, a + 1, a + side + 1, a + side };
+
+            if ( visible[corners[0]] && visible[corners[1]] && visible[corners[2]] && visible[corners[3]] )
+            {
+                for ( int k : { 0, 1, 2, 0, 2, 3 } )
+                {
+                    indices.push_back( index[corners[k]] );
+                }
+            }
+        }
+    }
+
+    return upload( vertices, 4, indices );
+}
+
+
+//! Gray texture of the map.
+GLuint texture()
+{
+    const int w = 8 * defs::tileSide;
+    const int h = 4 * defs::tileSide;
+    const std::vector<unsigned char> pixels( w * h * 3, 0x80 );
+
+    GLuint tex;
+    glGenTextures( 1, &tex );
+    glBindTexture( GL_TEXTURE_2D, tex );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data() );
+
+    return tex;
+}
+
+
+}
+
+
+int main()
+{
+    gv::support::HeadlessContext context;
+    context.makeCurrent();
+
+    if ( !gladLoadGLLoader( &gv::support::HeadlessContext::procAddress ) )
+    {
+        std::printf( "Cannot load OpenGL functions\n" );
+        return -1;
+    }
+
+    context.resize( viewSide, viewSide );
+    glViewport( 0, 0, viewSide, viewSide );
+
+    auto projector = std::make_shared<gv::Projector>();
+    projector->setProjectionAt( centerLon, centerLat );
+    const auto projection = projector->projection();
+    const GLuint tex = texture();
+
+    std::unique_ptr<Renderer> renderer;
+
+    try
+    {
+        renderer.reset( new Renderer() );
+    }
+    catch ( const std::logic_error& e )
+    {
+        std::printf( "%s\n", e.what() );
+        return -1;
+    }
+
+    renderer->getProjector.connect( [&]() { return projector; } );
+    renderer->getUnitInMeter.connect( []() { return unitInMeter; } );
+
+    const float half = static_cast<float>( defs::earthRadius * unitInMeter * 1.1 );
+    renderer->updateProjection( glm::ortho( -half, half, -half, half, -1.0f, 1.0f ) );
+
+    std::printf( "%-36s %14s %14s\n", "", "render, us", "finished, us" );
+
+    for ( bool geographic : { false, true } )
+    {
+        const Model wires = graticule( *projection, geographic );
+        const Model tiles = map( *projection, geographic );
+
+        renderer->updateWireGlobe( wires.vao, wires.num, geographic );
+        renderer->updateMapTiles( tiles.vao, tex, tiles.num, GL_UNSIGNED_INT, geographic );
+
+        for ( bool withMap : { false, true } )
+        {
+            renderer->setMapReady( withMap );
+
+            const double submitted = gv::bench::measure( [&]() { renderer->render(); } );
+            glFinish();
+            const double finished = gv::bench::measure( [&]()
+                {
+                    renderer->render();
+                    glFinish();
+                } );
+
+            char name[64];
+            std::snprintf( name, sizeof( name ), "%s, %s", geographic ? "GPU projection" : "CPU projection",
+                withMap ? "wires and map" : "wires" );
+            std::printf( "%-36s %14.1f %14.1f\n", name, submitted * 1.0e6, finished * 1.0e6 );
+        }
+
+        for ( const Model& model : { wires, tiles } )
+        {
+            glDeleteVertexArrays( 1, &model.vao );
+            glDeleteBuffers( 1, &model.vbo );
+            glDeleteBuffers( 1, &model.ebo );
+        }
+    }
+
+    renderer.reset();
+    glDeleteTextures( 1, &tex );
+
+    return 0;
+}
@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Defines.h"
+#include "MapHarness.h"
+#include "Projection.h"
+#include "TileSelector.h"
+
+
+/*
+ * Vertices per tile and the largest on-screen deviation of the map from
+ * the exact projection, for the uniform 10x10 grid tiles were split into
+ * before and for the adaptive quadtree MapGenerator builds now. Views show
+ * the Globe around the projection center at several zoom levels and its limb.
+ *
+ * Deviation is sampled inside every triangle: a point interpolated between
+ * triangle corners shows the texel of interpolated texture coordinates,
+ * its exact place is the projection of that texel's longitude and latitude.
+ * Tile images are Mercator, so texture coordinates of the grid, which were
+ * linear in latitude, are deviations too. Points on the far side of the Globe
+ * are left out. Vertices of the grid weren't shared by triangles, vertices of
+ * the adaptive mesh are indexed.
+ */
+
+
+namespace {
+
+
+using gv::Projection;
+using gv::TileSelector;
+
+
+const int gridChunks = 10;      //!< Chunks along a side of a tile in the uniform grid.
+const int samples = 8;          //!< Sample steps along a side of a triangle.
+
+
+//! Deviation and size of meshes of all tiles in a view.
+struct Quality
+{
+    std::size_t vertices = 0;
+    double maxError = 0.0;
+};
+
+
+//! Tile as it's laid out in the texture.
+struct Tile
+{
+    double lon0;
+    double lon1;
+    double mer0;
+    double mer1;
+};
+
+
+double latToMercator( double lat )
+{
+    return std::log( std::tan( 0.25 * defs::pi + 0.5 * lat * defs::degToRad ) );
+}
+
+
+double mercatorToLat( double mer )
+{
+    return std::atan( std::sinh( mer ) ) * defs::radToDeg;
+}
+
+
+Tile tileOf( const gv::TileHead& head )
+{
+    return {
+        TileSelector::tileXToLon( head.x, head.z ),
+        TileSelector::tileXToLon( head.x + 1, head.z ),
+        latToMercator( TileSelector::tileYToLat( head.y + 1, head.z ) ),
+        latToMercator( TileSelector::tileYToLat( head.y, head.z ) )
+    };
+}
+
+
+/*!
+ * \param[in] x, y Corners of the triangle (in pixels).
+ * \param[in] u, v Texture coordinates of the corners relative to the tile.
+ * \return The largest distance (in pixels) of the triangle from the exact projection.
+ */
+double triangleError( const Projection& projection, const Tile& tile, double pixelInMeter,
+    const double* x, const double* y, const double* u, const double* v )
+{
+    double res = 0.0;
+
+    for ( int i = 0; i <= samples; ++i )
+    {
+        for ( int j = 0; i + j <= samples; ++j )
+        {
+            const double a = double( i ) / samples;
+            const double b = double( j ) / samples;
+            const double c = 1.0 - a - b;
+            const double su = a * u[0] + b * u[1] + c * u[2];
+            const double sv = a * v[0] + b * v[1] + c * v[2];
+            double ex;
+            double ey;
+
+            if ( !projection.projectFwd( tile.lon0 + su * ( tile.lon1 - tile.lon0 ),
+                mercatorToLat( tile.mer0 + sv * ( tile.mer1 - tile.mer0 ) ), ex, ey ) )
+            {
+                continue;
+            }
+
+            const double dx = a * x[0] + b * x[1] + c * x[2] - ex * pixelInMeter;
+            const double dy = a * y[0] + b * y[1] + c * y[2] - ey * pixelInMeter;
+            res = std::max( res, std::sqrt( dx * dx + dy * dy ) );
+        }
+    }
+
+    return res;
+}
+
+
+/*!
+ * Uniform grid the way tiles were split before: a chunk is two triangles,
+ * chunks with less than three visible corners are omitted, vertices aren't shared.
+ */
+void uniformGrid( const Projection& projection, const gv::TileHead& head, double pixelInMeter, Quality& quality )
+{
+    const Tile tile = tileOf( head );
+    const double lat0 = TileSelector::tileYToLat( head.y + 1, head.z );
+    const double lat1 = TileSelector::tileYToLat( head.y, head.z );
+
+    for ( int i = 0; i < gridChunks; ++i )
+    {
+        for ( int j = 0; j < gridChunks; ++j )
+        {
+            const double u[4] = { double( i ) / gridChunks, double( i + 1 ) / gridChunks,
+                double( i + 1 ) / gridChunks, double( i ) / gridChunks };
+            const double v[4] = { double( j ) / gridChunks, double( j ) / gridChunks,
+                double( j + 1 ) / gridChunks, double( j + 1 ) / gridChunks };
+            double x[4];
+            double y[4];
+            int ind[4];
+            int visible = 0;
+
+            for ( int n = 0; n < 4; ++n )
+            {
+                double px;
+                double py;
+
+                if ( projection.projectFwd( tile.lon0 + u[n] * ( tile.lon1 - tile.lon0 ), lat0 + v[n] * ( lat1 - lat0 ), px, py ) )
+                {
+                    x[n] = px * pixelInMeter;
+                    y[n] = py * pixelInMeter;
+                    ind[visible++] = n;
+                }
+            }
+
+            const int triangles[2][3] = { { ind[0], ind[1], ind[2] }, { ind[0], ind[2], ind[3] } };
+
+            for ( int t = 0; t < visible - 2; ++t )
+            {
+                double tx[3];
+                double ty[3];
+                double tu[3];
+                double tv[3];
+
+                for ( int k = 0; k < 3; ++k )
+                {
+                    const int n = triangles[t][k];
+                    tx[k] = x[n];
+                    ty[k] = y[n];
+                    tu[k] = u[n];
+                    tv[k] = v[n];
+                }
+
+                quality.vertices += 3;
+                quality.maxError = std::max( quality.maxError, triangleError( projection, tile, pixelInMeter, tx, ty, tu, tv ) );
+            }
+        }
+    }
+}
+
+
+/*!
+ * Measure the adaptive mesh of a map and the uniform grid of the same tiles.
+ * Vertices of the map are floats: x, y (in GL units) and texture coordinates.
+ */
+void compare( const char* name, gv::test::MapHarness& harness, const gv::MapFrame& frame )
+{
+    const auto& vd = harness.viewData();
+    const auto projection = harness.projector()->projection();
+    const auto& geometry = *frame.geometry();
+    const double pixelInMeter = 1.0 / vd.meterInPixel;
+    const double pixelInUnit = pixelInMeter / vd.unitInMeter;
+    const int cols = frame.width() / defs::tileSide;
+    const int rows = frame.height() / defs::tileSide;
+
+    std::vector<GLfloat> vertices( geometry.vertices.size() / sizeof( GLfloat ) );
+    std::memcpy( vertices.data(), geometry.vertices.data(), geometry.vertices.size() );
+    const std::size_t indexSize = gv::MapGeometry::indexSize( geometry.indexType );
+    std::vector<GLuint> indices( geometry.indices.size() / indexSize );
+
+    for ( std::size_t i = 0; i < indices.size(); ++i )
+    {
+        if ( indexSize == sizeof( GLushort ) )
+        {
+            GLushort index;
+            std::memcpy( &index, &geometry.indices[i * indexSize], indexSize );
+            indices[i] = index;
+        }
+        else
+        {
+            std::memcpy( &indices[i], &geometry.indices[i * indexSize], indexSize );
+        }
+    }
+
+    // Tile of a texture place is voted for by its triangles weighted by their texture area,
+    // as tiny triangles at the limb are far from the point they are inversely projected to
+    std::map<std::pair<int, int>, std::map<std::pair<int, int>, double>> votes;
+    std::map<std::pair<int, int>, gv::TileHead> places;
+
+    const auto place = [&]( std::size_t t, int& col, int& row, double* u, double* v )
+    {
+        double su = 0.0;
+        double sv = 0.0;
+
+        for ( int k = 0; k < 3; ++k )
+        {
+            su += vertices[indices[t + k] * 4 + 2] * cols / 3.0;
+            sv += vertices[indices[t + k] * 4 + 3] * rows / 3.0;
+        }
+
+        col = static_cast<int>( std::floor( su ) );
+        row = static_cast<int>( std::floor( sv ) );
+
+        for ( int k = 0; k < 3; ++k )
+        {
+            u[k] = vertices[indices[t + k] * 4 + 2] * cols - col;
+            v[k] = vertices[indices[t + k] * 4 + 3] * rows - row;
+        }
+    };
+
+    for ( std::size_t t = 0; t < indices.size(); t += 3 )
+    {
+        int col;
+        int row;
+        double u[3];
+        double v[3];
+        place( t, col, row, u, v );
+
+        double x = 0.0;
+        double y = 0.0;
+
+        for ( int k = 0; k < 3; ++k )
+        {
+            x += vertices[indices[t + k] * 4] / vd.unitInMeter / 3.0;
+            y += vertices[indices[t + k] * 4 + 1] / vd.unitInMeter / 3.0;
+        }
+
+        const double area = std::fabs( ( u[1] - u[0] ) * ( v[2] - v[0] ) - ( u[2] - u[0] ) * ( v[1] - v[0] ) );
+        double lon;
+        double lat;
+
+        if ( projection->projectInv( x, y, lon, lat ) )
+        {
+            votes[{ col, row }][{ TileSelector::lonToTileX( lon, vd.mapZoomLevel ), TileSelector::latToTileY( lat, vd.mapZoomLevel ) }] += area;
+        }
+    }
+
+    for ( const auto& vote : votes )
+    {
+        const auto best = std::max_element( vote.second.begin(), vote.second.end(),
+            []( const auto& a, const auto& b ) { return a.second < b.second; } );
+        places.emplace( vote.first, gv::TileHead( vd.mapZoomLevel, best->first.first, best->first.second ) );
+    }
+
+    Quality adaptive;
+    adaptive.vertices = vertices.size() / 4;
+
+    for ( std::size_t t = 0; t < indices.size(); t += 3 )
+    {
+        int col;
+        int row;
+        double u[3];
+        double v[3];
+        double x[3];
+        double y[3];
+        place( t, col, row, u, v );
+
+        for ( int k = 0; k < 3; ++k )
+        {
+            x[k] = vertices[indices[t + k] * 4] * pixelInUnit;
+            y[k] = vertices[indices[t + k] * 4 + 1] * pixelInUnit;
+        }
+
+        auto it = places.find( { col, row } );
+
+        if ( it != places.end() )
+        {
+            adaptive.maxError = std::max( adaptive.maxError,
+                triangleError( *projection, tileOf( it->second ), pixelInMeter, x, y, u, v ) );
+        }
+    }
+
+    Quality grid;
+
+    for ( const auto& p : places )
+    {
+        uniformGrid( *projection, p.second, pixelInMeter, grid );
+    }
+
+    const double tiles = std::max<double>( 1.0, static_cast<double>( places.size() ) );
+    std::printf( "%-16s %6zu %14.1f %14.1f %14.2f %14.2f\n", name, places.size(),
+        grid.vertices / tiles, adaptive.vertices / tiles, grid.maxError, adaptive.maxError );
+}
+
+
+}
+
+
+int main()
+{
+    struct View
+    {
+        const char* name;
+        int zoom;
+        bool limb;
+    };
+
+    const View views[] = {
+        { "z3 whole Globe", 3, false },
+        { "z6 center", 6, false },
+        { "z10 center", 10, false },
+        { "z14 center", 14, false },
+        { "z6 limb", 6, true },
+        { "z9 limb", 9, true }
+    };
+
+    std::printf( "%-16s %6s %14s %14s %14s %14s\n", "view", "tiles",
+        "grid vert", "adaptive vert", "grid err, px", "adaptive err" );
+
+    for ( const auto& view : views )
+    {
+        gv::test::MapHarness harness( false, view.zoom );
+        auto& generator = harness.generator();
+        gv::MapFrame frame;
+
+        generator.updateMapTexture.connect( [&]( const gv::MapFrame& f ) { frame = f.share(); }, boost::signals2::at_front );
+        harness.generate( [&]() { generator.updateTileLod( false ); } );
+        harness.generate( [&]() { generator.updatePackedVertices( false ); } );
+
+        if ( view.limb )
+        {
+            // Limb is 300 pixels right of the view center
+            const int radius = static_cast<int>( defs::earthRadius / harness.viewData().meterInPixel );
+            harness.pan( radius - 300, 0 );
+        }
+
+        compare( view.name, harness, frame );
+    }
+
+    return 0;
+}
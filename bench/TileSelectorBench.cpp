@@ -0,0 +1,75 @@
+#include <cmath>
+#include <cstdio>
+
+#include "Bench.h"
+#include "Defines.h"
+#include "Projector.h"
+#include "TileSelector.h"
+
+
+/*
+ * Time of selecting visible tiles for common screen sizes at every map
+ * zoom level from 3 to 18, with a single zoom level and with zoom level
+ * chosen per tile. The view is centered at the projection center,
+ * so the Globe fills the screen from zoom level 5 or so on.
+ */
+
+
+namespace {
+
+
+const float unitInMeter = 0.001f;
+
+
+//! View of a screen centered at projection center showing map zoom level z.
+gv::ViewData viewAt( int width, int height, int z )
+{
+    gv::ViewData vd;
+    vd.unitInMeter = unitInMeter;
+    vd.meterInPixel = static_cast<float>( defs::earthRadius * 4 / defs::tileSide / std::pow( 2.0, z ) );
+    vd.mapZoomLevel = z;
+    vd.pixWidth = width;
+    vd.pixHeight = height;
+    vd.glX0 = -width / 2 * vd.meterInPixel * unitInMeter;
+    vd.glX1 = width / 2 * vd.meterInPixel * unitInMeter;
+    vd.glY0 = -height / 2 * vd.meterInPixel * unitInMeter;
+    vd.glY1 = height / 2 * vd.meterInPixel * unitInMeter;
+    return vd;
+}
+
+
+}
+
+
+int main()
+{
+    const double lon0 = 30.0;
+    const double lat0 = 45.0;
+    const int sizes[][2] = { { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 } };
+
+    gv::Projector projector;
+    projector.setProjectionAt( lon0, lat0 );
+    const auto projection = projector.projection();
+    gv::TileSelector selector;
+
+    for ( const auto& size : sizes )
+    {
+        std::printf( "%dx%d\n%4s %14s %8s %14s %8s\n", size[0], size[1], "z", "select, us", "tiles", "selectLod, us", "tiles" );
+
+        for ( int z = 3; z <= 18; ++z )
+        {
+            const auto vd = viewAt( size[0], size[1], z );
+            const int x = gv::TileSelector::lonToTileX( lon0, z );
+            const int y = gv::TileSelector::latToTileY( lat0, z );
+
+            const double single = gv::bench::measure( [&]() { selector.select( *projection, vd, z, x, y ); } );
+            const auto tiles = selector.select( *projection, vd, z, x, y ).size();
+            const double lod = gv::bench::measure( [&]() { selector.selectLod( *projection, vd, z ); } );
+            const auto lodTiles = selector.selectLod( *projection, vd, z ).size();
+
+            std::printf( "%4d %14.1f %8zu %14.1f %8zu\n", z, single * 1.0e6, tiles, lod * 1.0e6, lodTiles );
+        }
+    }
+
+    return 0;
+}
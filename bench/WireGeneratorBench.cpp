@@ -0,0 +1,137 @@
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+#include "Bench.h"
+#include "Defines.h"
+#include "Projector.h"
+#include "WireGenerator.h"
+
+
+/*
+ * Time of a rotation step of the wire-frame Globe: the projection center
+ * moves and WireGenerator composes the graticule for it, projected on the CPU
+ * and on the GPU, for the whole Globe (zoom level 3) and views of zoom levels
+ * 6 and 10 centered at the projection center.
+ *
+ * The center jumps between two points far enough apart for another part
+ * of the graticule to become visible, even of the whole Globe, otherwise
+ * the geographic model for the GPU would not be composed again at all.
+ */
+
+
+namespace {
+
+
+using gv::Projector;
+using gv::ViewData;
+using gv::WireFrame;
+using gv::WireGenerator;
+
+
+//! WireGenerator with a view of 1024x1024 pixels at the given map zoom level.
+class WireBench
+{
+public:
+    WireBench( bool gpuProjection, int zoom )
+        : projector_( std::make_shared<Projector>() )
+        , frames_( 0 )
+    {
+        projector_->setProjectionAt( 20.0, 40.0 );
+
+        ViewData vd;
+        vd.unitInMeter = 0.001f;
+        vd.meterInPixel = static_cast<float>( defs::earthRadius * 4 / defs::tileSide / std::pow( 2.0, zoom ) );
+        vd.mapZoomLevel = zoom;
+        vd.pixWidth = 1024;
+        vd.pixHeight = 1024;
+        vd.glX0 = -vd.pixWidth / 2 * vd.meterInPixel * vd.unitInMeter;
+        vd.glX1 = vd.pixWidth / 2 * vd.meterInPixel * vd.unitInMeter;
+        vd.glY0 = -vd.pixHeight / 2 * vd.meterInPixel * vd.unitInMeter;
+        vd.glY1 = vd.pixHeight / 2 * vd.meterInPixel * vd.unitInMeter;
+
+        generator_.getProjector.connect( [this]() { return projector_; } );
+        generator_.updateWireGlobe.connect( [this]( const WireFrame& )
+            {
+                std::lock_guard<std::mutex> lock( mutex_ );
+                ++frames_;
+                cv_.notify_one();
+            } );
+
+        generate( [&]() { generator_.init( vd ); } );
+
+        if ( gpuProjection )
+        {
+            generate( [&]() { generator_.updateGpuProjection( true ); } );
+        }
+    }
+
+    //! Move the projection center and wait for the new model.
+    bool rotate( double lon, double lat )
+    {
+        return generate( [&]()
+            {
+                projector_->setProjectionAt( lon, lat );
+                generator_.updateGlobe();
+            } );
+    }
+
+private:
+    //! Notify WireGenerator of a change and wait for the new model.
+    template<class Fn>
+    bool generate( Fn&& notify )
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+        const long frames = frames_;
+
+        notify();
+
+        return cv_.wait_for( lock, std::chrono::seconds( 5 ), [&]() { return frames_ > frames; } );
+    }
+
+    std::shared_ptr<Projector> projector_;
+    long frames_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    WireGenerator generator_;
+};
+
+
+}
+
+
+int main()
+{
+    std::printf( "%-20s %14s\n", "", "time, us" );
+
+    for ( bool gpu : { false, true } )
+    {
+        for ( int z : { 3, 6, 10 } )
+        {
+            WireBench bench( gpu, z );
+            bool moved = false;
+            const auto step = [&]()
+            {
+                moved = !moved;
+                return moved ? bench.rotate( 50.0, 10.0 ) : bench.rotate( 20.0, 40.0 );
+            };
+
+            char name[32];
+            std::snprintf( name, sizeof( name ), "%s, zoom level %d", gpu ? "GPU" : "CPU", z );
+
+            if ( !step() || !step() )
+            {
+                std::printf( "%-20s %14s\n", name, "no model" );
+                continue;
+            }
+
+            const double perRun = gv::bench::measure( step );
+            std::printf( "%-20s %14.1f\n", name, perRun * 1.0e6 );
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlobeCompositor.h"
+
+
+int main( int argc, char** argv )
+{
+    const int width = argc > 1 ? std::atoi( argv[1] ) : 512;
+    const int height = argc > 2 ? std::atoi( argv[2] ) : 512;
+    const int images = argc > 3 ? std::atoi( argv[3] ) : 36;
+    const double meterInPixel = argc > 4 ? std::atof( argv[4] ) : 0.0;
+    const std::string prefix = argc > 5 ? argv[5] : "globe";
+
+    std::unique_ptr<gv::GlobeCompositor> globeCompositor;
+
+    try
+    {
+        globeCompositor.reset( new gv::GlobeCompositor( width, height ) );
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    globeCompositor->setMeterInPixel( meterInPixel );
+
+    // The first image fetches all the tiles, the rest reuse most of them
+    std::vector<unsigned char> png;
+    const auto t0 = std::chrono::steady_clock::now();
+
+    for ( int i = 0; i < images; ++i )
+    {
+        globeCompositor->setProjectionCenter( -180.0 + 360.0 * i / images, 30.0 );
+        globeCompositor->compose();
+
+        const std::string path = prefix + "_" + std::to_string( i ) + ".png";
+
+        if ( !globeCompositor->savePng( path ) )
+        {
+            std::cerr << "Cannot write " << path << std::endl;
+            return -1;
+        }
+    }
+
+    const auto t1 = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>( t1 - t0 ).count();
+
+    std::cout << "Composed " << images << " images " << width << "x" << height
+        << " in " << seconds << " s: " << images / seconds << " images per second" << std::endl;
+
+    return 0;
+}
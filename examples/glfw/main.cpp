@@ -11,6 +11,14 @@
 
 
 void windowFocusCallback( GLFWwindow* window, int focused );
+void windowRefreshCallback( GLFWwindow* window );
+void windowRefreshCallback( GLFWwindow* window )
+{
+    globeViewer->render();
+    glfwSwapBuffers( window );
+}
+
+
 void framebufferSizeCallback( GLFWwindow* window, int width, int height );
 void mouseCallback( GLFWwindow* window, double xpos, double ypos );
 void mouseButtonCallback( GLFWwindow* window, int button, int action, int mods );
@@ -33,6 +41,9 @@ int lastHeight;
 gv::TileServer tileServer = gv::TileServer::OSM;
 bool drawWireFrameView = true;
 bool drawMapTilesView = true;
+bool tileLevelOfDetail = true;
+bool packedVertices = true;
+bool gpuProjection = false;
 
 
 int main( int argc, char** argv )
@@ -55,12 +66,16 @@ int main( int argc, char** argv )
     globeViewer->resize( width, height );
 
     glfwSetWindowFocusCallback( window, windowFocusCallback );
+    glfwSetWindowRefreshCallback( window, windowRefreshCallback );
     glfwSetFramebufferSizeCallback( window, framebufferSizeCallback );
     glfwSetCursorPosCallback( window, mouseCallback );
     glfwSetMouseButtonCallback( window, mouseButtonCallback );
     glfwSetScrollCallback( window, scrollCallback );
     glfwSetKeyCallback( window, keyCallback );
 
+    // Wake up the loop below once the view changes
+    globeViewer->onChange( glfwPostEmptyEvent );
+
     gv::FpsCounter fpsC;
 
     while ( !glfwWindowShouldClose( window ) )
@@ -72,11 +87,16 @@ int main( int argc, char** argv )
         //    std::cout << "FPS: " << fps << std::endl;
         //}
 
-        glfwPollEvents();
-        globeViewer->render();
-        glfwSwapBuffers( window );
+        glfwWaitEvents();
+
+        if ( globeViewer->needsRedraw() )
+        {
+            globeViewer->render();
+            glfwSwapBuffers( window );
+        }
     }
 
+    globeViewer->onChange( nullptr );
     glfwDestroyWindow( window );
     glfwTerminate();
 
@@ -191,6 +211,35 @@ void keyCallback( GLFWwindow* window, int key, int scancode, int action, int mod
 
         globeViewer->setMapTilesView( drawMapTilesView );
     }
+    else if ( GLFW_KEY_3 == key && GLFW_PRESS == action )
+    {
+        tileLevelOfDetail = !tileLevelOfDetail;
+
+        globeViewer->setTileLevelOfDetail( tileLevelOfDetail );
+    }
+    else if ( GLFW_KEY_4 == key && GLFW_PRESS == action )
+    {
+        packedVertices = !packedVertices;
+
+        globeViewer->setPackedVertices( packedVertices );
+    }
+    else if ( GLFW_KEY_5 == key && GLFW_PRESS == action )
+    {
+        gpuProjection = !gpuProjection;
+
+        globeViewer->setGpuProjection( gpuProjection );
+    }
+    else if ( GLFW_KEY_S == key && GLFW_PRESS == action )
+    {
+        const auto stats = globeViewer->frameStats();
+
+        std::cout << "Frames requested: " << stats.requested
+            << ", rendered: " << stats.rendered
+            << ", dropped: " << stats.dropped
+            << ", late: " << stats.late
+            << ", latency: " << stats.lastLatency << " ms"
+            << " (max " << stats.maxLatency << " ms)" << std::endl;
+    }
     else if ( GLFW_KEY_F11 == key && GLFW_PRESS == action )
     {
         if ( !fullscreen )
@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlobeViewer.h"
+
+
+bool savePpm( const std::string& path, const std::vector<unsigned char>& rgb, int width, int height );
+
+
+int main( int argc, char** argv )
+{
+    const int width = argc > 1 ? std::atoi( argv[1] ) : 1280;
+    const int height = argc > 2 ? std::atoi( argv[2] ) : 720;
+    const int frames = argc > 3 ? std::atoi( argv[3] ) : 300;
+    const std::string path = argc > 4 ? argv[4] : "globe.ppm";
+
+    std::unique_ptr<gv::GlobeViewer> globeViewer;
+
+    try
+    {
+        globeViewer.reset( new gv::GlobeViewer( width, height ) );
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << e.what() << std::endl;
+        return -1;
+    }
+
+    if ( !globeViewer->validSetup() )
+        return -1;
+
+    // Let the first wire-frame model and map arrive
+    const auto start = std::chrono::steady_clock::now();
+
+    while ( std::chrono::steady_clock::now() - start < std::chrono::seconds( 2 ) )
+    {
+        if ( globeViewer->waitForChange( std::chrono::milliseconds( 100 ) ) )
+        {
+            globeViewer->render();
+        }
+    }
+
+    std::vector<unsigned char> rgb;
+    int w = 0;
+    int h = 0;
+    globeViewer->readPixels( rgb, w, h );
+
+    const auto before = globeViewer->frameStats();
+    const auto t0 = std::chrono::steady_clock::now();
+
+    // Every frame is read back, as a render server would do
+    for ( int i = 0; i < frames; ++i )
+    {
+        globeViewer->rotate( 2, 0 );
+        globeViewer->render();
+        globeViewer->readPixels( rgb, w, h );
+    }
+
+    const auto t1 = std::chrono::steady_clock::now();
+    const auto after = globeViewer->frameStats();
+    const double seconds = std::chrono::duration<double>( t1 - t0 ).count();
+    const auto rendered = after.rendered - before.rendered;
+
+    std::cout << "Rendered " << rendered << " frames " << w << "x" << h
+        << " in " << seconds << " s: " << rendered / seconds << " frames per second"
+        << ", dropped " << after.dropped - before.dropped << std::endl;
+
+    if ( !savePpm( path, rgb, w, h ) )
+    {
+        std::cerr << "Cannot write " << path << std::endl;
+        return -1;
+    }
+
+    globeViewer->cleanup();
+
+    return 0;
+}
+
+
+bool savePpm( const std::string& path, const std::vector<unsigned char>& rgb, int width, int height )
+{
+    FILE* file = std::fopen( path.c_str(), "wb" );
+
+    if ( !file )
+    {
+        return false;
+    }
+
+    std::fprintf( file, "P6\n%d %d\n255\n", width, height );
+    const bool ok = std::fwrite( rgb.data(), 1, rgb.size(), file ) == rgb.size();
+    std::fclose( file );
+
+    return ok;
+}
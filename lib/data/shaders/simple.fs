@@ -1,9 +1,16 @@
 #version 330 core
   
+in float facing;
+
 uniform vec4 colorIn;
 out vec4 colorOut;
 
 void main()
 {
+    if ( facing < 0.0 )
+    {
+        discard;
+    }
+
     colorOut = colorIn;
 }
@@ -2,9 +2,32 @@
   
 layout ( location = 0 ) in vec2 position;
 
+out float facing;
+
 uniform mat4 proj;
+uniform bool geographic;    // positions are longitude and latitude (in radians)
+uniform vec4 center;        // longitude, sine and cosine of latitude, prime vertical radius (in semi-major axes) of projection center
+uniform vec2 earth;         // semi-major axis (in GL units) and squared eccentricity
+
+// Orthographic projection of longitude and latitude (in radians) the same way as OrthoKernel does,
+// float input and trigonometry are within 3.5 meters, hence it's used down to map zoom level 13 only
+vec2 project( vec2 geo )
+{
+    float sinPhi = sin( geo.y );
+    float cosPhi = cos( geo.y );
+    float lam = geo.x - center.x;
+    float cosPhiCosLam = cosPhi * cos( lam );
+    float nu = inversesqrt( 1.0 - earth.y * sinPhi * sinPhi );
+
+    facing = center.y * sinPhi + center.z * cosPhiCosLam;
+
+    float x = nu * cosPhi * sin( lam );
+    float y = nu * ( center.z * sinPhi - center.y * cosPhiCosLam ) + earth.y * center.z * ( center.w * center.y - nu * sinPhi );
+    return earth.x * vec2( x, y );
+}
 
 void main()
 {
-    gl_Position = proj * vec4( position, 0.0, 1.0 );
+    facing = 1.0;
+    gl_Position = proj * vec4( geographic ? project( position ) : position, 0.0, 1.0 );
 }
@@ -3,10 +3,16 @@
 out vec4 colorOut;
 
 in vec2 texCoord;
+in float facing;
 
 uniform sampler2D sample;
 
 void main()
 {
+    if ( facing < 0.0 )
+    {
+        discard;
+    }
+
     colorOut = texture( sample, texCoord );
 }
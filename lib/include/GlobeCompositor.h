@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "type/TileServer.h"
+
+
+namespace gv {
+
+
+/*!
+ * \brief API class composing still images of the Globe on the CPU.
+ *
+ * GlobeCompositor needs neither window nor OpenGL, so it suits servers
+ * producing static images and thumbnails. It shares projection, tile selection
+ * and tile cache with GlobeViewer, but instead of building textured meshes it
+ * rasterizes the orthographic Globe straight into an RGB buffer: every pixel is
+ * projected back to geographic coordinates and sampled from the map tile it falls on.
+ *
+ * Unlike GlobeViewer the class is not thread safe, compose() does all the work
+ * in the calling thread (helped by a few worker threads) and returns once the image
+ * is ready. Use one instance per thread to compose images concurrently.
+ */
+class GlobeCompositor
+{
+public:
+    //! Create GlobeCompositor composing images of the particular size.
+    GlobeCompositor( int width, int height );
+    ~GlobeCompositor();
+
+    //! Change size of images.
+    void resize( int width, int height );
+
+    //! Change source of map tiles.
+    void setTileSource( TileServer );
+
+    //! Center projection at the particular geographic point.
+    void setProjectionCenter( double lon, double lat );
+
+    //! Change the Globe scale, zero fits the whole Globe into the image.
+    void setMeterInPixel( double );
+
+    //! Compose image of the Globe, pixels are RGB row by row from the top one.
+    const std::vector<unsigned char>& compose();
+
+    //! Encode the latest composed image as PNG.
+    bool encodePng( std::vector<unsigned char>& png );
+
+    //! Write the latest composed image into PNG file.
+    bool savePng( const std::string& path );
+
+    //! Width of images.
+    int width() const;
+
+    //! Height of images.
+    int height() const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl_;    //!< Pointer to implementation.
+};
+
+
+}
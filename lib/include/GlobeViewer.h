@@ -1,8 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <vector>
 
+#include "type/FrameStats.h"
 #include "type/TileServer.h"
 
 
@@ -18,11 +21,17 @@ namespace gv {
  * and provide a callable to the GlobeViewer constructor so that it can make the context current.
  * This little inconvenience allows to run all OpenGL code in a separate thread in non-conflicting
  * manner with user code, for instance, GUI application.
+ *
+ * Without any window GlobeViewer can render offscreen into its own context, if it's built
+ * with headless rendering (BUILD_HEADLESS). Rendered frames are read with readPixels().
  */
 class GlobeViewer
 {
 public:
     GlobeViewer( std::function<void()> );
+
+    //! Create GlobeViewer rendering offscreen without any window.
+    GlobeViewer( int width, int height );
     ~GlobeViewer();
 
     //! Check if GlobeViewer ready to used.
@@ -31,6 +40,21 @@ public:
     //! Render OpenGL context.
     void render();
 
+    //! Read pixels of the latest rendered frame.
+    void readPixels( std::vector<unsigned char>& rgb, int& width, int& height );
+
+    //! Statistics of requested, rendered, dropped and late frames.
+    FrameStats frameStats() const;
+
+    //! Check if the view has changed since the latest rendered frame.
+    bool needsRedraw() const;
+
+    //! Wait till the view changes, but not longer than timeout.
+    bool waitForChange( std::chrono::milliseconds timeout );
+
+    //! Set a callable to be called when the view changes.
+    void onChange( std::function<void()> );
+
     //! Resize the view.
     void resize( int w, int h );
 
@@ -61,6 +85,15 @@ public:
     //! Turn map tiles on or off.
     void setMapTilesView( bool );
 
+    //! Choose map zoom level for every tile separately or use a single one.
+    void setTileLevelOfDetail( bool );
+
+    //! Pack texture coordinates of map vertices or keep them floats.
+    void setPackedVertices( bool );
+
+    //! Project the Globe on the GPU or on the CPU.
+    void setGpuProjection( bool );
+
     //! Optional cleanup.
     void cleanup();
 
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <array>
 #include <functional>
 #include <memory>
 #include <tuple>
@@ -7,6 +8,10 @@
 #include <boost/signals2.hpp>
 
 #include "LoadGL.h"
+#include "type/MapFrame.h"
+#include "type/MapGeometry.h"
+#include "type/MapStage.h"
+#include "type/WireFrame.h"
 
 
 namespace gv {
@@ -40,21 +45,18 @@ public:
     //! Move projection center to a point.
     void centerAt( int pixelX, int pixelY );
 
+    //! Upload new wire-frame model of the Globe.
+    void updateWireGlobe( const WireFrame& );
+
     //! Update map tiles texture with new data.
-    void updateTexture( std::vector<GLfloat> /*vbo*/, int /*texW*/, int /*texH*/, std::vector<unsigned char> /*data*/ );
+    void updateTexture( MapFrame );
 
-    //! Provide data on simple triangle for rendering.
-    std::tuple<GLuint, GLsizei> simpleTriangle() const;
+    //! Switch to the latest map tiles texture which has been transferred.
+    void swapMapTexture();
 
-    //! Provide data on wire-frame model of the Globe for rendering.
-    std::tuple<GLuint, GLsizei> wireGlobe() const;
-    
-    //! Provide data on map tiles for rendering.
-    std::tuple<GLuint, GLuint, GLsizei> mapTiles() const;
+    //! Check if a map tiles texture is still being transferred.
+    bool mapPending() const;
 
-    //! Request for a value of units in one meter.
-    boost::signals2::signal<float()> getUnitInMeter;
-    
     //! Request for a value of meters in one pixel.
     boost::signals2::signal<float()> getMeterInPixel;
     
@@ -70,26 +72,67 @@ public:
     //! Signal that map is ready for rendering.
     boost::signals2::signal<void()> mapReady;
 
-private:
-    //! Calculate circles of latitude and meridians.
-    void composeWireGlobe();
+    //! Send rendering data of newly uploaded wire-frame model of the Globe.
+    boost::signals2::signal<void( GLuint, GLsizei, bool )> wireGlobeUpdated;
 
-    float unitInMeter_;         //!< Non-changable value of units in one meter.
+    //! Send rendering data of newly displayed map.
+    boost::signals2::signal<void( GLuint, GLuint, GLsizei, GLenum, bool )> mapTilesUpdated;
 
-    std::shared_ptr<Projector> projector_;  //!< Pointer to Projector instance.
+    //! Hand over mapped pixel buffer for the next map tiles texture.
+    boost::signals2::signal<void( MapStage )> mapStaged;
 
-    GLuint vaoST_;              //!< Vertex array object for Simple Triangle.
-    GLuint vboST_;              //!< Vertex buffer object for Simple Triangle.
-    GLsizei numST_;             //!< Number of vertices for Simple Triangle.
+    //! Signal that a new frame is required to display changed data.
+    boost::signals2::signal<void()> changed;
+
+private:
+    //! Describe map vertices layout to vertex array object for map tiles.
+    void setMapFormat( VertexFormat );
+
+    //! Find map tiles texture which is neither displayed nor staged.
+    std::size_t freeUpload() const;
+
+    //! Map pixel buffer of a free map tiles texture and hand it over.
+    void stageUpload( std::size_t size );
+
+    //! Map tiles texture transferred via pixel buffer object.
+    struct MapUpload
+    {
+        GLuint pbo;             //!< Pixel unpack buffer object.
+        GLuint tex;             //!< Texture receiving data from pixel buffer object.
+        GLsync fence;           //!< Fence signaled once the transfer completes.
+        int w;                  //!< Width of texture.
+        int h;                  //!< Height of texture.
+        unsigned long serial;   //!< Serial number of the upload.
+        std::shared_ptr<const MapGeometry> geometry;    //!< Map tiles geometry matching the texture.
+    };
+
+    //! Number of map tiles textures: one displayed, the rest are being transferred.
+    static const std::size_t mapUploads = 3;
+
+    std::shared_ptr<Projector> projector_;  //!< Pointer to Projector instance.
 
     GLuint vaoWire_;            //!< Vertex array object for wire-frame model of the Globe.
     GLuint vboWire_;            //!< Vertex buffer object for wire-frame model of the Globe.
-    GLsizei numWire_;           //!< Number of vertices for wire-frame model of the Globe.
+    GLuint eboWire_;            //!< Element buffer object for wire-frame model of the Globe.
+    GLsizei numWire_;           //!< Number of indices for wire-frame model of the Globe.
+    bool geoWire_;              //!< Indicator of wire-frame model of the Globe being geographic.
+    unsigned long wireGeneration_;  //!< Generation of wire-frame model of the Globe being displayed.
     
     GLuint vaoMap_;             //!< Vertex array object for map tiles.
     GLuint vboMap_;             //!< Vertex buffer object for map tiles.
-    GLuint texMap_;             //!< Texture for map tiles.
-    GLsizei numMap_;            //!< Number of vertices for map tiles.
+    GLuint eboMap_;             //!< Element buffer object for map tiles.
+    GLuint texMap_;             //!< Texture for map tiles being displayed.
+    GLsizei numMap_;            //!< Number of indices for map tiles.
+    GLenum indexTypeMap_;       //!< Type of indices for map tiles.
+    VertexFormat formatMap_;    //!< Layout of vertices for map tiles.
+    bool geoMap_;               //!< Indicator of map tiles vertices being geographic.
+
+    std::array<MapUpload, mapUploads> uploads_;     //!< Ring of map tiles textures.
+    std::size_t frontUpload_;   //!< Index of map tiles texture being displayed.
+    std::size_t lastUpload_;    //!< Index of map tiles texture uploaded last.
+    unsigned long serial_;      //!< Serial number of the last upload.
+    std::size_t stagedUpload_;  //!< Index of map tiles texture which pixel buffer is handed over, mapUploads if none.
+    unsigned long stageSerial_; //!< Serial number of the last stage.
 
     double rotatedLon_;         //!< Current degree value the Globe rotated along longitude.
     double rotatedLat_;         //!< Current degree value the Globe rotated along latitude.
@@ -15,6 +15,9 @@ const double degToRad = pi / 180.0;     //!< Coefficient to convert degrees to r
 const double radToDeg = 180.0 / pi;     //!< Coefficient to convert radians to degrees.
 
 const int tileSide = 256;               //!< Map tile side in pixels.
+const int gpuMaxZoom = 13;              //!< The deepest map zoom level projected on the GPU, float longitudes and latitudes are too coarse beyond it.
+
+const int frameBudget = 16667;          //!< Time (in microseconds) from render request to the end of rendering a frame may take.
 
 
 }
\ No newline at end of file
@@ -1,14 +1,26 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <boost/asio/connect.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/signals2.hpp>
 
+#include "Arena.h"
+#include "BufferPool.h"
+#include "HandlerMemory.h"
+#include "WorkerPool.h"
+#include "type/MapFrame.h"
+#include "type/MapStage.h"
+#include "type/MapGeometry.h"
 #include "type/TileServer.h"
 #include "type/TileTexture.h"
 #include "type/ViewData.h"
@@ -17,7 +29,9 @@
 namespace gv {
 
 
+class Projection;
 class Projector;
+class TileSelector;
 
 
 /*!
@@ -30,6 +44,12 @@ class Projector;
  * (which is a simple vector of chars) and fills it with new tiles.
  * Then it send texture in memory  to the system.
  *
+ * Consecutive regenerations are diffed against each other: tiles that stay
+ * visible keep their place in the texture, their pixels and their vertices,
+ * only newly visible tiles are requested and tiles that went out of sight
+ * free their places for the new ones. Tiles that arrive empty or broken stay
+ * blank and are requested again only after a while or with another server.
+ *
  * MapGenerator is one of few classes that do a lot of work in a separate
  * thread. That allows for non-blocking behaviour but also leads to
  * delays in displaying the map.
@@ -52,9 +72,21 @@ public:
     //! Notification of changing tile server.
     void updateTileServer( TileServer );
 
+    //! Notification of switching between single and mixed map zoom levels.
+    void updateTileLod( bool );
+
+    //! Notification of switching between float and packed texture coordinates of vertices.
+    void updatePackedVertices( bool );
+
+    //! Notification of switching between projecting map on the CPU and on the GPU.
+    void updateGpuProjection( bool );
+
     //! Receiving new map tiles.
     void getTiles( const std::vector<TileImage>& );
 
+    //! Receiving mapped pixel buffer for the next texture.
+    void updateStage( MapStage );
+
     //! Request for pointer to Projector instance.
     boost::signals2::signal<std::shared_ptr<Projector>()> getProjector;
 
@@ -64,69 +96,145 @@ public:
     //! Signal that map is not ready for rendering.
     boost::signals2::signal<void()> mapNotReady;
 
-    //! Send new texture data.
-    boost::signals2::signal<void( std::vector<GLfloat> /*vbo*/, int /*texW*/, int /*texH*/,
-        std::vector<unsigned char> /*data*/)> updateMapTexture;
+    //! Send new map, a slot keeps it by calling MapFrame::share().
+    boost::signals2::signal<void( const MapFrame& )> updateMapTexture;
 
 private:
+    //! Key of a projected tile mesh.
+    struct MeshKey
+    {
+        TileHead head;      //!< Tile header.
+        double lon;         //!< Longitude of projection center.
+        double lat;         //!< Latitude of projection center.
+        int detail;         //!< Binary logarithm of meters in pixel the mesh is tessellated for.
+        bool geographic;    //!< Indicator of geographic mesh not depending on projection center.
+
+        //! Equality operator.
+        bool operator==( const MeshKey& ) const;
+    };
+
+    //! Hash of MeshKey.
+    struct MeshKeyHash
+    {
+        //! Calculate hash value.
+        std::size_t operator()( const MeshKey& ) const;
+    };
+
+    //! Indexed projected mesh of a tile.
+    struct TileMesh
+    {
+        std::vector<GLfloat> vertices;      //!< Coordinates x, y and texture coordinates relative to the tile.
+        std::vector<GLushort> indices;      //!< Indices of triangle vertices within the tile.
+        unsigned used = 0;                  //!< Generation of the texture the mesh was used for last.
+    };
+
+    //! Tile mesh to be written into map geometry.
+    struct MeshPart
+    {
+        const TileMesh* mesh;               //!< Mesh of the tile.
+        const TileBody* body;               //!< Tile body with place in texture.
+        std::size_t vertex;                 //!< The first vertex of the tile in map geometry.
+        std::size_t index;                  //!< The first index of the tile in map geometry.
+    };
+
     //! Check and modify active_ and pending_ states before generating new map texture.
     void checkStates();
 
     //! Check and modify active_ and pending_ states after generating new map texture.
     void cleanupCheck();
 
+    //! Post generating new map texture to the thread of MapGenerator.
+    void postRegeneration();
+
     //! Generate new map texture.
     void regenerateMap();
 
-    //! Convert longitude to tile coordinate x.
-    int lonToTileX( double lon, int z ) const;
+    //! Write texture data into the stage provided by DataKeeper.
+    MapStage stageTexture();
+
+    //! Find a point of the Globe visible in the view.
+    bool visiblePoint( double& lon, double& lat );
 
-    //! Convert latitude to tile coordinate y.
-    int latToTileY( double lat, int z ) const;
+    //! Find a point of the Globe visible in the view by walking view borders.
+    bool borderPoint( double& lon, double& lat );
 
-    //! Convert tile coordinate x to longitude.
-    double tileXToLon( int x, int z ) const;
+    //! Build meta data of a new map texture based on tile headers.
+    void composeTileTexture( const std::vector<TileHead>& );
 
-    //! Convert tile coordinate y to latitude.
-    double tileYToLat( int y, int z ) const;
+    //! Rebuild texture layout for a new number of tiles keeping retained tiles pixels.
+    void relayoutTexture( TileMap& kept, int tileCount );
 
-    //! Check if a point is visible in current projection.
-    bool visiblePoint( double& lon, double& lat );
+    //! Fill texture related part of a tile body.
+    void placeTile( const TileHead&, TileBody&, int row, int col ) const;
 
-    //! Find all map tiles that need to be requested for further processing.
-    std::vector<TileHead> findTilesToProcess( int z, int x, int y );
+    //! Forget all tiles of the current texture.
+    void resetTileSet();
 
-    //! Check if a tile is visible in current projection.
-    bool tileVisible( TileHead );
+    //! Provide texture data for modification.
+    std::vector<unsigned char>& writableData();
 
-    //! Build meta data of a new map texture based on tile headers.
-    void composeTileTexture( const std::vector<TileHead>& );
+    //! Provide geometry of map tiles for modification.
+    MapGeometry& writableGeometry();
 
     //! Create vertex buffer object for a new map texture.
-    void vboFromTileTexture( TileTexture );
+    void vboFromTileTexture( const TileTexture& );
+
+    //! Drop the least recently used tile meshes.
+    void evictMeshes();
+
+    //! Tessellate projected mesh of a single tile adaptively.
+    void tileMesh( const TileBody&, int detail, TileMesh& mesh ) const;
+
+    //! Build geographic mesh of a single tile to be projected on the GPU.
+    void geoTileMesh( const TileBody&, TileMesh& mesh ) const;
 
     //! Check if everything is ready for a new map texture.
     void finalize();
 
+    support::HandlerMemory regenerationMemory_; //!< Memory of posted regenerateMap(), outlives ioc_.
     boost::asio::io_context ioc_;           //!< Allows implementing task queue.
     boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_; //!< Provides work to ioc and doesn't let it stop.
     std::vector<std::thread> threads_;      //!< Vector of worker thread.
+    support::WorkerPool workers_;           //!< Threads calculating tile vertices in parallel.
 
     std::shared_ptr<Projector> projector_;  //!< Pointer to Projector instance.
+    std::shared_ptr<const Projection> projection_;  //!< Projection used by the whole current map generation.
+    std::unique_ptr<TileSelector> selector_;    //!< Selects tiles visible in the view.
     ViewData viewData_;                     //!< Current viewport dimensions data.
     ViewData newViewData_;                  //!< Newly arrived viewport dimensions data.
     TileServer tileServerType_;             //!< Current server of map tiles.
     TileServer newTileServerType_;          //!< Newly arrived server of map tiles.
+    std::atomic<bool> tileLod_;             //!< Indicator of choosing map zoom level for every tile separately.
+    std::atomic<bool> packedVertices_;      //!< Indicator of packing texture coordinates of vertices into unsigned shorts.
+    std::atomic<bool> gpuProjection_;       //!< Indicator of sending geographic geometry to be projected on the GPU.
+    std::atomic<bool> geographic_;          //!< Indicator of the latest geometry being geographic.
+    std::array<support::Arena, 2> arenas_;  //!< Memory of temporaries and tiles of two latest textures in turn.
+    unsigned generation_;                   //!< Number of textures composed.
     TileTexture tileTex_;                   //!< Meta data of texture currently being generated.
 
-    std::vector<GLfloat> vbo_;              //!< Vertex buffer object for new texture.
-    std::vector<unsigned char> data_;       //!< New texture data (plain bytes).
+    std::shared_ptr<MapGeometry> geometry_; //!< Geometry of map tiles for new texture.
+    std::shared_ptr<std::vector<unsigned char>> data_;  //!< New texture data (plain bytes).
+    support::BufferPool<MapGeometry> geometryPool_;                 //!< Spare geometry buffers.
+    support::BufferPool<std::vector<unsigned char>> dataPool_;      //!< Spare texture data buffers.
+
+    std::unordered_set<TileHead> loadedTiles_;  //!< Tiles which pixels are already in data_.
+    std::unordered_map<TileHead, std::chrono::steady_clock::time_point> failedTiles_;  //!< Tiles that came empty or undecodable and when to request them again.
+    std::vector<int> freeSlots_;                //!< Texture places (row * columns + col) not taken by any tile.
+    std::unordered_map<MeshKey, TileMesh, MeshKeyHash> meshes_;    //!< Projected tile meshes with texture coordinates relative to tiles.
+    std::vector<const TileMap::value_type*> meshTiles_; //!< Tiles which meshes are being calculated.
+    std::vector<TileMesh> meshStage_;           //!< Meshes being calculated, one per tile in meshTiles_.
+    std::vector<TileMesh> spareMeshes_;         //!< Buffers of evicted meshes to be reused.
+    std::vector<unsigned> meshUses_;            //!< Generations of cached meshes used last, for finding the least recent ones.
+    std::vector<MeshPart> meshParts_;           //!< Tile meshes and their places in geometry_.
 
     std::mutex mutexState_;                 //!< For state synchronization.
     bool active_;                           //!< Indicator of new texture being generated.
     bool pending_;                          //!< Indicator of existence of new texture generate request.
     std::atomic<bool> gotTiles_;            //!< Indicator of readiness of map tiles for currently generating texture.
     std::atomic<bool> calcedVbo_;           //!< Indicator of readiness of vertex buffer object for currently generating texture.
+
+    std::mutex mutexStage_;                 //!< For stage_ synchronization.
+    MapStage stage_;                        //!< Pixel buffer for the next texture, empty if there's none.
 };
 
 
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace gv {
+
+
+/*!
+ * \brief Parameters of orthographic projection shared by all kernel implementations.
+ *
+ * Everything depending only on projection center and the Earth model
+ * is calculated once, so kernels do only per point work.
+ */
+struct OrthoParams
+{
+    double a;           //!< Semi-major axis (in meters).
+    double invA;        //!< Inverted semi-major axis.
+    double e2;          //!< Squared eccentricity (zero for a sphere).
+    double lam0;        //!< Longitude of projection center (in radians).
+    double sinPhi0;     //!< Sine of latitude of projection center.
+    double cosPhi0;     //!< Cosine of latitude of projection center.
+    double nu0;         //!< Prime vertical radius of curvature at projection center (in semi-major axes).
+    double w;           //!< Inverted squared ratio of semi-minor to semi-major axis.
+    double d;           //!< Offset of projection center along the plane axis y (in semi-major axes).
+    double qa;          //!< Quadratic coefficient of the line and ellipsoid intersection.
+};
+
+
+/*!
+ * \brief Native orthographic projection of arrays of points.
+ *
+ * OrthoKernel projects WGS84 ellipsoid or a sphere of WGS84 semi-major axis
+ * to the plane, forward and backward, without PROJ.4. Points are processed
+ * several at once with SIMD instructions. Sines, cosines and arctangents are
+ * evaluated with polynomials, so there are no branches per point at all.
+ *
+ * Forward projection follows PROJ.4: a point is visible if the dot product
+ * of its normal and the normal at projection center is not negative.
+ * Inverted projection intersects the line along the view direction with
+ * the ellipsoid, which has a closed form for both Earth models.
+ *
+ * Instruction set is chosen at runtime among the ones supported by both
+ * the build and the processor. The best one is used unless another one is
+ * selected explicitly.
+ */
+class OrthoKernel
+{
+public:
+    //! Earth model.
+    enum class Shape
+    {
+        Sphere,
+        Ellipsoid
+    };
+
+    //! Instruction set used by kernels.
+    enum class InstructionSet
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        NEON
+    };
+
+    OrthoKernel( double lon, double lat, Shape );
+
+    //! Forward projection of arrays of points.
+    std::size_t forward( const double* lon, const double* lat, double* x, double* y, std::size_t count ) const;
+
+    //! Inverted projection of arrays of points.
+    std::size_t inverse( const double* x, const double* y, double* lon, double* lat, std::size_t count ) const;
+
+    //! Inverted projection of arrays of points straight to Web Mercator of map tiles.
+    std::size_t inverseMercator( const double* x, const double* y, double* mx, double* my, std::size_t count ) const;
+
+    //! Provide projection parameters.
+    const OrthoParams& params() const;
+
+    //! Check if an instruction set can be used.
+    static bool supported( InstructionSet );
+
+    //! Provide the fastest supported instruction set.
+    static InstructionSet best();
+
+    //! Select instruction set for all kernels.
+    static bool select( InstructionSet );
+
+    //! Provide currently selected instruction set.
+    static InstructionSet selected();
+
+private:
+    OrthoParams params_;    //!< Projection parameters.
+};
+
+
+}
@@ -0,0 +1,464 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "OrthoKernel.h"
+
+
+/*
+ * Instruction sets compiled in. AVX2 needs its own translation unit built
+ * with AVX2 and FMA enabled, the build defines GV_ORTHO_AVX2 when it does that.
+ */
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define GV_ORTHO_SSE2
+#endif
+
+#if defined( __aarch64__ ) || defined( _M_ARM64 )
+#define GV_ORTHO_NEON
+#endif
+
+
+namespace gv {
+
+
+/*!
+ * Templates of orthographic projection kernels.
+ *
+ * Kernels are written once for an abstract lane type L which provides:
+ * vector type V, mask type M, number of doubles in a vector (width) and
+ * static operations load, store, set, add, sub, mul, mulAdd, div, sqrt,
+ * round (to nearest), max, lt, gt, ge, eq, land, lor, select, count,
+ * exponent and mantissa (of positive normal numbers, mantissa is in [1, 2)).
+ * Every instruction set provides its own lane type, which must have
+ * internal linkage, so instantiations compiled with different instruction
+ * sets never meet each other at link time.
+ */
+namespace ortho {
+
+
+const double twoOverPi = 6.36619772367581382433e-01;    //!< 2 / pi.
+const double pio2First = 1.57079632673412561417e+00;    //!< First 33 bits of pi / 2.
+const double pio2Second = 6.07710050630396597660e-11;   //!< Second 33 bits of pi / 2.
+const double pio2Third = 2.02226624871116645580e-21;    //!< Third 33 bits of pi / 2.
+const double pio4 = 7.85398163397448309616e-01;         //!< pi / 4.
+const double pio2 = 1.57079632679489661923e+00;         //!< pi / 2.
+const double pi = 3.14159265358979323846e+00;           //!< pi.
+const double degToRad = pi / 180.0;                     //!< Degrees to radians.
+const double radToDeg = 180.0 / pi;                     //!< Radians to degrees.
+const double eps = 1.0e-10;                             //!< Tolerance PROJ.4 uses to decide if a point is visible.
+const double sqrt2 = 1.41421356237309504880e+00;        //!< Square root of 2.
+const double ln2First = 6.93359375e-01;                 //!< First bits of natural logarithm of 2.
+const double ln2Second = -2.121944400546905827679e-04;  //!< The rest of natural logarithm of 2.
+const double mercatorSinLimit = 9.96272076220749944e-01;    //!< Sine of the latitude Web Mercator is cut at, tanh(pi).
+
+//! Sine polynomial on [-pi/4, pi/4] (Cephes).
+const double sinCoef[] = {
+    1.58962301576546568060e-10, -2.50507477628578072866e-08, 2.75573136213857245213e-06,
+    -1.98412698295895385996e-04, 8.33333333332211858878e-03, -1.66666666666666307295e-01 };
+
+//! Cosine polynomial on [-pi/4, pi/4] (Cephes).
+const double cosCoef[] = {
+    -1.13585365213876817300e-11, 2.08757008419747316778e-09, -2.75573141792967388112e-07,
+    2.48015872888517045348e-05, -1.38888888888730564116e-03, 4.16666666666665929218e-02 };
+
+//! Numerator of arctangent rational function on [-0.66, 0.66] (Cephes).
+const double atanNum[] = {
+    -8.750608600031904122785e-01, -1.615753718733365076637e+01, -7.500855792314704667340e+01,
+    -1.228866684490136173410e+02, -6.485021904942025371773e+01 };
+
+//! Denominator of arctangent rational function on [-0.66, 0.66] (Cephes), leading 1 is omitted.
+const double atanDen[] = {
+    2.485846490142306297962e+01, 1.650270098316988542046e+02, 4.328810604912902668951e+02,
+    4.853903996359136964868e+02, 1.945506571482613964425e+02 };
+
+//! Numerator of logarithm rational function on [sqrt(2) / 2 - 1, sqrt(2) - 1] (Cephes), leading coefficient is logNumLead.
+const double logNum[] = {
+    4.97494994976747001425e-01, 4.70579119878881725854e+00, 1.44989225341610930846e+01,
+    1.79368678507819816313e+01, 7.70838733755885391666e+00 };
+
+//! Leading coefficient of logarithm numerator.
+const double logNumLead = 1.01875663804580931796e-04;
+
+//! Denominator of logarithm rational function on [sqrt(2) / 2 - 1, sqrt(2) - 1] (Cephes), leading 1 is omitted.
+const double logDen[] = {
+    1.12873587189167450590e+01, 4.52279145837532221105e+01, 8.29875266912776603211e+01,
+    7.11544750618563894466e+01, 2.31251620126765340583e+01 };
+
+
+/*!
+ * \brief Evaluate polynomial with Horner's method.
+ * \param[in] z Argument.
+ * \param[in] coef Coefficients from the highest power down.
+ * \param[in] lead Coefficient of the power higher than all in coef.
+ * \return Value of polynomial.
+ */
+template<class L, std::size_t N>
+typename L::V poly( typename L::V z, const double ( &coef )[N], double lead )
+{
+    typename L::V res = L::set( lead );
+
+    for ( std::size_t i = 0; i < N; ++i )
+    {
+        res = L::mulAdd( res, z, L::set( coef[i] ) );
+    }
+
+    return res;
+}
+
+
+/*!
+ * \brief Round down to integer.
+ * \param[in] v Value.
+ * \return The largest integer not greater than v.
+ */
+template<class L>
+typename L::V floor( typename L::V v )
+{
+    const typename L::V r = L::round( v );
+    return L::select( L::gt( r, v ), L::sub( r, L::set( 1.0 ) ), r );
+}
+
+
+/*!
+ * \brief Sine and cosine of an angle.
+ *
+ * Argument is reduced to [-pi/4, pi/4] by a multiple of pi/2 subtracted in three parts,
+ * which keeps full precision for the angles met in projections.
+ * \param[in] x Angle in radians.
+ * \param[out] s Sine.
+ * \param[out] c Cosine.
+ */
+template<class L>
+void sinCos( typename L::V x, typename L::V& s, typename L::V& c )
+{
+    typedef typename L::V V;
+
+    const V j = L::round( L::mul( x, L::set( twoOverPi ) ) );
+    V r = L::sub( x, L::mul( j, L::set( pio2First ) ) );
+    r = L::sub( r, L::mul( j, L::set( pio2Second ) ) );
+    r = L::sub( r, L::mul( j, L::set( pio2Third ) ) );
+
+    const V z = L::mul( r, r );
+    const V sr = L::mulAdd( L::mul( r, z ), poly<L>( z, sinCoef, 0.0 ), r );
+    const V cr = L::mulAdd( L::mul( z, z ), poly<L>( z, cosCoef, 0.0 ), L::sub( L::set( 1.0 ), L::mul( z, L::set( 0.5 ) ) ) );
+
+    // quadrant of the angle
+    const V q = L::sub( j, L::mul( L::set( 4.0 ), floor<L>( L::mul( j, L::set( 0.25 ) ) ) ) );
+    const typename L::M q1 = L::eq( q, L::set( 1.0 ) );
+    const typename L::M q2 = L::eq( q, L::set( 2.0 ) );
+    const typename L::M q3 = L::eq( q, L::set( 3.0 ) );
+    const typename L::M odd = L::lor( q1, q3 );
+
+    s = L::select( odd, cr, sr );
+    c = L::select( odd, sr, cr );
+    s = L::select( L::lor( q2, q3 ), L::sub( L::set( 0.0 ), s ), s );
+    c = L::select( L::lor( q1, q2 ), L::sub( L::set( 0.0 ), c ), c );
+}
+
+
+/*!
+ * \brief Arctangent of y / x using signs of both arguments to get the quadrant.
+ * \param[in] y Ordinate.
+ * \param[in] x Abscissa.
+ * \return Angle in radians from -pi to pi.
+ */
+template<class L>
+typename L::V atan2( typename L::V y, typename L::V x )
+{
+    typedef typename L::V V;
+
+    const V zero = L::set( 0.0 );
+    const V one = L::set( 1.0 );
+    const V ay = L::max( y, L::sub( zero, y ) );
+    const V ax = L::max( x, L::sub( zero, x ) );
+    const typename L::M steep = L::gt( ay, ax );
+    const V num = L::select( steep, ax, ay );
+    const V den = L::select( steep, ay, ax );
+
+    // t is in [0, 1], above 0.66 it's mapped to [0, 0.2] and pi / 4 is added
+    V t = L::div( num, L::select( L::eq( den, zero ), one, den ) );
+    const typename L::M big = L::gt( t, L::set( 0.66 ) );
+    t = L::select( big, L::div( L::sub( t, one ), L::add( t, one ) ), t );
+
+    const V z = L::mul( t, t );
+    V res = L::mulAdd( L::mul( t, z ), L::div( poly<L>( z, atanNum, 0.0 ), poly<L>( z, atanDen, 1.0 ) ), t );
+    res = L::select( big, L::add( res, L::set( pio4 ) ), res );
+
+    res = L::select( steep, L::sub( L::set( pio2 ), res ), res );
+    res = L::select( L::lt( x, zero ), L::sub( L::set( pi ), res ), res );
+    return L::select( L::lt( y, zero ), L::sub( zero, res ), res );
+}
+
+
+/*!
+ * \brief Natural logarithm of positive normal numbers.
+ *
+ * Mantissa is moved to [sqrt(2) / 2, sqrt(2)] and its logarithm is
+ * approximated around one, logarithm of 2 is added in two parts.
+ * \param[in] x Argument.
+ * \return Natural logarithm.
+ */
+template<class L>
+typename L::V log( typename L::V x )
+{
+    typedef typename L::V V;
+
+    V e = L::exponent( x );
+    V m = L::mantissa( x );
+    const typename L::M big = L::gt( m, L::set( sqrt2 ) );
+    m = L::select( big, L::mul( m, L::set( 0.5 ) ), m );
+    e = L::select( big, L::add( e, L::set( 1.0 ) ), e );
+
+    const V f = L::sub( m, L::set( 1.0 ) );
+    const V z = L::mul( f, f );
+    V res = L::mul( L::mul( f, z ), L::div( poly<L>( f, logNum, logNumLead ), poly<L>( f, logDen, 1.0 ) ) );
+    res = L::mulAdd( e, L::set( ln2Second ), res );
+    res = L::sub( res, L::mul( z, L::set( 0.5 ) ) );
+    res = L::add( res, f );
+    return L::mulAdd( e, L::set( ln2First ), res );
+}
+
+
+/*!
+ * \brief Forward projection of one vector of points.
+ * \param[in] p Projection parameters.
+ * \param[in] lon Longitudes.
+ * \param[in] lat Latitudes.
+ * \param[out] x Projected meters along axis x (HUGE_VAL if point is on the far side).
+ * \param[out] y Projected meters along axis y (HUGE_VAL if point is on the far side).
+ * \return Number of visible points.
+ */
+template<class L>
+std::size_t forwardBlock( const OrthoParams& p, const double* lon, const double* lat, double* x, double* y )
+{
+    typedef typename L::V V;
+
+    const V phi = L::mul( L::load( lat ), L::set( degToRad ) );
+    const V lam = L::sub( L::mul( L::load( lon ), L::set( degToRad ) ), L::set( p.lam0 ) );
+    V sinPhi;
+    V cosPhi;
+    V sinLam;
+    V cosLam;
+    sinCos<L>( phi, sinPhi, cosPhi );
+    sinCos<L>( lam, sinLam, cosLam );
+
+    const V cosPhiCosLam = L::mul( cosPhi, cosLam );
+    const V cosc = L::mulAdd( L::set( p.sinPhi0 ), sinPhi, L::mul( L::set( p.cosPhi0 ), cosPhiCosLam ) );
+    const typename L::M visible = L::ge( cosc, L::set( -eps ) );
+
+    const V one = L::set( 1.0 );
+    const V nu = L::div( one, L::sqrt( L::sub( one, L::mul( L::set( p.e2 ), L::mul( sinPhi, sinPhi ) ) ) ) );
+
+    const V resX = L::mul( L::set( p.a ), L::mul( nu, L::mul( cosPhi, sinLam ) ) );
+    const V plane = L::sub( L::mul( L::set( p.cosPhi0 ), sinPhi ), L::mul( L::set( p.sinPhi0 ), cosPhiCosLam ) );
+    const V shift = L::mul( L::set( p.e2 * p.cosPhi0 ), L::sub( L::set( p.nu0 * p.sinPhi0 ), L::mul( nu, sinPhi ) ) );
+    const V resY = L::mul( L::set( p.a ), L::mulAdd( nu, plane, shift ) );
+
+    const V far = L::set( HUGE_VAL );
+    L::store( x, L::select( visible, resX, far ) );
+    L::store( y, L::select( visible, resY, far ) );
+
+    return L::count( visible );
+}
+
+
+/*!
+ * \brief Point of the Globe seen at points of the plane.
+ *
+ * The line through the point along the view direction is intersected
+ * with the ellipsoid (in semi-major axes) and the nearest intersection is taken.
+ * \param[in] p Projection parameters.
+ * \param[in] x Projected meters along axis x.
+ * \param[in] y Projected meters along axis y.
+ * \param[out] px Geocentric coordinate towards projection center longitude on the equator.
+ * \param[out] py Geocentric coordinate towards 90 degrees east of it.
+ * \param[out] pz Geocentric coordinate towards the North Pole.
+ * \return Mask of points inside the Globe.
+ */
+template<class L>
+typename L::M globePoint( const OrthoParams& p, const double* x, const double* y,
+    typename L::V& px, typename L::V& py, typename L::V& pz )
+{
+    typedef typename L::V V;
+
+    const V sinPhi0 = L::set( p.sinPhi0 );
+    const V cosPhi0 = L::set( p.cosPhi0 );
+    const V w = L::set( p.w );
+    const V t = L::mulAdd( L::load( y ), L::set( p.invA ), L::set( p.d ) );
+
+    // point on the plane in geocentric axes rotated to projection center longitude
+    const V qx = L::sub( L::set( 0.0 ), L::mul( t, sinPhi0 ) );
+    const V qy = L::mul( L::load( x ), L::set( p.invA ) );
+    const V qz = L::mul( t, cosPhi0 );
+
+    const V b = L::mul( L::set( 2.0 ), L::mulAdd( qx, cosPhi0, L::mul( w, L::mul( qz, sinPhi0 ) ) ) );
+    const V c = L::sub( L::mulAdd( qx, qx, L::mulAdd( qy, qy, L::mul( w, L::mul( qz, qz ) ) ) ), L::set( 1.0 ) );
+    const V disc = L::sub( L::mul( b, b ), L::mul( L::set( 4.0 * p.qa ), c ) );
+
+    const V s = L::div( L::sub( L::sqrt( L::max( disc, L::set( 0.0 ) ) ), b ), L::set( 2.0 * p.qa ) );
+    px = L::mulAdd( s, cosPhi0, qx );
+    py = qy;
+    pz = L::mulAdd( s, sinPhi0, qz );
+
+    return L::ge( disc, L::set( -8.0 * eps ) );
+}
+
+
+/*!
+ * \brief Longitude of a point of the Globe.
+ * \param[in] p Projection parameters.
+ * \param[in] px Geocentric coordinate towards projection center longitude on the equator.
+ * \param[in] py Geocentric coordinate towards 90 degrees east of it.
+ * \return Longitude in radians from -pi to pi.
+ */
+template<class L>
+typename L::V longitude( const OrthoParams& p, typename L::V px, typename L::V py )
+{
+    typename L::V lam = L::add( atan2<L>( py, px ), L::set( p.lam0 ) );
+    lam = L::select( L::gt( lam, L::set( pi ) ), L::sub( lam, L::set( 2.0 * pi ) ), lam );
+    return L::select( L::lt( lam, L::set( -pi ) ), L::add( lam, L::set( 2.0 * pi ) ), lam );
+}
+
+
+/*!
+ * \brief Inverted projection of one vector of points.
+ * \param[in] p Projection parameters.
+ * \param[in] x Projected meters along axis x.
+ * \param[in] y Projected meters along axis y.
+ * \param[out] lon Longitudes (HUGE_VAL if point is out of the Globe).
+ * \param[out] lat Latitudes (HUGE_VAL if point is out of the Globe).
+ * \return Number of points inside the Globe.
+ */
+template<class L>
+std::size_t inverseBlock( const OrthoParams& p, const double* x, const double* y, double* lon, double* lat )
+{
+    typedef typename L::V V;
+
+    V px;
+    V py;
+    V pz;
+    const typename L::M inside = globePoint<L>( p, x, y, px, py, pz );
+
+    const V rho = L::sqrt( L::mulAdd( px, px, L::mul( py, py ) ) );
+    const V phi = atan2<L>( pz, L::mul( L::set( 1.0 - p.e2 ), rho ) );
+    const V lam = longitude<L>( p, px, py );
+
+    const V far = L::set( HUGE_VAL );
+    L::store( lon, L::select( inside, L::mul( lam, L::set( radToDeg ) ), far ) );
+    L::store( lat, L::select( inside, L::mul( phi, L::set( radToDeg ) ), far ) );
+
+    return L::count( inside );
+}
+
+
+/*!
+ * \brief Inverted projection of one vector of points to Web Mercator.
+ *
+ * Sine of latitude comes straight from the point of the Globe, so only
+ * longitude needs an arctangent and Mercator ordinate needs a logarithm.
+ * \param[in] p Projection parameters.
+ * \param[in] x Projected meters along axis x.
+ * \param[in] y Projected meters along axis y.
+ * \param[out] mx Mercator abscissa from 0 (180 degrees west) to 1 (HUGE_VAL if point is off the map).
+ * \param[out] my Mercator ordinate from 0 (the north edge) to 1 (HUGE_VAL if point is off the map).
+ * \return Number of points on the map.
+ */
+template<class L>
+std::size_t mercatorBlock( const OrthoParams& p, const double* x, const double* y, double* mx, double* my )
+{
+    typedef typename L::V V;
+
+    V px;
+    V py;
+    V pz;
+    const typename L::M inside = globePoint<L>( p, x, y, px, py, pz );
+
+    const V one = L::set( 1.0 );
+    const V rho = L::mul( L::set( 1.0 - p.e2 ), L::sqrt( L::mulAdd( px, px, L::mul( py, py ) ) ) );
+    const V sinPhi = L::div( pz, L::sqrt( L::max( L::mulAdd( pz, pz, L::mul( rho, rho ) ), L::set( 1.0e-300 ) ) ) );
+    const V absSin = L::max( sinPhi, L::sub( L::set( 0.0 ), sinPhi ) );
+    const typename L::M onMap = L::land( inside, L::gt( L::set( mercatorSinLimit ), absSin ) );
+
+    // points off the map get a harmless argument of the logarithm
+    const V ratio = L::select( onMap, L::div( L::add( one, sinPhi ), L::sub( one, sinPhi ) ), one );
+    const V resX = L::mulAdd( longitude<L>( p, px, py ), L::set( 0.5 / pi ), L::set( 0.5 ) );
+    const V resY = L::sub( L::set( 0.5 ), L::mul( log<L>( ratio ), L::set( 0.25 / pi ) ) );
+
+    const V far = L::set( HUGE_VAL );
+    L::store( mx, L::select( onMap, resX, far ) );
+    L::store( my, L::select( onMap, resY, far ) );
+
+    return L::count( onMap );
+}
+
+
+/*!
+ * \brief Process arrays of points vector by vector.
+ *
+ * The last incomplete vector goes through a local buffer, so arrays
+ * of any length are never read or written out of bounds.
+ * Input and output arrays may be the same.
+ * \param[in] p Projection parameters.
+ * \param[in] inX Array of first input coordinates.
+ * \param[in] inY Array of second input coordinates.
+ * \param[out] outX Array of first output coordinates.
+ * \param[out] outY Array of second output coordinates.
+ * \param[in] count Number of points.
+ * \return Number of successfully processed points.
+ */
+template<class L, std::size_t ( *Block )( const OrthoParams&, const double*, const double*, double*, double* )>
+std::size_t run( const OrthoParams& p, const double* inX, const double* inY, double* outX, double* outY, std::size_t count )
+{
+    std::size_t res = 0;
+    std::size_t i = 0;
+
+    for ( ; i + L::width <= count; i += L::width )
+    {
+        res += Block( p, inX + i, inY + i, outX + i, outY + i );
+    }
+
+    if ( i < count )
+    {
+        double bufX[L::width];
+        double bufY[L::width];
+        const std::size_t rest = count - i;
+
+        for ( std::size_t k = 0; k < L::width; ++k )
+        {
+            bufX[k] = k < rest ? inX[i + k] : 0.0;
+            bufY[k] = k < rest ? inY[i + k] : 0.0;
+        }
+
+        Block( p, bufX, bufY, bufX, bufY );
+
+        for ( std::size_t k = 0; k < rest; ++k )
+        {
+            outX[i + k] = bufX[k];
+            outY[i + k] = bufY[k];
+            res += bufX[k] != HUGE_VAL ? 1 : 0;
+        }
+    }
+
+    return res;
+}
+
+
+#ifdef GV_ORTHO_AVX2
+
+//! Forward projection with AVX2 and FMA, defined in its own translation unit.
+std::size_t forwardAVX2( const OrthoParams&, const double* lon, const double* lat, double* x, double* y, std::size_t count );
+
+//! Inverted projection with AVX2 and FMA, defined in its own translation unit.
+std::size_t inverseAVX2( const OrthoParams&, const double* x, const double* y, double* lon, double* lat, std::size_t count );
+
+//! Inverted projection to Web Mercator with AVX2 and FMA, defined in its own translation unit.
+std::size_t mercatorAVX2( const OrthoParams&, const double* x, const double* y, double* mx, double* my, std::size_t count );
+
+#endif
+
+
+}
+
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+
+#include <proj.h>
+
+#include "OrthoKernel.h"
+
+
+namespace gv {
+
+
+/*!
+ * \brief Immutable orthographic projection with fixed center.
+ *
+ * Projection is a snapshot of projection parameters published by Projector.
+ * It never changes after construction, so any number of threads can use
+ * the same Projection simultaneously without locking. PROJ.4 objects cannot
+ * be shared between threads, hence every thread lazily creates its own
+ * PROJ.4 context and keeps a small cache of projections keyed by projection
+ * center. Center is quantized to the precision PROJ.4 definition keeps,
+ * and the definition is built only when a projection is not in the cache.
+ *
+ * As orthographic projection has a closed form, visibility checks are
+ * provided without PROJ.4. A point is visible if the dot product of its
+ * normal and the normal at projection center is not negative. Projecting
+ * itself is done by native OrthoKernel as long as its Earth model matches
+ * the one of PROJ.4, otherwise PROJ.4 is used.
+ */
+class Projection
+{
+public:
+    //! Closed form used instead of PROJ.4.
+    enum class ClosedForm
+    {
+        None,
+        Sphere,
+        Ellipsoid
+    };
+
+    Projection( double lon, double lat, ClosedForm );
+    ~Projection();
+
+    //! Forward projection converts geographic coordinates to meters.
+    bool projectFwd( double lon, double lat, double& x, double& y ) const;
+
+    //! Overload of forward projection.
+    std::tuple<bool, double, double> projectFwd( double lon, double lat ) const;
+
+    //! Inverted projection converts meters to geographic coordinates.
+    bool projectInv( double x, double y, double& lon, double& lat ) const;
+
+    //! Overload of inverted projection.
+    std::tuple<bool, double, double> projectInv( double x, double y ) const;
+
+    //! Forward projection of arrays of points in one call.
+    std::size_t projectFwd( const double* lon, const double* lat, double* x, double* y, std::size_t count ) const;
+
+    //! Inverted projection of arrays of points in one call.
+    std::size_t projectInv( const double* x, const double* y, double* lon, double* lat, std::size_t count ) const;
+
+    //! Inverted projection of arrays of points to normalized Web Mercator coordinates.
+    std::size_t projectInvMercator( const double* x, const double* y, double* mx, double* my, std::size_t count ) const;
+
+    //! Provide coordinates of projection center.
+    void projectionCenter( double& lon, double& lat ) const;
+
+    //! Overload for projectionCenter.
+    std::tuple<double,double> projectionCenter() const;
+
+    //! Check if a point is on the visible side of the Globe.
+    bool facing( double lon, double lat ) const;
+
+    //! Check if any point of geographic rectangle is on the visible side of the Globe.
+    bool facingArea( double lon0, double lat0, double lon1, double lat1 ) const;
+
+    //! Provide radius of the projected Globe (in meters).
+    double globeRadius() const;
+
+    //! Compare closed form projection with PROJ.4 results.
+    bool validateClosedForm() const;
+
+    //! Provide closed form used instead of PROJ.4.
+    ClosedForm closedForm() const;
+
+    //! Provide parameters of native orthographic projection.
+    const OrthoParams& orthoParams() const;
+
+private:
+    //! Provide PROJ.4 projection of the calling thread matching this Projection.
+    PJ* threadPJ() const;
+
+    //! Build PROJ.4 definition string.
+    std::string definition() const;
+
+    //! Transform arrays of points in place with PROJ.4 and mark failed points.
+    std::size_t transform( PJ_DIRECTION, double* x, double* y, std::size_t count ) const;
+
+    const std::int64_t keyLon_;         //!< Longitude of projection center (in millionths of a degree).
+    const std::int64_t keyLat_;         //!< Latitude of projection center (in millionths of a degree).
+
+    double projLon_;                    //!< Longitude of projection center.
+    double projLat_;                    //!< Latitude of projection center.
+    double lam0_;                       //!< Longitude of projection center (in radians).
+    double sinPhi0_;                    //!< Sine of latitude of projection center.
+    double cosPhi0_;                    //!< Cosine of latitude of projection center.
+    const ClosedForm closedForm_;       //!< Closed form used instead of PROJ.4.
+    const OrthoKernel kernel_;          //!< Native projection kernel.
+};
+
+
+}
@@ -1,9 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <mutex>
-#include <tuple>
 
-#include <proj.h>
+#include "Projection.h"
 
 
 namespace gv {
@@ -17,6 +18,18 @@ namespace gv {
  * usually meters. How projection is handled is no concern of the user.
  * Currently Projector is implemented with help of PROJ.4 library and
  * provides only one projection option (orthographic).
+ *
+ * Projector holds current Projection. Changing projection center publishes
+ * a new immutable Projection along with a new version, readers take the latest
+ * one and keep using it for as long as they need. Every thread caches the latest
+ * Projection it has taken with its version, so reading takes no lock unless
+ * the version has changed since, which happens once per thread per change.
+ * A computation using a single Projection sees a consistent projection center
+ * even if the center is changed meanwhile.
+ *
+ * Closed form projection is checked against PROJ.4 once on construction
+ * for both spherical and ellipsoidal Earth (PROJ.4 projects a sphere
+ * before version 7.2) and is used only if one of them agrees.
  */
 class Projector
 {
@@ -27,32 +40,14 @@ public:
     //! Set projection center at provided coordinates.
     void setProjectionAt( double lon, double lat );
 
-    //! Forward projection converts geographic coordinates to meters.
-    bool projectFwd( double lon, double lat, double& x, double& y ) const;
-    
-    //! Overload of forward projection.
-    std::tuple<bool, double, double> projectFwd( double lon, double lat ) const;
-
-    //! Inverted projection converts meters to geographic coordinates.
-    bool projectInv( double x, double y, double& lon, double& lat ) const;
-
-    //! Overload of inverted projection.
-    std::tuple<bool, double, double> projectInv( double x, double y ) const;
-
-    //! Provide coordinates of projection center.
-    void projectionCenter( double& lon, double& lat ) const;
-
-    //! Overload for projectionCenter.
-    std::tuple<double,double> projectionCenter() const;
+    //! Provide current projection.
+    std::shared_ptr<const Projection> projection() const;
 
 private:
-    PJ_CONTEXT* context_;       //!< PROJ.4 Context.
-    PJ* projection_;            //!< PROJ.4 projection.
-
-    double projLon_;            //!< Longitude of projection center.
-    double projLat_;            //!< Latitude of projection center.
-
-    mutable std::mutex mutex_;  //!< To make API thread safe.
+    mutable std::mutex mutex_;                      //!< Guards projection_.
+    std::shared_ptr<const Projection> projection_;  //!< Current projection.
+    std::atomic<unsigned long long> version_;       //!< Version of current projection, unique among all Projectors.
+    Projection::ClosedForm closedForm_;             //!< Closed form agreeing with PROJ.4.
 };
 
 
@@ -1,7 +1,9 @@
 ﻿#pragma once
 
+#include <atomic>
 #include <memory>
-#include <tuple>
+#include <string>
+#include <vector>
 
 #include <boost/signals2.hpp>
 
@@ -13,6 +15,10 @@
 namespace gv {
 
 
+class Projection;
+class Projector;
+
+
 namespace support {
     class Shader;
 }
@@ -21,11 +27,14 @@ namespace support {
 /*!
  * \brief Draws OpenGL entities that were marked for render.
  *
- * It simply requests all objects from DataKeeper and invokes couple of
- * OpenGL commands to draw as fast as possible. It doesn't do much, but
- * has a beneficial effect of keeping all relevant operations in one place,
- * so it's easier to maintain and control display of different parts of
- * the final image scene.
+ * Rendering data is pushed to Renderer when it changes: DataKeeper sends
+ * buffers of newly uploaded models and Viewport sends new OpenGL projection.
+ * Renderer keeps a draw list built from that data and display settings,
+ * it's rebuilt only when any of them changes. Rendering a frame just walks
+ * the list: shaders are switched only between calls using different ones
+ * and uniforms are uploaded only if their values differ from the ones
+ * the shader already has. So nothing is requested and nothing is sent
+ * again per frame unless it has changed.
  */
 class Renderer
 {
@@ -45,26 +54,77 @@ public:
     //! Turn rendering of map on or off.
     void setDrawMap( bool );
 
-    //! Request OpenGL projection.
-    boost::signals2::signal<glm::mat4()> getProjection;
+    //! Update OpenGL projection.
+    void updateProjection( glm::mat4 );
+
+    //! Update rendering data for wire-frame model of the Globe.
+    void updateWireGlobe( GLuint vao, GLsizei num, bool geographic );
+
+    //! Update rendering data for map.
+    void updateMapTiles( GLuint vao, GLuint tex, GLsizei num, GLenum type, bool geographic );
 
-    //! Request rendering data for simple triangle.
-    boost::signals2::signal<std::tuple<GLuint, GLsizei>()> renderSimpleTriangle;
+    //! Request for a value of units in one meter.
+    boost::signals2::signal<float()> getUnitInMeter;
 
-    //! Request rendering data for wire-frame model of the Globe.
-    boost::signals2::signal<std::tuple<GLuint, GLsizei>()> renderWireGlobe;
+    //! Request for pointer to Projector instance.
+    boost::signals2::signal<std::shared_ptr<Projector>()> getProjector;
 
-    //! Request rendering data for map.
-    boost::signals2::signal<std::tuple<GLuint, GLuint, GLsizei>()> renderMapTiles;
+    //! Signal that rendering settings have changed and a new frame is required.
+    boost::signals2::signal<void()> changed;
 
 private:
-    std::unique_ptr<support::Shader> shaderSimple_;     //!< Simple shader.
-    GLint ssProj_;                                      //!< Location of projection uniform in simple shader.
-    GLint ssColor_;                                     //!< Location of colour uniform in simple shader.
-    std::unique_ptr<support::Shader> shaderTexture_;    //!< Texture shader.
-    GLint stProj_;                                      //!< Location of projection uniform in texture shader.
-    GLint stSample_;                                    //!< Location of sample uniform in texture shader.
-    bool mapReady_;                                     //!< Indicator of map readiness for rendering.
+    //! Locations of uniforms of orthographic projection on the GPU.
+    struct GlobeUniforms
+    {
+        GLint geographic;   //!< Indicator of vertices being longitudes and latitudes.
+        GLint center;       //!< Projection center.
+        GLint earth;        //!< Earth model.
+    };
+
+    //! Shader and values of its uniforms uploaded last.
+    struct Program
+    {
+        std::unique_ptr<support::Shader> shader;    //!< Shader.
+        GLint proj;                                 //!< Location of projection uniform.
+        GlobeUniforms globe;                        //!< Locations of uniforms of orthographic projection.
+        unsigned long projVersion;                  //!< Version of OpenGL projection uploaded last.
+        int geographic;                             //!< Value of geographic uniform uploaded last, -1 if none.
+        std::shared_ptr<const Projection> projection;   //!< Projection which parameters were uploaded last.
+    };
+
+    //! Single draw call of the draw list.
+    struct DrawCall
+    {
+        Program* program;   //!< Shader to draw with.
+        GLuint vao;         //!< Vertex array object.
+        GLuint tex;         //!< Texture, 0 if none.
+        GLenum mode;        //!< Kind of primitives.
+        GLsizei num;        //!< Number of indices.
+        GLenum type;        //!< Type of indices.
+        bool geographic;    //!< Indicator of vertices being longitudes and latitudes.
+    };
+
+    //! Load shader and find locations of its uniforms.
+    static void loadProgram( Program&, const std::string& vert, const std::string& frag );
+
+    //! Rebuild the draw list from current rendering data and settings.
+    void buildDrawList();
+
+    //! Set uniforms of orthographic projection for the shader in use.
+    void setGlobeUniforms( Program&, bool geographic );
+
+    Program simple_;                                    //!< Simple shader.
+    Program texture_;                                   //!< Texture shader.
+    Program* current_;                                  //!< Shader in use.
+    std::shared_ptr<Projector> projector_;              //!< Pointer to Projector instance.
+    float unitInMeter_;                                 //!< GL units in one meter, 0 till requested.
+    glm::mat4 proj_;                                    //!< OpenGL projection.
+    unsigned long projVersion_;                         //!< Version of OpenGL projection, grows with every update.
+    DrawCall wire_;                                     //!< Draw call of wire-frame model of the Globe.
+    DrawCall map_;                                      //!< Draw call of map.
+    std::vector<DrawCall> drawList_;                    //!< Draw calls of a frame in order.
+    std::atomic<bool> listValid_;                       //!< Indicator of the draw list being up to date.
+    std::atomic<bool> mapReady_;                        //!< Indicator of map readiness for rendering.
     bool drawWires_;                                    //!< Indicator of requirement to draw wire-frame globe.
     bool drawMap_;                                      //!< Indicator of requirement to draw map.
 };
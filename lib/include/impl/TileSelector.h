@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Arena.h"
+#include "type/Tile.h"
+#include "type/ViewData.h"
+
+
+namespace gv {
+
+
+class Projection;
+
+
+/*!
+ * \brief Selects map tiles visible in the view.
+ *
+ * Starting from a tile known to be visible TileSelector walks its neighbours
+ * level by level. Every tile met is remembered in a hash set, so checking
+ * whether a tile has been already processed takes constant time. Visibility
+ * of a tile is decided by its corners and every corner is shared by four tiles,
+ * hence corners are projected only once per selection. Corners of the whole
+ * next level are gathered first and then projected in one pass.
+ *
+ * Alternatively tiles can be selected with different zoom levels. Then
+ * the world is walked as a quadtree starting from the only tile of zoom level 0.
+ * A visible tile is split into four tiles of the next level while its projected
+ * size on the screen is too large for its 256 pixels. Tiles close to the limb are
+ * foreshortened, so they stop splitting earlier than the ones close to
+ * projection center.
+ *
+ * Hash containers take memory from an arena released at the start of every
+ * selection and the result is kept in a reused vector, so once warmed up
+ * selections don't touch the heap.
+ *
+ * Apart from selection TileSelector provides conversion between geographic
+ * and tile coordinates.
+ */
+class TileSelector
+{
+public:
+    TileSelector();
+    ~TileSelector();
+
+    //! Find all map tiles that need to be requested for further processing.
+    const std::vector<TileHead>& select( const Projection&, const ViewData&, int z, int x, int y );
+
+    //! Find all visible map tiles choosing zoom level of every tile by its size on the screen.
+    const std::vector<TileHead>& selectLod( const Projection&, const ViewData&, int maxZ );
+
+    //! Convert longitude to tile coordinate x.
+    static int lonToTileX( double lon, int z );
+
+    //! Convert latitude to tile coordinate y.
+    static int latToTileY( double lat, int z );
+
+    //! Convert tile coordinate x to longitude.
+    static double tileXToLon( int x, int z );
+
+    //! Convert tile coordinate y to latitude.
+    static double tileYToLat( int y, int z );
+
+private:
+    //! Set of keys taking memory from arena.
+    using KeySet = std::unordered_set<std::uint64_t, std::hash<std::uint64_t>, std::equal_to<std::uint64_t>,
+        support::ArenaAllocator<std::uint64_t>>;
+
+    //! Map of keys to visibility taking memory from arena.
+    using CornerMap = std::unordered_map<std::uint64_t, bool, std::hash<std::uint64_t>, std::equal_to<std::uint64_t>,
+        support::ArenaAllocator<std::pair<const std::uint64_t, bool>>>;
+
+    //! Pack a pair of tile (or corner) coordinates into a single key.
+    static std::uint64_t key( int x, int y );
+
+    //! Project all not yet known corners of the tiles.
+    void projectCorners( const std::vector<TileHead>& );
+
+    //! Check if a tile is visible by its already projected corners.
+    bool tileVisible( const TileHead& ) const;
+
+    //! Estimate visibility and projected size (in meters) of a tile.
+    bool tileFootprint( const TileHead&, double& size );
+
+    //! Set view borders from viewport data.
+    void setView( const ViewData& );
+
+    const Projection* projection_;          //!< Projection of current selection.
+
+    int z_;                                 //!< Map zoom level of current selection.
+    double x0_;                             //!< Left border of the view (in meters).
+    double x1_;                             //!< Right border of the view (in meters).
+    double y0_;                             //!< Bottom border of the view (in meters).
+    double y1_;                             //!< Top border of the view (in meters).
+
+    support::Arena arena_;                              //!< Memory of hash containers, released every selection.
+    KeySet visited_;                                    //!< Tiles already met during selection.
+    CornerMap corners_;                                 //!< Corners visibility by their tile coordinates.
+    std::vector<TileHead> selected_;                    //!< Tiles chosen by the last selection.
+    std::vector<std::uint64_t> pending_;                //!< Corners waiting to be projected.
+    std::vector<double> cornerX_;                       //!< Geographic, then projected x of pending corners.
+    std::vector<double> cornerY_;                       //!< Geographic, then projected y of pending corners.
+    std::vector<TileHead> frontier_;                    //!< Visible tiles of the current level.
+    std::vector<TileHead> candidates_;                  //!< Tiles of the next level.
+    std::vector<TileHead> stack_;                       //!< Tiles waiting to be checked by quadtree selection.
+    std::vector<double> sampleX_;                       //!< Geographic, then projected x of tile samples (HUGE_VAL if invisible).
+    std::vector<double> sampleY_;                       //!< Geographic, then projected y of tile samples (HUGE_VAL if invisible).
+};
+
+
+}
@@ -2,11 +2,13 @@
 
 #include <map>
 #include <tuple>
+#include <vector>
 
 #include <boost/signals2.hpp>
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "InputQueue.h"
 #include "LoadGL.h"
 #include "type/ViewData.h"
 
@@ -42,6 +44,9 @@ public:
     
     //! Change scale.
     void zoom( int steps );
+
+    //! Move the viewport and change scale as merged input events did.
+    void moveZoom( const support::InputQueue::Delta& );
     
     //! Place point [0, 0] at the center of the viewport.
     void center();
@@ -64,7 +69,21 @@ public:
     //! Signal that the viewport has changed.
     boost::signals2::signal<void( ViewData )> viewUpdated;
 
+    //! Send OpenGL projection once it has changed.
+    boost::signals2::signal<void( glm::mat4 )> projectionUpdated;
+
 private:
+    //! Shift the viewport.
+    void pan( int x, int y );
+
+    //! Change units ratio.
+    bool scale( int steps );
+
+    //! Calculate all units ratios zooming goes through.
+    static std::vector<float> zoomScales();
+    //! Calculate index of units ratio after zooming.
+    int zoomed( int steps ) const;
+
     //! Recalculate OpenGL projection with current dimensions and scale.
     void setProjection();
 
@@ -81,6 +100,7 @@ private:
     float panY_;    //!< Panning by coordinate y (in GL units).
 
     static const float unitInMeter_;                //!< GL units in one meter.
+    int zoomStep_;                                  //!< Index of unitInPixel_ in zoomScales_.
     float unitInPixel_;                             //!< GL units in one pixel.
     float meterInPixel_;                            //!< Meters in one pixel.
 
@@ -89,6 +109,7 @@ private:
     static const float minUnitInPixel_;             //!< Minimum value of unitInPixel_.
     static const float maxUnitInPixel_;             //!< Maximum value of unitInPixel_.
     static const std::map<float, float> zoomMap_;   //!< Change of unitInPixel_ in one step depending on current zoom.
+    static const std::vector<float> zoomScales_;    //!< Values of unitInPixel_ for every zoom step.
 
     const GLfloat zNear_;                           //!< The nearest plane of frustum.
     const GLfloat zFar_;                            //!< The farthest plane of frustum.
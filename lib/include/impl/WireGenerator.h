@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/signals2.hpp>
+
+#include "BufferPool.h"
+#include "type/ViewData.h"
+#include "type/WireFrame.h"
+
+
+namespace gv {
+
+
+class Projection;
+class Projector;
+
+
+/*!
+ * \brief Composes wire-frame model of the Globe in a separate thread.
+ *
+ * Projecting circles of latitude and meridians takes a while, so it's done
+ * away from OpenGL thread, which only uploads finished models. Every request
+ * gets a generation number. A request still waiting when a newer one arrives
+ * is skipped, and every model is sent along with its generation, so the
+ * receiver can drop models older than the one it has.
+ *
+ * The graticule covers only the part of the Globe visible in the view and its
+ * spacing follows the scale: lines get denser while zooming in and sparser
+ * while zooming out, so the number of vertices stays about the same.
+ */
+class WireGenerator
+{
+public:
+    WireGenerator();
+    ~WireGenerator();
+
+    //! Initialize WireGenerator and compose the first model.
+    void init( ViewData );
+
+    //! Notification of rotating the Globe.
+    void updateGlobe();
+
+    //! Notification of updating viewport.
+    void updateViewData( ViewData );
+
+    //! Notification of switching between projecting on the CPU and on the GPU.
+    void updateGpuProjection( bool );
+
+    //! Request for pointer to Projector instance.
+    boost::signals2::signal<std::shared_ptr<Projector>()> getProjector;
+
+    //! Send new wire-frame model.
+    boost::signals2::signal<void( const WireFrame& )> updateWireGlobe;
+
+private:
+    //! Part of the graticule, longitudes and latitudes are in steps of segments.
+    struct Grid
+    {
+        double step;        //!< Length of a segment (in degrees), lines are ten segments apart, zero for empty part.
+        long long lon0;     //!< The westernmost longitude.
+        long long lon1;     //!< The easternmost longitude.
+        long long lat0;     //!< The southernmost latitude.
+        long long lat1;     //!< The northernmost latitude.
+        bool closed;        //!< Indicator of circles of latitude going around the Globe from lon0.
+
+        //! Equality operator.
+        bool operator==( const Grid& ) const;
+
+        //! Number of points of the graticule part.
+        std::size_t points() const;
+    };
+
+    //! Request a new model.
+    void request();
+
+    //! Find geographic rectangle covering the part of the Globe visible in the view.
+    bool visibleArea( const Projection&, const ViewData&, double& lon0, double& lon1, double& lat0, double& lat1 );
+
+    //! Choose the graticule part and its spacing for the visible area.
+    Grid chooseGrid( const ViewData&, double lon0, double lon1, double lat0, double lat1 ) const;
+
+    //! Generate points of circles of latitude and meridians and segments between them.
+    void composeGrid( const Grid& );
+
+    //! Calculate circles of latitude and meridians.
+    void composeWireGlobe( unsigned long generation );
+
+    boost::asio::io_context ioc_;           //!< Allows implementing task queue.
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_; //!< Provides work to ioc and doesn't let it stop.
+    std::vector<std::thread> threads_;      //!< Vector of worker thread.
+
+    std::shared_ptr<Projector> projector_;  //!< Pointer to Projector instance.
+    std::mutex mutexView_;                  //!< Guards newViewData_.
+    ViewData newViewData_;                  //!< Newly arrived viewport dimensions data.
+    std::atomic<bool> gpuProjection_;       //!< Indicator of composing geographic model projected on the GPU.
+    std::atomic<unsigned long> generation_; //!< Generation of the latest request.
+
+    bool composed_;                         //!< Indicator of a model being composed already.
+    bool geographic_;                       //!< Indicator of the latest model being geographic.
+    double composedLon_;                    //!< Longitude of projection center of the latest model.
+    double composedLat_;                    //!< Latitude of projection center of the latest model.
+    float composedUnitInMeter_;             //!< Units in one meter of the latest model.
+    Grid grid_;                             //!< Graticule part of the latest model.
+
+    std::vector<double> lons_;              //!< Longitudes of graticule points (in degrees).
+    std::vector<double> lats_;              //!< Latitudes of graticule points (in degrees).
+    std::vector<double> x_;                 //!< Projected coordinates x of graticule points (in meters).
+    std::vector<double> y_;                 //!< Projected coordinates y of graticule points (in meters).
+    std::vector<GLushort> visible_;         //!< Indices of visible graticule points among sent vertices.
+    std::vector<double> samplesX_;          //!< Coordinates x of view points sampled to find visible area.
+    std::vector<double> samplesY_;          //!< Coordinates y of view points sampled to find visible area.
+    std::shared_ptr<std::vector<GLushort>> segments_;       //!< Pairs of points of all graticule segments.
+    support::BufferPool<std::vector<GLfloat>> verticesPool_;    //!< Spare vertex buffers.
+    support::BufferPool<std::vector<GLushort>> indicesPool_;    //!< Spare index buffers.
+};
+
+
+}
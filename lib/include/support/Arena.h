@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \brief Monotonic memory arena for temporaries living not longer than some task.
+ *
+ * Memory is handed out from large blocks by moving a pointer and is never
+ * freed one allocation at a time. All of it is freed at once by release(),
+ * which keeps a single block large enough for everything allocated before.
+ * So once a repeated task has run, the next runs take no memory from the heap.
+ * Arena is not thread-safe.
+ */
+class Arena
+{
+public:
+    //! Create an arena with the size of the first block.
+    explicit Arena( std::size_t blockSize = 64 * 1024 );
+
+    Arena( const Arena& ) = delete;
+    Arena& operator=( const Arena& ) = delete;
+
+    //! Allocate memory.
+    void* allocate( std::size_t size, std::size_t alignment );
+
+    //! Free all memory allocated from the arena.
+    void release();
+
+private:
+    //! Add a new block able to fit an allocation.
+    void grow( std::size_t size );
+
+    //! Calculate padding before the next allocation.
+    std::size_t padding( std::size_t alignment ) const;
+
+    std::vector<std::unique_ptr<unsigned char[]>> blocks_;  //!< Memory blocks, the last one is being used.
+    std::size_t blockSize_;     //!< Size of the last block.
+    std::size_t total_;         //!< Total size of all blocks.
+    std::size_t offset_;        //!< Offset of free memory in the last block.
+};
+
+
+/*!
+ * \brief Standard allocator taking memory from Arena.
+ *
+ * Default constructed allocator has no arena and uses the heap, so containers
+ * with this allocator can be used as usual ones too. Allocator propagates
+ * with container contents, so moved containers keep taking memory from the same arena.
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    //! Allocator using the heap.
+    ArenaAllocator() noexcept : arena_( nullptr ) {}
+
+    //! Allocator using an arena.
+    ArenaAllocator( Arena* arena ) noexcept : arena_( arena ) {}
+
+    //! Allocator of another type using the same arena.
+    template <typename U>
+    ArenaAllocator( const ArenaAllocator<U>& rhs ) noexcept : arena_( rhs.arena() ) {}
+
+    //! Allocate memory for a number of objects.
+    T* allocate( std::size_t n )
+    {
+        return arena_
+            ? static_cast<T*>( arena_->allocate( n * sizeof( T ), alignof( T ) ) )
+            : std::allocator<T>().allocate( n );
+    }
+
+    //! Free memory, which is done by arena itself only at once.
+    void deallocate( T* p, std::size_t n ) noexcept
+    {
+        if ( !arena_ )
+        {
+            std::allocator<T>().deallocate( p, n );
+        }
+    }
+
+    //! Arena the memory is taken from.
+    Arena* arena() const noexcept { return arena_; }
+
+private:
+    Arena* arena_;      //!< Arena, the heap is used if there's none.
+};
+
+
+template <typename T, typename U>
+bool operator==( const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs ) noexcept
+{
+    return lhs.arena() == rhs.arena();
+}
+
+
+template <typename T, typename U>
+bool operator!=( const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs ) noexcept
+{
+    return lhs.arena() != rhs.arena();
+}
+
+
+}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \brief Pool of large buffers shared with other threads.
+ *
+ * Buffers which may still be referenced elsewhere are given back to the pool,
+ * and a buffer is handed out again once the pool holds its last reference.
+ * Contents and capacity of a buffer are kept, so memory is taken from the heap
+ * only while the pool warms up. Buffers are acquired and recycled by a single
+ * thread, other references may be released by any thread.
+ */
+template <typename T>
+class BufferPool
+{
+public:
+    //! Create a pool keeping a number of buffers at most.
+    explicit BufferPool( std::size_t capacity ) : capacity_( capacity )
+    {
+        items_.reserve( capacity_ );
+    }
+
+    //! Provide a buffer nobody else refers to.
+    std::shared_ptr<T> acquire()
+    {
+        for ( auto it = items_.begin(); it != items_.end(); ++it )
+        {
+            if ( it->use_count() == 1 )
+            {
+                // Pairs with release of the last other reference by another thread
+                std::atomic_thread_fence( std::memory_order_acquire );
+                auto res = std::move( *it );
+                items_.erase( it );
+                return res;
+            }
+        }
+
+        return std::make_shared<T>();
+    }
+
+    //! Give a buffer back to the pool, it may be still referenced elsewhere.
+    void recycle( std::shared_ptr<T> item )
+    {
+        if ( item && items_.size() < capacity_ )
+        {
+            items_.emplace_back( std::move( item ) );
+        }
+    }
+
+private:
+    std::size_t capacity_;                  //!< Maximum number of buffers kept.
+    std::vector<std::shared_ptr<T>> items_; //!< Buffers kept by the pool.
+};
+
+
+}
+}
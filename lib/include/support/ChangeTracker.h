@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \brief Tracks whether the displayed image is out of date.
+ *
+ * Changes are marked in the rendering thread, the mark is cleared when
+ * a frame picks them up. Any thread can check the mark or sleep until it's
+ * set, and a callback is called every time the image becomes out of date,
+ * so an idle host doesn't have to render or poll at all.
+ */
+class ChangeTracker
+{
+public:
+    //! The image is out of date from the start.
+    ChangeTracker();
+
+    //! Mark the image as out of date.
+    void mark();
+
+    //! Mark the image as up to date.
+    void clear();
+
+    //! Check if the image is out of date.
+    bool dirty() const;
+
+    //! Wait till the image is out of date, but not longer than timeout.
+    bool wait( std::chrono::milliseconds timeout );
+
+    //! Set a callable to be called once the image becomes out of date.
+    void setCallback( std::function<void()> );
+
+private:
+    mutable std::mutex mutex_;              //!< Guards all members.
+    std::condition_variable cv_;            //!< Wakes up waiting threads.
+    bool dirty_;                            //!< Indicator of the image being out of date.
+    std::function<void()> callback_;        //!< Called when the image becomes out of date.
+};
+
+
+}
+}
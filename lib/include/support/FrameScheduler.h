@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "type/FrameStats.h"
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \brief Keeps at most one frame waiting to be rendered.
+ *
+ * Requests come from any thread, rendering happens in a single one.
+ * A request made while a frame is pending is dropped instead of queuing
+ * another frame, so slow frames don't pile up behind each other.
+ * Rendered frames are timed against frame budget.
+ */
+class FrameScheduler
+{
+public:
+    //! Create the scheduler with a frame budget.
+    explicit FrameScheduler( std::chrono::microseconds budget );
+
+    //! Request a frame, true if it must be scheduled, false if it's dropped.
+    bool request();
+
+    //! Mark the pending frame as being rendered.
+    void begin();
+
+    //! Mark the frame being rendered as finished.
+    void end();
+
+    //! Frame statistics so far.
+    FrameStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    const Clock::duration budget_;              //!< Time from request to the end of rendering a frame may take.
+    std::atomic<bool> pending_;                 //!< Indicator of a frame waiting to be rendered.
+    std::atomic<Clock::rep> requestTime_;       //!< Time of request of the pending frame.
+    Clock::rep renderTime_;                     //!< Time of request of the frame being rendered.
+    std::atomic<std::uint64_t> requested_;      //!< Number of requests.
+    std::atomic<std::uint64_t> rendered_;       //!< Number of rendered frames.
+    std::atomic<std::uint64_t> dropped_;        //!< Number of dropped requests.
+    std::atomic<std::uint64_t> late_;           //!< Number of late frames.
+    std::atomic<Clock::rep> lastLatency_;       //!< Latency of the latest frame.
+    std::atomic<Clock::rep> maxLatency_;        //!< The longest latency.
+};
+
+
+}
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \brief Memory of a handler posted over and over again.
+ *
+ * A task which is posted again only once the previous one has started
+ * always fits the same memory, as io_context frees memory of a handler
+ * before calling it. Handlers bound by bindMemory() take memory from here,
+ * if it's in use or too small they take it from the heap.
+ */
+class HandlerMemory
+{
+public:
+    HandlerMemory();
+
+    HandlerMemory( const HandlerMemory& ) = delete;
+    HandlerMemory& operator=( const HandlerMemory& ) = delete;
+
+    //! Allocate memory.
+    void* allocate( std::size_t size );
+
+    //! Free memory.
+    void deallocate( void* p );
+
+private:
+    static const std::size_t capacity = 256;   //!< Size of storage_ (in bytes).
+
+    std::aligned_storage<capacity>::type storage_;  //!< Memory of a single handler.
+    std::atomic<bool> inUse_;                       //!< Indicator of storage_ being taken.
+};
+
+
+/*!
+ * \brief Standard allocator taking memory from HandlerMemory.
+ */
+template <typename T>
+class HandlerAllocator
+{
+public:
+    using value_type = T;
+
+    //! Allocator using handler memory.
+    explicit HandlerAllocator( HandlerMemory& memory ) noexcept : memory_( &memory ) {}
+
+    //! Allocator of another type using the same handler memory.
+    template <typename U>
+    HandlerAllocator( const HandlerAllocator<U>& rhs ) noexcept : memory_( rhs.memory() ) {}
+
+    //! Allocate memory for a number of objects.
+    T* allocate( std::size_t n )
+    {
+        return static_cast<T*>( memory_->allocate( n * sizeof( T ) ) );
+    }
+
+    //! Free memory.
+    void deallocate( T* p, std::size_t ) noexcept
+    {
+        memory_->deallocate( p );
+    }
+
+    //! Handler memory the memory is taken from.
+    HandlerMemory* memory() const noexcept { return memory_; }
+
+private:
+    HandlerMemory* memory_;     //!< Handler memory.
+};
+
+
+template <typename T, typename U>
+bool operator==( const HandlerAllocator<T>& lhs, const HandlerAllocator<U>& rhs ) noexcept
+{
+    return lhs.memory() == rhs.memory();
+}
+
+
+template <typename T, typename U>
+bool operator!=( const HandlerAllocator<T>& lhs, const HandlerAllocator<U>& rhs ) noexcept
+{
+    return lhs.memory() != rhs.memory();
+}
+
+
+/*!
+ * \brief Handler with an associated allocator taking memory from HandlerMemory.
+ */
+template <typename Handler>
+class MemoryHandler
+{
+public:
+    using allocator_type = HandlerAllocator<Handler>;
+
+    //! Wrap a handler.
+    MemoryHandler( HandlerMemory& memory, Handler handler )
+        : memory_( memory )
+        , handler_( std::move( handler ) )
+    {
+    }
+
+    //! Allocator used by io_context for the handler.
+    allocator_type get_allocator() const noexcept
+    {
+        return allocator_type( memory_ );
+    }
+
+    //! Call the handler.
+    template <typename... Args>
+    void operator()( Args&&... args )
+    {
+        handler_( std::forward<Args>( args )... );
+    }
+
+private:
+    HandlerMemory& memory_;     //!< Memory of the handler.
+    Handler handler_;           //!< Wrapped handler.
+};
+
+
+//! Make a handler take memory from handler memory.
+template <typename Handler>
+MemoryHandler<typename std::decay<Handler>::type> bindMemory( HandlerMemory& memory, Handler&& handler )
+{
+    return MemoryHandler<typename std::decay<Handler>::type>( memory, std::forward<Handler>( handler ) );
+}
+
+
+}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <EGL/egl.h>
+
+#include "LoadGL.h"
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \brief OpenGL context without any window.
+ *
+ * Uses EGL without surface (EGL_MESA_platform_surfaceless), so it works on
+ * machines without display and GPU with Mesa software rasterizer (llvmpipe)
+ * as well as with GPU drivers. There's no default framebuffer, rendering
+ * goes to a framebuffer object of the view size bound once it's created.
+ */
+class HeadlessContext
+{
+public:
+    //! Create OpenGL 3.3 core context.
+    HeadlessContext();
+    ~HeadlessContext();
+
+    //! Make the context current in the calling thread.
+    void makeCurrent() const;
+
+    //! Resize the framebuffer, the context must be current.
+    void resize( int w, int h );
+
+    //! Address of OpenGL function for loading them.
+    static void* procAddress( const char* name );
+
+private:
+    EGLDisplay display_;    //!< EGL display.
+    EGLContext context_;    //!< OpenGL context.
+    GLuint fbo_;            //!< Framebuffer object rendering goes to.
+    GLuint color_;          //!< Colour renderbuffer.
+    GLuint depth_;          //!< Depth renderbuffer.
+};
+
+
+}
+}
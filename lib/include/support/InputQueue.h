@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \brief Merges consecutive view input events into a single delta.
+ *
+ * Input comes from any thread and is applied in a single one. Instead of
+ * queuing every event, pan, zoom and rotate offsets are summed up in atomic
+ * counters until the consumer takes them, so any number of events between
+ * two takes costs the consumer a single update. Adding and taking never lock.
+ *
+ * Panning is measured in pixels, so its length in the view depends on the scale
+ * at the moment of the event. Hence panning is summed separately for every zoom
+ * level it happened at: the queue keeps zoom position (the sum of all zoom steps
+ * ever added) and panning goes into the slot of the current position. Applying
+ * every slot at its own scale gives the same view as applying the events one by one,
+ * as long as panning of a single take happens less than panLevels / 2 zoom steps
+ * away from the zoom position of the previous take and the scale doesn't hit its
+ * limits in between (summed zoom steps cancel each other before being clamped).
+ * Rotation is summed regardless of zoom and is applied at the resulting scale.
+ */
+class InputQueue
+{
+public:
+    //! Number of zoom levels panning is told apart at.
+    static const int panLevels = 16;
+
+    //! Sum of input events.
+    struct Delta
+    {
+        int zoom;                               //!< Number of zoom steps.
+        std::array<int, panLevels> moveX;       //!< Panning along x axis (in pixels), element i is done i - panLevels / 2 zoom steps away.
+        std::array<int, panLevels> moveY;       //!< Panning along y axis (in pixels), element i is done i - panLevels / 2 zoom steps away.
+        int rotateX;                            //!< Rotation along x axis (in pixels).
+        int rotateY;                            //!< Rotation along y axis (in pixels).
+
+        //! Check if there is any panning.
+        bool moved() const;
+    };
+
+    InputQueue();
+
+    //! Add panning, true if the consumer must be notified.
+    bool move( int x, int y );
+
+    //! Add zoom steps, true if the consumer must be notified.
+    bool zoom( int steps );
+
+    //! Add rotation, true if the consumer must be notified.
+    bool rotate( int x, int y );
+
+    //! Take everything added so far.
+    Delta take();
+
+private:
+    //! Mark the queue as having input, true if it was empty.
+    bool notify();
+
+    std::array<std::atomic<int>, panLevels> moveX_; //!< Panning along x axis not taken yet, by zoom position modulo panLevels.
+    std::array<std::atomic<int>, panLevels> moveY_; //!< Panning along y axis not taken yet, by zoom position modulo panLevels.
+    std::atomic<unsigned> zoomPosition_;            //!< Sum of all zoom steps added (wraps around).
+    unsigned takenPosition_;                        //!< Zoom position at the previous take.
+    std::atomic<int> rotateX_;      //!< Rotation along x axis not taken yet.
+    std::atomic<int> rotateY_;      //!< Rotation along y axis not taken yet.
+    std::atomic<bool> queued_;      //!< Indicator of input added since the consumer was notified.
+};
+
+
+}
+}
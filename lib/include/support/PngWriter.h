@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \brief Encodes RGB images as PNG.
+ *
+ * Every row is filtered by subtracting its left neighbour (PNG filter Sub),
+ * which makes smooth map areas compress better than raw rows at no noticeable
+ * cost. The whole image is compressed with zlib in one call, encoder buffers
+ * are kept between images.
+ */
+class PngWriter
+{
+public:
+    //! Create encoder with zlib compression level.
+    explicit PngWriter( int level );
+
+    //! Encode top-down RGB image into PNG in memory.
+    bool encode( const std::vector<unsigned char>& rgb, int width, int height, std::vector<unsigned char>& png );
+
+    //! Encode top-down RGB image and write it into PNG file.
+    bool write( const std::string& path, const std::vector<unsigned char>& rgb, int width, int height );
+
+private:
+    const int level_;                       //!< Compression level from 0 (none) to 9 (best).
+    std::vector<unsigned char> filtered_;   //!< Filtered rows, each starts with filter type.
+    std::vector<unsigned char> png_;        //!< Encoded image written into file.
+};
+
+
+}
+}
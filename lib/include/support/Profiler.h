@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <map>
 #include <iostream>
 #include <string>
@@ -15,7 +16,7 @@ namespace support {
 class Profiler
 {
 public:
-    Profiler( const std::string& name, bool print = false, std::ostream& = std::cout );
+    Profiler( const char* name, bool print = false, std::ostream& = std::cout );
     ~Profiler();
 
     static void printStatistics( std::ostream& = std::cout );
@@ -23,16 +24,16 @@ public:
     static std::string getStatistics();
 
 private:
-    static void addStatistic( const std::string&, int );
+    static void addStatistic( const char*, int );
     std::size_t currentMilli() const;
 
-    const std::string name_;
+    const char* name_;
     bool print_;
     std::ostream& out_;
     std::chrono::time_point<std::chrono::steady_clock> tick_;
 
-    // name -> (total time, count)
-    static std::map<std::string, std::pair<int, int>> map_;
+    // name -> (total time, count), looked up by name without making a string
+    static std::map<std::string, std::pair<int, int>, std::less<>> map_;
 };
 
 
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \brief Fixed set of threads running loops in parallel.
+ *
+ * Threads are created once and sleep between loops, so running a loop
+ * neither creates threads nor allocates memory. Iterations are handed out
+ * one by one through an atomic counter and the calling thread takes
+ * iterations too. A loop must be run by a single thread at a time.
+ */
+class WorkerPool
+{
+public:
+    //! Create the pool with a number of helper threads.
+    explicit WorkerPool( unsigned helpers );
+
+    //! Stop and join all helper threads.
+    ~WorkerPool();
+
+    //! Run job for every index from zero to count and wait until all of them are done.
+    void parallelFor( std::size_t count, const std::function<void( std::size_t )>& job );
+
+    //! Number of threads taking part in a loop.
+    std::size_t size() const;
+
+private:
+    //! Helper thread loop.
+    void work();
+
+    //! Take iterations of the current loop until there are none left.
+    void runJobs();
+
+    std::vector<std::thread> threads_;                  //!< Helper threads.
+    std::mutex mutex_;                                  //!< Guards loop state.
+    std::condition_variable wake_;                      //!< Wakes helpers up for a new loop.
+    std::condition_variable done_;                      //!< Notifies the caller that helpers are done.
+    const std::function<void( std::size_t )>* job_;     //!< Job of the current loop.
+    std::size_t count_;                                 //!< Number of iterations of the current loop.
+    std::atomic<std::size_t> next_;                     //!< Next iteration to take.
+    std::size_t busy_;                                  //!< Helpers still working on the current loop.
+    std::uint64_t loop_;                                //!< Number of the current loop.
+    bool stop_;                                         //!< Indicator of stopping helpers.
+};
+
+
+}
+}
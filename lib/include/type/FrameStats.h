@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace gv {
+
+
+/*!
+ * \brief Statistics of frames requested by GlobeViewer::render().
+ *
+ * A request made while another frame is still waiting to be rendered is
+ * dropped, the waiting frame shows the same state anyway. A frame is late
+ * if it's rendered later than frame budget after it was requested.
+ */
+struct FrameStats
+{
+    std::uint64_t requested;    //!< Number of render requests.
+    std::uint64_t rendered;     //!< Number of frames rendered.
+    std::uint64_t dropped;      //!< Number of requests merged into a pending frame.
+    std::uint64_t late;         //!< Number of frames rendered later than frame budget.
+    double lastLatency;         //!< Time from request to the end of rendering of the latest frame (in milliseconds).
+    double maxLatency;          //!< The longest time from request to the end of rendering (in milliseconds).
+};
+
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "type/MapGeometry.h"
+#include "type/MapStage.h"
+
+
+namespace gv {
+
+
+/*!
+ * \brief Map ready for rendering: geometry of tiles and texture they are drawn with.
+ *
+ * Frame does not own its data exclusively, it's shared with the frame
+ * producer, so passing a frame around never copies data. Frame can be moved
+ * but not copied, any other reference to the same data must be requested
+ * explicitly with share(). Data of a frame is never modified.
+ * A frame may also return the stage its texture data has been written into,
+ * the stage is meant for DataKeeper only.
+ */
+class MapFrame
+{
+public:
+    //! Default constructor makes an empty frame.
+    MapFrame() : w_( 0 ), h_( 0 ) {}
+
+    //! Construct a frame referring to existing data.
+    MapFrame( std::shared_ptr<const MapGeometry> geometry, std::shared_ptr<const std::vector<unsigned char>> data, int w, int h,
+        MapStage stage = MapStage() )
+        : geometry_( std::move( geometry ) ), data_( std::move( data ) ), w_( w ), h_( h ), stage_( stage ) {}
+
+    //! Frames cannot be copied.
+    MapFrame( const MapFrame& ) = delete;
+
+    //! Default move constructor.
+    MapFrame( MapFrame&& ) = default;
+
+    //! Frames cannot be copied.
+    MapFrame& operator=( const MapFrame& ) = delete;
+
+    //! Default move assignment operator.
+    MapFrame& operator=( MapFrame&& ) = default;
+
+    //! Make another frame referring to the same data.
+    MapFrame share() const { return MapFrame( geometry_, data_, w_, h_, stage_ ); }
+
+    //! Geometry of map tiles.
+    const std::shared_ptr<const MapGeometry>& geometry() const { return geometry_; }
+
+    //! Texture data (plain bytes).
+    const std::shared_ptr<const std::vector<unsigned char>>& data() const { return data_; }
+
+    //! Width of texture.
+    int width() const { return w_; }
+
+    //! Height of texture.
+    int height() const { return h_; }
+
+    //! Pixel buffer returned with the frame.
+    const MapStage& stage() const { return stage_; }
+
+private:
+    std::shared_ptr<const MapGeometry> geometry_;           //!< Geometry of map tiles.
+    std::shared_ptr<const std::vector<unsigned char>> data_; //!< Texture data.
+    int w_;                                                 //!< Width of texture.
+    int h_;                                                 //!< Height of texture.
+    MapStage stage_;                                        //!< Pixel buffer returned with the frame.
+};
+
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "LoadGL.h"
+
+
+namespace gv {
+
+
+//! Layout of a map vertex.
+enum class VertexFormat
+{
+    Float,      //!< Coordinates and texture coordinates are floats (16 bytes).
+    Packed      //!< Coordinates are floats, texture coordinates are normalized unsigned shorts (12 bytes).
+};
+
+
+/*!
+ * \brief Indexed geometry of map tiles.
+ *
+ * Every vertex has coordinates x and y (in GL units) as floats followed by
+ * texture coordinates in the layout given by format. Geographic geometry
+ * has longitude and latitude (in radians) instead of coordinates x and y,
+ * which are projected on the GPU. Vertices are shared by
+ * neighbouring triangles, which are listed by indices of their vertices.
+ * Indices are unsigned shorts as long as there are few enough vertices.
+ */
+struct MapGeometry
+{
+    VertexFormat format;                //!< Layout of vertices.
+    GLenum indexType;                   //!< Type of indices, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+    bool geographic;                    //!< Indicator of vertices being longitudes and latitudes.
+    std::vector<GLubyte> vertices;      //!< Vertices data.
+    std::vector<GLubyte> indices;       //!< Indices of triangle vertices.
+
+    //! Default constructor.
+    MapGeometry() : format( VertexFormat::Float ), indexType( GL_UNSIGNED_INT ), geographic( false ) {}
+
+    //! Size of a vertex (in bytes).
+    static std::size_t vertexSize( VertexFormat format )
+    {
+        return format == VertexFormat::Packed
+            ? 2 * sizeof( GLfloat ) + 2 * sizeof( GLushort )
+            : 4 * sizeof( GLfloat );
+    }
+
+    //! Size of an index (in bytes).
+    static std::size_t indexSize( GLenum type )
+    {
+        return type == GL_UNSIGNED_SHORT ? sizeof( GLushort ) : sizeof( GLuint );
+    }
+};
+
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace gv {
+
+
+/*!
+ * \brief Mapped pixel buffer the next map tiles texture is written into.
+ *
+ * DataKeeper maps the buffer in the OpenGL thread and hands it over to
+ * MapGenerator, which writes texture data into it in its own thread and
+ * returns it with the next MapFrame. Memory stays valid until DataKeeper
+ * gets the stage back, nobody else may touch it.
+ */
+struct MapStage
+{
+    unsigned char* data;    //!< Mapped memory, nullptr if there's no stage.
+    std::size_t size;       //!< Size of mapped memory (in bytes).
+    unsigned long serial;   //!< Number DataKeeper tells its stages apart with.
+    bool written;           //!< Indicator of texture data of the frame being written into the stage.
+
+    //! Default constructor makes an empty stage.
+    MapStage() : data( nullptr ), size( 0 ), serial( 0 ), written( false ) {}
+};
+
+
+}
@@ -1,14 +1,17 @@
 #pragma once
 
+#include <functional>
 #include <unordered_map>
 
+#include "Arena.h"
 #include "type/Tile.h"
 
 
 namespace gv {
 
-//! Maps tile header to tile body.
-using TileMap = std::unordered_map<TileHead, TileBody>;
+//! Maps tile header to tile body, memory may be taken from an arena.
+using TileMap = std::unordered_map<TileHead, TileBody, std::hash<TileHead>, std::equal_to<TileHead>,
+    support::ArenaAllocator<std::pair<const TileHead, TileBody>>>;
 
 }
 
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "LoadGL.h"
+
+
+namespace gv {
+
+
+/*!
+ * \brief Wire-frame model of the Globe ready for uploading.
+ *
+ * Each vertex is coordinates x and y (in GL units) or longitude and latitude
+ * (in radians) if the model is geographic. Lines are drawn as segments,
+ * indices list both ends of every segment. Vertices and indices are shared,
+ * never modified and copying a frame doesn't copy them.
+ */
+struct WireFrame
+{
+    std::shared_ptr<const std::vector<GLfloat>> vertices;   //!< Points of lines.
+    std::shared_ptr<const std::vector<GLushort>> indices;   //!< Pairs of points of line segments.
+    bool geographic;                                        //!< Indicator of vertices being longitudes and latitudes.
+    unsigned long generation;                               //!< Number of the request the model was composed for.
+};
+
+
+}
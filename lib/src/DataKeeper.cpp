@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstring>
 #include <stdexcept>
 #include <vector>
 
@@ -23,35 +24,27 @@ using namespace support;
 
 
 DataKeeper::DataKeeper()
-    : numST_( 0 )
-    , numWire_( 0 )
+    : numWire_( 0 )
+    , geoWire_( false )
+    , wireGeneration_( 0 )
     , numMap_( 0 )
+    , indexTypeMap_( GL_UNSIGNED_INT )
+    , formatMap_( VertexFormat::Float )
+    , geoMap_( false )
+    , frontUpload_( 0 )
+    , lastUpload_( 0 )
+    , serial_( 0 )
+    , stagedUpload_( mapUploads )
+    , stageSerial_( 0 )
     , rotatedLon_( 0.0 )
     , rotatedLat_( 0.0 )
 {
-    const GLfloat side = 100.0f;
-    const std::vector<GLfloat> stVerts =
-    {
-        -side, -side,
-        +side, -side,
-         0.0f, +side
-    };
-    numST_ = 3;
-
-    glGenVertexArrays( 1, &vaoST_ );
-    glGenBuffers( 1, &vboST_ );
-    glBindVertexArray( vaoST_ );
-    glBindBuffer( GL_ARRAY_BUFFER, vboST_ );
-    glBufferData( GL_ARRAY_BUFFER, sizeof( GLfloat ) * stVerts.size(), &stVerts[0], GL_STATIC_DRAW );
-    glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof( GLfloat ), ( void* )0 );
-    glEnableVertexAttribArray( 0 );
-    glBindBuffer( GL_ARRAY_BUFFER, 0 );
-    glBindVertexArray( 0 );
-
     glGenVertexArrays( 1, &vaoWire_ );
     glGenBuffers( 1, &vboWire_ );
+    glGenBuffers( 1, &eboWire_ );
     glBindVertexArray( vaoWire_ );
     glBindBuffer( GL_ARRAY_BUFFER, vboWire_ );
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, eboWire_ );
     glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof( GLfloat ), ( void* ) 0 );
     glEnableVertexAttribArray( 0 );
     glBindBuffer( GL_ARRAY_BUFFER, 0 );
@@ -59,22 +52,32 @@ DataKeeper::DataKeeper()
 
     glGenVertexArrays( 1, &vaoMap_ );
     glGenBuffers( 1, &vboMap_ );
+    glGenBuffers( 1, &eboMap_ );
     glBindVertexArray( vaoMap_ );
     glBindBuffer( GL_ARRAY_BUFFER, vboMap_ );
-    glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof( GLfloat ), ( void* ) 0 );
-    glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof( GLfloat ), ( void* ) ( 2 * sizeof( GLfloat ) ) );
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, eboMap_ );
+    setMapFormat( formatMap_ );
     glEnableVertexAttribArray( 0 );
     glEnableVertexAttribArray( 1 );
-    glBindBuffer( GL_ARRAY_BUFFER, 0 );
     glBindVertexArray( 0 );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
 
-    glGenTextures( 1, &texMap_ );
-    glBindTexture( GL_TEXTURE_2D, texMap_ );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    for ( auto& upload : uploads_ )
+    {
+        glGenBuffers( 1, &upload.pbo );
+        glGenTextures( 1, &upload.tex );
+        glBindTexture( GL_TEXTURE_2D, upload.tex );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+        upload.fence = nullptr;
+        upload.w = 0;
+        upload.h = 0;
+        upload.serial = 0;
+    }
     glBindTexture( GL_TEXTURE_2D, 0 );
+    texMap_ = uploads_[frontUpload_].tex;
 }
 
 
@@ -84,22 +87,10 @@ DataKeeper::~DataKeeper()
 
 
 /*!
- * Request necessary data for calling composeWireGlobe() so that there's the Globe
- * displayed right after start.
+ * Request necessary data for rotating the Globe.
  */
 void DataKeeper::init()
 {
-    auto optUnitInMeter = getUnitInMeter();
-
-    if ( !optUnitInMeter )
-    {
-        throw std::logic_error( "Cannot initialize DataKeeper: getUnitInMeter is not defined!" );
-    }
-    else
-    {
-        unitInMeter_ = *optUnitInMeter;
-    }
-
     if ( !getMeterInPixel() )
     {
         throw std::logic_error( "Cannot initialize DataKeeper: getMeterInPixel is not defined!" );
@@ -119,7 +110,6 @@ void DataKeeper::init()
         projector_ = *getProjector();
     }
 
-    composeWireGlobe();
 }
 
 
@@ -137,12 +127,13 @@ void DataKeeper::rotateGlobe( int pixelX, int pixelY )
     static const double stepLat = 0.05;
     double lon;
     double lat;
+    auto projection = projector_->projection();
 
-    if ( projector_->projectInv( pixelX * meterInPixel, pixelY * meterInPixel, lon, lat ) )
+    if ( projection->projectInv( pixelX * meterInPixel, pixelY * meterInPixel, lon, lat ) )
     {
         double projLon;
         double projLat;
-        projector_->projectionCenter( projLon, projLat );
+        projection->projectionCenter( projLon, projLat );
 
         const int signLon = pixelX < 0 ? 1 : -1;
         double diffLon = abs( lon - projLon );
@@ -188,8 +179,8 @@ void DataKeeper::rotateGlobe( int pixelX, int pixelY )
         if ( rotate )
         {
             projector_->setProjectionAt( newLon, newLat );
-            composeWireGlobe();
             globeRotated();
+            changed();
         }
     }
 }
@@ -201,8 +192,8 @@ void DataKeeper::rotateGlobe( int pixelX, int pixelY )
 void DataKeeper::balanceGlobe()
 {
     projector_->setProjectionAt( 0.0, 0.0 );
-    composeWireGlobe();
     globeRotated();
+    changed();
 }
 
 
@@ -219,155 +210,329 @@ void DataKeeper::centerAt( int x, int y )
     double lon;
     double lat;
 
-    if ( projector_->projectInv( metX, metY, lon, lat ) )
+    if ( projector_->projection()->projectInv( metX, metY, lon, lat ) )
     {
         projector_->setProjectionAt( lon, lat );
-        composeWireGlobe();
         globeRotated();
+        changed();
     }
 }
 
 
 /*!
- * \param[in] vecVbo Vertices to fill vertex buffer object for map tiles.
- * \param[in] w Texture width.
- * \param[in] h Texture height.
- * \param[in] vecData Texture data in memory.
+ * Models arrive from a worker thread in order of their generations.
+ * A model is dropped if a newer one has been uploaded already.
+ * \param[in] frame Wire-frame model of the Globe.
  */
-void DataKeeper::updateTexture( std::vector<GLfloat> vecVbo, int w, int h, std::vector<unsigned char> vecData )
+void DataKeeper::updateWireGlobe( const WireFrame& frame )
 {
-    glBindTexture( GL_TEXTURE_2D, texMap_ );
-    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, vecData.empty() ? nullptr : vecData.data() );
-    glBindTexture( GL_TEXTURE_2D, 0 );
+    if ( frame.generation <= wireGeneration_ )
+    {
+        return;
+    }
 
-    glBindBuffer( GL_ARRAY_BUFFER, vboMap_ );
-    glBufferData( GL_ARRAY_BUFFER, vecVbo.size() * sizeof( GLfloat ), vecVbo.empty() ? nullptr : &vecVbo[0], GL_STATIC_DRAW );
+    const auto& vec = *frame.vertices;
+    const auto& indices = *frame.indices;
+
+    glBindVertexArray( vaoWire_ );
+    glBindBuffer( GL_ARRAY_BUFFER, vboWire_ );
+    glBufferData( GL_ARRAY_BUFFER, vec.size() * sizeof( GLfloat ), vec.empty() ? nullptr : &vec[0], GL_STATIC_DRAW );
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof( GLushort ), indices.empty() ? nullptr : &indices[0], GL_STATIC_DRAW );
+    glBindVertexArray( 0 );
     glBindBuffer( GL_ARRAY_BUFFER, 0 );
-    numMap_ = vecVbo.size() / 4;
 
-    mapReady();
+    numWire_ = static_cast<GLsizei>( indices.size() );
+    geoWire_ = frame.geographic;
+    wireGeneration_ = frame.generation;
+
+    wireGlobeUpdated( vaoWire_, numWire_, geoWire_ );
+    changed();
 }
 
 
 /*!
- * \return Pair of values \n
- * (0) Vertex array object for Simple Triangle. \n
- * (1) Number of vertices for Simple Triangle.
+ * Texture data is transferred to a texture from a pixel buffer object
+ * asynchronously, so the call returns without waiting for the transfer.
+ * Normally MapGenerator has already written the data into the pixel buffer
+ * staged by the previous call, so it's only unmapped here. Otherwise (the first
+ * map, a larger texture) the data is copied to a pixel buffer here.
+ * The texture is displayed along with its geometry by swapMapTexture() once
+ * the transfer completes, till then the previous map stays on the screen.
+ * There are several textures in a ring, so a newer map can be uploaded while
+ * an older one is being transferred and another one is staged.
+ * Texture data of the frame is released right after it's copied, only geometry
+ * is kept till the texture is displayed.
+ * \param[in] frame Map tiles geometry and texture.
  */
-std::tuple<GLuint, GLsizei> DataKeeper::simpleTriangle() const
+void DataKeeper::updateTexture( MapFrame frame )
 {
-    return std::make_tuple( vaoST_, numST_ );
+    const int w = frame.width();
+    const int h = frame.height();
+    const auto& vecData = *frame.data();
+    const MapStage& stage = frame.stage();
+    const bool staged = stagedUpload_ < mapUploads && stage.data && stage.serial == stageSerial_;
+    const std::size_t index = staged ? stagedUpload_ : freeUpload();
+    auto& upload = uploads_[index];
+
+    if ( upload.fence )
+    {
+        // The upload is outdated by the new one
+        glDeleteSync( upload.fence );
+        upload.fence = nullptr;
+    }
+
+    const void* pixels = nullptr;
+    bool buffered = false;
+
+    if ( staged )
+    {
+        stagedUpload_ = mapUploads;
+        glBindBuffer( GL_PIXEL_UNPACK_BUFFER, upload.pbo );
+        buffered = glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER ) == GL_TRUE && stage.written;
+    }
+
+    if ( !buffered && !vecData.empty() )
+    {
+        // Orphaning lets the driver keep the old storage until pending transfer from it completes
+        glBindBuffer( GL_PIXEL_UNPACK_BUFFER, upload.pbo );
+        glBufferData( GL_PIXEL_UNPACK_BUFFER, vecData.size(), nullptr, GL_STREAM_DRAW );
+        void* mapped = glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, vecData.size(),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+
+        if ( mapped )
+        {
+            memcpy( mapped, vecData.data(), vecData.size() );
+        }
+
+        buffered = mapped && glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER ) == GL_TRUE;
+
+        if ( !buffered )
+        {
+            // Buffer contents are lost, so data goes directly from client memory
+            glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+            pixels = vecData.data();
+        }
+    }
+    else if ( !buffered )
+    {
+        glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+    }
+
+    glBindTexture( GL_TEXTURE_2D, upload.tex );
+
+    if ( upload.w == w && upload.h == h )
+    {
+        glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, pixels );
+    }
+    else
+    {
+        glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels );
+        upload.w = w;
+        upload.h = h;
+    }
+
+    glBindTexture( GL_TEXTURE_2D, 0 );
+    glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+    upload.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    glFlush();
+    upload.serial = ++serial_;
+    upload.geometry = frame.geometry();
+    lastUpload_ = index;
+
+    swapMapTexture();
+
+    if ( stagedUpload_ == mapUploads && !vecData.empty() )
+    {
+        stageUpload( vecData.size() );
+    }
+
+    if ( mapPending() )
+    {
+        // Only frames check transfers, so one is required to display the texture
+        changed();
+    }
 }
 
 
 /*!
- * \return Pair of values \n
- * (0) Vertex array object for wire-frame model of the Globe. \n
- * (1) Number of vertices for wire-frame model of the Globe.
+ * Textures are taken in turn after the one uploaded last, skipping
+ * the displayed one and the one which pixel buffer is handed over.
+ * \return Index of the texture in uploads_.
  */
-
-std::tuple<GLuint, GLsizei> DataKeeper::wireGlobe() const
+std::size_t DataKeeper::freeUpload() const
 {
-    return std::make_tuple( vaoWire_, numWire_ );
+    for ( std::size_t step = 1; step < mapUploads; ++step )
+    {
+        const std::size_t index = ( lastUpload_ + step ) % mapUploads;
+
+        if ( index != frontUpload_ && index != stagedUpload_ )
+        {
+            return index;
+        }
+    }
+
+    return lastUpload_;
 }
 
 
 /*!
- * \return Pair of values \n
- * (0) Vertex array object for map tiles. \n
- * (1) Number of vertices for map tiles.
+ * Pixel buffer of a free texture is mapped for writing and handed over via
+ * mapStaged, the next frame brings it back with texture data written into it.
+ * A pending transfer to the texture is dropped as the uploaded one is newer.
+ * Nothing is handed over if the buffer cannot be mapped.
+ * \param[in] size Size of texture data (in bytes) to map the buffer for.
  */
-std::tuple<GLuint, GLuint, GLsizei> DataKeeper::mapTiles() const
+void DataKeeper::stageUpload( std::size_t size )
 {
-    return std::make_tuple( vaoMap_, texMap_, numMap_ );
+    const std::size_t index = freeUpload();
+    auto& upload = uploads_[index];
+
+    if ( upload.fence )
+    {
+        glDeleteSync( upload.fence );
+        upload.fence = nullptr;
+        upload.geometry.reset();
+    }
+
+    glBindBuffer( GL_PIXEL_UNPACK_BUFFER, upload.pbo );
+    glBufferData( GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW );
+    void* mapped = glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+    glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+    if ( !mapped )
+    {
+        return;
+    }
+
+    MapStage stage;
+    stage.data = static_cast<unsigned char*>( mapped );
+    stage.size = size;
+    stage.serial = ++stageSerial_;
+    stagedUpload_ = index;
+    mapStaged( stage );
 }
 
 
 /*!
- * Requires direct access to Projector via pointer to speed up calculations.
- * To compose the whole globe one time it often requires to project around 20k
- * points. Multiply it by 30 - 60 frames to get projections in second
- * and you've got yourself a bottleneck. If the access to Projector is not direct,
- * for instance, via Boost.Signal2, performance becomes unacceptable.
+ * It's called before rendering every frame. Never waits for transfers,
+ * just checks their fences. Uploads older than the one displayed are dropped.
+ * Element buffer object is a part of vertex array object state, so it's
+ * filled while vertex array object is bound.
  */
-void DataKeeper::composeWireGlobe()
+void DataKeeper::swapMapTexture()
 {
-    Profiler prof( "DataKeeper::composeWireGlobe" );
-
-    static const float gapLon = 10.0f;
-    static const float gapLat = 10.0f;
-    static const float begLon = -180.0f;
-    static const float endLon = 180.0f;
-    static const float begLat = -80.0f;
-    static const float endLat = 80.0f;
-    static const int lons = static_cast<int>( std::round( ( endLon - begLon ) / gapLon + 1 ) );
-    static const int lats = static_cast<int>( std::round( ( endLat - begLat ) / gapLat + 1 ) );
-    static const float drawGapLon = 1.0f;
-    static const float drawGapLat = 1.0f;
-    static const int drawLons = static_cast<int>( std::round( ( endLon - begLon ) / drawGapLon + 1 ) );
-    static const int drawLats = static_cast<int>( std::round( ( endLat - begLat ) / drawGapLat + 1 ) );
-
-    std::vector<GLfloat> vec;
-
-    for ( int iLat = 0; iLat < lats; ++iLat )
+    std::size_t ready = frontUpload_;
+
+    for ( std::size_t i = 0; i < mapUploads; ++i )
     {
-        for ( int iLon = 0; iLon < drawLons - 1; ++iLon )
+        auto& upload = uploads_[i];
+
+        if ( !upload.fence )
         {
-            double x1;
-            double y1;
-
-            if ( !projector_->projectFwd( begLon + iLon * drawGapLon, begLat + iLat * gapLat, x1, y1 ) )
-            {
-                continue;
-            }
-
-            double x2;
-            double y2;
-
-            if ( !projector_->projectFwd( begLon + ( iLon + 1 )* drawGapLon, begLat + iLat * gapLat, x2, y2 ) )
-            {
-                continue;
-            }
-
-            vec.emplace_back( static_cast<GLfloat>( x1 * unitInMeter_ ) );
-            vec.emplace_back( static_cast<GLfloat>( y1 * unitInMeter_ ) );
-            vec.emplace_back( static_cast<GLfloat>( x2 * unitInMeter_ ) );
-            vec.emplace_back( static_cast<GLfloat>( y2 * unitInMeter_ ) );
+            continue;
+        }
+
+        if ( glClientWaitSync( upload.fence, 0, 0 ) == GL_TIMEOUT_EXPIRED )
+        {
+            continue;
+        }
+
+        glDeleteSync( upload.fence );
+        upload.fence = nullptr;
+
+        if ( upload.serial > uploads_[ready].serial )
+        {
+            ready = i;
         }
     }
 
-    for ( int iLon = 0; iLon < lons; ++iLon )
+    if ( ready == frontUpload_ )
     {
-        for ( int iLat = 0; iLat < drawLats - 1; ++iLat )
+        return;
+    }
+
+    frontUpload_ = ready;
+    auto& upload = uploads_[frontUpload_];
+    texMap_ = upload.tex;
+
+    for ( auto& older : uploads_ )
+    {
+        if ( older.fence && older.serial < upload.serial )
         {
-            double x1;
-            double y1;
-
-            if ( !projector_->projectFwd( begLon + iLon * gapLon, begLat + iLat * drawGapLat, x1, y1 ) )
-            {
-                continue;
-            }
-
-            double x2;
-            double y2;
-
-            if ( !projector_->projectFwd( begLon + iLon * gapLon, begLat + ( iLat + 1 )* drawGapLat, x2, y2 ) )
-            {
-                continue;
-            }
-
-            vec.emplace_back( static_cast<GLfloat>( x1 * unitInMeter_ ) );
-            vec.emplace_back( static_cast<GLfloat>( y1 * unitInMeter_ ) );
-            vec.emplace_back( static_cast<GLfloat>( x2 * unitInMeter_ ) );
-            vec.emplace_back( static_cast<GLfloat>( y2 * unitInMeter_ ) );
+            glDeleteSync( older.fence );
+            older.fence = nullptr;
         }
     }
 
-    glBindBuffer( GL_ARRAY_BUFFER, vboWire_ );
-    glBufferData( GL_ARRAY_BUFFER, vec.size() * sizeof( GLfloat ), vec.empty() ? nullptr : &vec[0], GL_STATIC_DRAW );
+    const auto geometry = std::move( upload.geometry );
+    upload.geometry.reset();
+    const auto& vertices = geometry->vertices;
+    const auto& indices = geometry->indices;
+
+    glBindVertexArray( vaoMap_ );
+    glBindBuffer( GL_ARRAY_BUFFER, vboMap_ );
+    glBufferData( GL_ARRAY_BUFFER, vertices.size(), vertices.empty() ? nullptr : vertices.data(), GL_STATIC_DRAW );
+
+    if ( geometry->format != formatMap_ )
+    {
+        formatMap_ = geometry->format;
+        setMapFormat( formatMap_ );
+    }
+
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.empty() ? nullptr : indices.data(), GL_STATIC_DRAW );
+    glBindVertexArray( 0 );
     glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    indexTypeMap_ = geometry->indexType;
+    geoMap_ = geometry->geographic;
+    numMap_ = static_cast<GLsizei>( indices.size() / MapGeometry::indexSize( indexTypeMap_ ) );
+
+    mapTilesUpdated( vaoMap_, texMap_, numMap_, indexTypeMap_, geoMap_ );
+    mapReady();
+    changed();
+}
+
 
-    numWire_ = vec.size();
+/*!
+ * Transfers are only checked by swapMapTexture(), so while this is true
+ * frames must keep coming to display the new texture once it's ready.
+ * \return True - some texture is being transferred, false - nothing to wait for.
+ */
+bool DataKeeper::mapPending() const
+{
+    for ( const auto& upload : uploads_ )
+    {
+        if ( upload.fence )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/*!
+ * Vertex array object for map tiles and vertex buffer object for map tiles
+ * must be bound. Coordinates are always floats, texture coordinates are either
+ * floats or normalized unsigned shorts.
+ * \param[in] format Layout of vertices.
+ */
+void DataKeeper::setMapFormat( VertexFormat format )
+{
+    const GLsizei stride = static_cast<GLsizei>( MapGeometry::vertexSize( format ) );
+    const void* texOffset = ( void* ) ( 2 * sizeof( GLfloat ) );
+
+    glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, stride, ( void* ) 0 );
+
+    if ( format == VertexFormat::Packed )
+    {
+        glVertexAttribPointer( 1, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, texOffset );
+    }
+    else
+    {
+        glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, stride, texOffset );
+    }
 }
 
 
@@ -0,0 +1,508 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Defines.h"
+#include "GlobeCompositor.h"
+#include "PngWriter.h"
+#include "Profiler.h"
+#include "Projection.h"
+#include "Projector.h"
+#include "stb_image.h"
+#include "TileManager.h"
+#include "TileSelector.h"
+#include "WorkerPool.h"
+
+
+using namespace gv::support;
+
+
+namespace {
+
+
+const int maxZoomLevel = 19;                    //!< The deepest map zoom level tile servers provide.
+const int bandsPerThread = 4;                   //!< Groups of rows composed in parallel per worker thread.
+const double fitMargin = 1.05;                  //!< Ratio of image side to the Globe diameter when the Globe is fitted.
+const unsigned char background[] = { 51, 76, 76 };  //!< Color of pixels off the map, the same as Renderer clear color.
+
+
+/*!
+ * \brief Sample tile pixel with bilinear filtering, as OpenGL does.
+ *
+ * Coordinates are fixed point with 8 fractional bits measured from tile
+ * edges, samples are clamped to the tile, rows of the tile are stored bottom-up.
+ * \param[in] tile Decoded RGB tile.
+ * \param[in] u Coordinate x of sample from the left edge of the tile.
+ * \param[in] v Coordinate y of sample from the top edge of the tile.
+ * \param[out] out RGB pixel.
+ */
+void sampleTile( const unsigned char* tile, int u, int v, unsigned char* out )
+{
+    const int side = defs::tileSide;
+    const int last = ( side - 1 ) << 8;
+
+    // pixel centers are in the middle of pixels
+    u = std::min( std::max( u - 128, 0 ), last );
+    v = std::min( std::max( v - 128, 0 ), last );
+
+    const int x0 = ( u >> 8 ) * 3;
+    const int x1 = std::min( ( u >> 8 ) + 1, side - 1 ) * 3;
+    const int y0 = v >> 8;
+    const int wx = u & 255;
+    const int wy = v & 255;
+
+    const unsigned char* r0 = tile + ( side - 1 - y0 ) * side * 3;
+    const unsigned char* r1 = tile + ( side - 1 - std::min( y0 + 1, side - 1 ) ) * side * 3;
+
+    for ( int c = 0; c < 3; ++c )
+    {
+        const int top = r0[x0 + c] * ( 256 - wx ) + r0[x1 + c] * wx;
+        const int bottom = r1[x0 + c] * ( 256 - wx ) + r1[x1 + c] * wx;
+        out[c] = static_cast<unsigned char>( ( top * ( 256 - wy ) + bottom * wy + 32768 ) >> 16 );
+    }
+}
+
+
+}
+
+
+namespace gv {
+
+
+/*!
+ * \brief Implementation of GlobeCompositor.
+ *
+ * The image is split into bands of interleaved rows, so every band gets its
+ * share of the Globe disk, and bands are composed in parallel. A row is projected
+ * back in one batch straight to Web Mercator coordinates of tiles, which goes
+ * through the vectorized closed form kernel, then every pixel is sampled from its tile. Decoded tiles are kept
+ * while they stay in sight, so consecutive images of nearby views fetch and decode
+ * only newly visible tiles.
+ */
+struct GlobeCompositor::Impl
+{
+public:
+    Impl( int width, int height );
+
+    //! Check and apply image size.
+    void setSize( int width, int height );
+
+    //! Viewport data of the image.
+    ViewData viewData( const Projection& ) const;
+
+    //! Make sure all the tiles are decoded and forget the rest.
+    void fetchTiles( const std::vector<TileHead>& );
+
+    //! Receiving new map tiles.
+    void getTiles( const std::vector<TileImage>& );
+
+    //! Compose a single row of the image.
+    void composeRow( const Projection&, const ViewData&, int row, double* x, double* y );
+
+    int width;                                  //!< Width of images.
+    int height;                                 //!< Height of images.
+    double meterInPixel;                        //!< Requested scale, zero to fit the Globe.
+    TileServer tileServer;                      //!< Current server of map tiles.
+
+    Projector projector;                        //!< Projects the globe to plane.
+    TileSelector selector;                      //!< Selects tiles visible in the image.
+    TileManager tileManager;                    //!< Downloads and caches map tiles from tile servers.
+    WorkerPool workers;                         //!< Threads composing bands of rows in parallel.
+    PngWriter pngWriter;                        //!< Encodes composed images.
+
+    std::unordered_map<TileHead, std::vector<unsigned char>> tiles;    //!< Decoded tiles of the latest image.
+    std::vector<TileImage> arrived;             //!< Tile images fetched for the current image.
+    std::vector<std::vector<unsigned char>> decoded;   //!< Decoded pixels of arrived tiles.
+    std::mutex mutexArrived;                    //!< Guards arrived and ready.
+    std::promise<void>* ready;                  //!< Set once requested tiles arrive.
+
+    std::vector<std::vector<double>> scratch;   //!< Coordinates x and y of a row, one buffer per band.
+    std::vector<unsigned char> image;           //!< The latest composed image.
+};
+
+
+/*!
+ * \param[in] w Width of images.
+ * \param[in] h Height of images.
+ */
+GlobeCompositor::Impl::Impl( int w, int h )
+    : meterInPixel( 0.0 )
+    , tileServer( TileServer::OSM )
+    , workers( std::max( 2u, std::thread::hardware_concurrency() ) - 1 )
+    , pngWriter( 1 )
+    , ready( nullptr )
+{
+    setSize( w, h );
+    scratch.resize( workers.size() * bandsPerThread );
+    tileManager.sendTiles.connect( std::bind( &GlobeCompositor::Impl::getTiles, this, std::placeholders::_1 ) );
+}
+
+
+/*!
+ * \param[in] w Width of images.
+ * \param[in] h Height of images.
+ * \exception std::logic_error If the size is not positive.
+ */
+void GlobeCompositor::Impl::setSize( int w, int h )
+{
+    if ( w <= 0 || h <= 0 )
+    {
+        throw std::logic_error( "Image size must be positive!" );
+    }
+
+    width = w;
+    height = h;
+}
+
+
+/*!
+ * The image is centered at projection center. Its GL units are meters.
+ * \param[in] projection Projection of the image.
+ * \return Viewport data.
+ */
+ViewData GlobeCompositor::Impl::viewData( const Projection& projection ) const
+{
+    const double mip = meterInPixel > 0.0
+        ? meterInPixel
+        : 2.0 * projection.globeRadius() * fitMargin / std::min( width, height );
+    const double tileNum = defs::earthRadius * 4 / mip / defs::tileSide;
+    const int zoom = static_cast<int>( std::round( std::log2( tileNum ) ) );
+    const float halfW = static_cast<float>( width * mip / 2 );
+    const float halfH = static_cast<float>( height * mip / 2 );
+
+    return ViewData{ 1.0f, static_cast<float>( mip ), std::min( std::max( zoom, 0 ), maxZoomLevel ),
+        -halfW, halfW, -halfH, halfH, width, height };
+}
+
+
+/*!
+ * Tiles missing from the previous image are requested from TileManager, which
+ * takes them from its cache or tile server, and the calling thread waits for them.
+ * They are decoded in parallel. Tiles that failed to arrive are left out,
+ * their part of the Globe gets background color.
+ * \param[in] heads Tiles visible in the image.
+ */
+void GlobeCompositor::Impl::fetchTiles( const std::vector<TileHead>& heads )
+{
+    Profiler prof( "GlobeCompositor::fetchTiles" );
+
+    const std::unordered_set<TileHead> visible( heads.begin(), heads.end() );
+
+    for ( auto it = tiles.begin(); it != tiles.end(); )
+    {
+        it = visible.count( it->first ) ? std::next( it ) : tiles.erase( it );
+    }
+
+    std::vector<TileHead> missing;
+
+    for ( const auto& head : heads )
+    {
+        if ( !tiles.count( head ) )
+        {
+            missing.push_back( head );
+        }
+    }
+
+    if ( missing.empty() )
+    {
+        return;
+    }
+
+    std::promise<void> promReady;
+
+    {
+        std::lock_guard<std::mutex> lock( mutexArrived );
+        arrived.clear();
+        ready = &promReady;
+    }
+
+    tileManager.requestTiles( missing, tileServer );
+    promReady.get_future().wait();
+
+    decoded.resize( arrived.size() );
+    stbi_set_flip_vertically_on_load( true );
+
+    workers.parallelFor( arrived.size(), [this]( std::size_t i )
+    {
+        const auto& data = arrived[i].data.data;
+        decoded[i].clear();
+
+        if ( data.empty() )
+        {
+            return;
+        }
+
+        int w;
+        int h;
+        int chans;
+        auto buffer = stbi_load_from_memory( &data[0], static_cast<int>( data.size() ), &w, &h, &chans, STBI_rgb );
+
+        if ( !buffer )
+        {
+            return;
+        }
+
+        if ( w == defs::tileSide && h == defs::tileSide )
+        {
+            decoded[i].assign( buffer, buffer + w * h * 3 );
+        }
+
+        stbi_image_free( buffer );
+    } );
+
+    for ( std::size_t i = 0; i < arrived.size(); ++i )
+    {
+        if ( !decoded[i].empty() )
+        {
+            tiles[arrived[i].head] = std::move( decoded[i] );
+        }
+    }
+}
+
+
+/*!
+ * Called from TileManager thread.
+ * \param[in] vec Fetched tile images.
+ */
+void GlobeCompositor::Impl::getTiles( const std::vector<TileImage>& vec )
+{
+    std::lock_guard<std::mutex> lock( mutexArrived );
+
+    if ( ready )
+    {
+        arrived = vec;
+        ready->set_value();
+        ready = nullptr;
+    }
+}
+
+
+/*!
+ * Only the chord of the Globe outline (with a pixel of margin, as the ellipsoid
+ * outline isn't exactly a circle) is projected, the rest of the row is background.
+ * \param[in] projection Projection of the image.
+ * \param[in] vd Viewport data of the image.
+ * \param[in] row Row number from the top.
+ * \param[in] x Buffer for coordinates x of the row.
+ * \param[in] y Buffer for coordinates y of the row.
+ */
+void GlobeCompositor::Impl::composeRow( const Projection& projection, const ViewData& vd, int row, double* x, double* y )
+{
+    unsigned char* out = &image[static_cast<std::size_t>( row ) * width * 3];
+
+    for ( int i = 0; i < width; ++i )
+    {
+        std::copy( background, background + 3, out + i * 3 );
+    }
+
+    const double mip = vd.meterInPixel;
+    const double metY = ( height * 0.5 - row - 0.5 ) * mip;
+    const double radius = projection.globeRadius() + mip;
+
+    if ( std::abs( metY ) >= radius )
+    {
+        return;
+    }
+
+    const double half = std::sqrt( radius * radius - metY * metY ) / mip;
+    const int i0 = std::max( 0, static_cast<int>( std::floor( width * 0.5 - half ) ) );
+    const int i1 = std::min( width, static_cast<int>( std::ceil( width * 0.5 + half ) ) );
+
+    if ( i0 >= i1 )
+    {
+        return;
+    }
+
+    const std::size_t count = i1 - i0;
+
+    for ( std::size_t k = 0; k < count; ++k )
+    {
+        x[k] = ( i0 + k + 0.5 - width * 0.5 ) * mip;
+        y[k] = metY;
+    }
+
+    projection.projectInvMercator( x, y, x, y, count );
+
+    const int z = vd.mapZoomLevel;
+    const int tileNum = 1 << z;
+    const long long tileSpan = defs::tileSide << 8;
+    const double mapSpan = static_cast<double>( tileSpan ) * tileNum;
+    const unsigned char* tile = nullptr;
+    int tileX = -1;
+    int tileY = -1;
+
+    for ( std::size_t k = 0; k < count; ++k )
+    {
+        if ( x[k] == HUGE_VAL )
+        {
+            continue;
+        }
+
+        // map pixels with 8 fractional bits from the north-west corner of the map
+        const long long u = static_cast<long long>( x[k] * mapSpan );
+        const long long v = static_cast<long long>( y[k] * mapSpan );
+        const int tx = std::min( std::max( static_cast<int>( u / tileSpan ), 0 ), tileNum - 1 );
+        const int ty = std::min( std::max( static_cast<int>( v / tileSpan ), 0 ), tileNum - 1 );
+
+        if ( tx != tileX || ty != tileY )
+        {
+            tileX = tx;
+            tileY = ty;
+            const auto it = tiles.find( TileHead( z, tx, ty ) );
+            tile = it == tiles.end() ? nullptr : it->second.data();
+        }
+
+        if ( tile )
+        {
+            sampleTile( tile, static_cast<int>( u - tx * tileSpan ), static_cast<int>( v - ty * tileSpan ), out + ( i0 + k ) * 3 );
+        }
+    }
+}
+
+
+/*!
+ * By default images are centered at [0, 0] and fit the whole Globe,
+ * tiles are taken from OpenStreetMap.
+ * \param[in] width Width of images (in pixels).
+ * \param[in] height Height of images (in pixels).
+ * \exception std::logic_error If the size is not positive.
+ */
+GlobeCompositor::GlobeCompositor( int width, int height )
+    : impl_( new GlobeCompositor::Impl( width, height ) )
+{
+}
+
+
+GlobeCompositor::~GlobeCompositor()
+{
+}
+
+
+/*!
+ * \param[in] width Width of images (in pixels).
+ * \param[in] height Height of images (in pixels).
+ * \exception std::logic_error If the size is not positive.
+ */
+void GlobeCompositor::resize( int width, int height )
+{
+    impl_->setSize( width, height );
+}
+
+
+/*!
+ * \param[in] ts Tile server identifier.
+ */
+void GlobeCompositor::setTileSource( TileServer ts )
+{
+    if ( ts != impl_->tileServer )
+    {
+        impl_->tileServer = ts;
+        impl_->tiles.clear();
+    }
+}
+
+
+/*!
+ * \param[in] lon Longitude (in degrees).
+ * \param[in] lat Latitude (in degrees).
+ */
+void GlobeCompositor::setProjectionCenter( double lon, double lat )
+{
+    impl_->projector.setProjectionAt( lon, lat );
+}
+
+
+/*!
+ * Map zoom level is chosen by the scale the same way GlobeViewer does.
+ * \param[in] meterInPixel Meters in one pixel, zero to fit the whole Globe.
+ */
+void GlobeCompositor::setMeterInPixel( double meterInPixel )
+{
+    impl_->meterInPixel = std::max( meterInPixel, 0.0 );
+}
+
+
+/*!
+ * Visible tiles are selected starting from the one at projection center,
+ * which is always in the middle of the image, fetched if needed, and
+ * then the rows are composed in parallel.
+ * \return Pixels of the image, valid till the next call.
+ */
+const std::vector<unsigned char>& GlobeCompositor::compose()
+{
+    Profiler prof( "GlobeCompositor::compose" );
+
+    auto& impl = *impl_;
+    const auto projection = impl.projector.projection();
+    const ViewData vd = impl.viewData( *projection );
+    const int z = vd.mapZoomLevel;
+
+    double lon;
+    double lat;
+    projection->projectionCenter( lon, lat );
+    lat = std::min( std::max( lat, -85.0 ), 85.0 );
+
+    impl.fetchTiles( impl.selector.select( *projection, vd, z,
+        TileSelector::lonToTileX( lon, z ), TileSelector::latToTileY( lat, z ) ) );
+
+    impl.image.resize( static_cast<std::size_t>( impl.width ) * impl.height * 3 );
+    const std::size_t bands = impl.scratch.size();
+
+    impl.workers.parallelFor( bands, [&impl, &projection, &vd, bands]( std::size_t band )
+    {
+        auto& buffer = impl.scratch[band];
+        buffer.resize( static_cast<std::size_t>( impl.width ) * 2 );
+
+        for ( std::size_t row = band; row < static_cast<std::size_t>( impl.height ); row += bands )
+        {
+            impl.composeRow( *projection, vd, static_cast<int>( row ), &buffer[0], &buffer[impl.width] );
+        }
+    } );
+
+    return impl.image;
+}
+
+
+/*!
+ * \param[out] png Encoded image.
+ * \return True - image is encoded, false - nothing is composed yet.
+ */
+bool GlobeCompositor::encodePng( std::vector<unsigned char>& png )
+{
+    Profiler prof( "GlobeCompositor::encodePng" );
+
+    return impl_->pngWriter.encode( impl_->image, impl_->width, impl_->height, png );
+}
+
+
+/*!
+ * \param[in] path File name.
+ * \return True - file is written, false - nothing is composed yet or writing failed.
+ */
+bool GlobeCompositor::savePng( const std::string& path )
+{
+    Profiler prof( "GlobeCompositor::savePng" );
+
+    return impl_->pngWriter.write( path, impl_->image, impl_->width, impl_->height );
+}
+
+
+int GlobeCompositor::width() const
+{
+    return impl_->width;
+}
+
+
+int GlobeCompositor::height() const
+{
+    return impl_->height;
+}
+
+
+}
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <fstream>
 #include <functional>
 #include <future>
@@ -7,18 +9,26 @@
 #include <thread>
 
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/executor_work_guard.hpp>
 #include <boost/signals2.hpp>
 
+#include "ChangeTracker.h"
 #include "DataKeeper.h"
 #include "Defines.h"
+#include "FrameScheduler.h"
 #include "GlobeViewer.h"
+#ifdef GV_HEADLESS
+#include "HeadlessContext.h"
+#endif
+#include "InputQueue.h"
 #include "MapGenerator.h"
 #include "Profiler.h"
 #include "Projector.h"
 #include "Renderer.h"
 #include "TileManager.h"
 #include "Viewport.h"
+#include "WireGenerator.h"
 
 
 using namespace boost::asio;
@@ -54,16 +64,28 @@ public:
     //! Initialize data.
     void initData();
 
+    //! Apply input merged since the previous call.
+    void applyInput();
+
     std::atomic<bool> valid;                    //!< Indicator of validity of Impl initialization.
 
+#ifdef GV_HEADLESS
+    std::unique_ptr<support::HeadlessContext> headless; //!< Offscreen context, empty if rendering to caller's context.
+#endif
+
     std::function<void()> makeCurrent;          //!< Callable that makes some OpenGL context current.
 
+    support::FrameScheduler frames;             //!< Keeps at most one frame waiting to be rendered.
+    support::InputQueue input;                  //!< Merges panning, zooming and rotating between updates.
+    support::ChangeTracker changes;             //!< Tracks whether the rendered image is out of date.
+
     std::shared_ptr<DataKeeper> dataKeeper;     //!< Keeps all OpenGL relative variables.
     std::shared_ptr<MapGenerator> mapGenerator; //!< Generates a single texture from map tiles.
     std::shared_ptr<Projector> projector;       //!< Projects the globe to plane.
     std::shared_ptr<Renderer> renderer;         //!< Renders all OpenGL entities.
     std::shared_ptr<TileManager> tileManager;   //!< Downloads and caches map tiles from tile servers.
     std::shared_ptr<Viewport> viewport;         //!< Calculates dimensions of the view.
+    std::shared_ptr<WireGenerator> wireGenerator;   //!< Composes wire-frame model of the Globe.
 
     boost::asio::io_context ioc;                //!< Allows implementing task queue.
     executor_work_guard<io_context::executor_type> work;    //!< Provides work to ioc and doesn't let it stop.
@@ -78,6 +100,7 @@ public:
 GlobeViewer::Impl::Impl( std::function<void()> func )
     : valid( false )
     , makeCurrent( func )
+    , frames( std::chrono::microseconds( defs::frameBudget ) )
     , ioc()
     , work( make_work_guard( ioc ) )
 {
@@ -112,7 +135,15 @@ GlobeViewer::Impl::~Impl()
 bool GlobeViewer::Impl::initGl() const
 {
     makeCurrent();
-    return gladLoadGL();
+
+#ifdef GV_HEADLESS
+    if ( headless )
+    {
+        return gladLoadGLLoader( &support::HeadlessContext::procAddress ) != 0;
+    }
+#endif
+
+    return gladLoadGL() != 0;
 }
 
 
@@ -130,43 +161,83 @@ void GlobeViewer::Impl::initData()
     renderer.reset( new Renderer() );
     tileManager.reset( new TileManager() );
     viewport.reset( new Viewport() );
+    wireGenerator.reset( new WireGenerator() );
 
     namespace ph = std::placeholders;
 
-    dataKeeper->getUnitInMeter.connect( std::bind( &Viewport::unitInMeter, viewport ) );
     dataKeeper->getMeterInPixel.connect( std::bind( &Viewport::meterInPixel, viewport ) );
     dataKeeper->getMetersAtPixel.connect( std::bind( &Viewport::metersAtPixel, viewport, ph::_1, ph::_2 ) );
     dataKeeper->getProjector.connect( [this]() -> auto { return projector; } );
     dataKeeper->globeRotated.connect( std::bind( &MapGenerator::updateGlobe, mapGenerator ) );
+    dataKeeper->globeRotated.connect( std::bind( &WireGenerator::updateGlobe, wireGenerator ) );
     dataKeeper->mapReady.connect( std::bind( &Renderer::setMapReady, renderer, true ) );
+    dataKeeper->changed.connect( [this] { changes.mark(); } );
+    dataKeeper->wireGlobeUpdated.connect( std::bind( &Renderer::updateWireGlobe, renderer, ph::_1, ph::_2, ph::_3 ) );
+    dataKeeper->mapTilesUpdated.connect( std::bind( &Renderer::updateMapTiles, renderer, ph::_1, ph::_2, ph::_3, ph::_4, ph::_5 ) );
+    dataKeeper->mapStaged.connect( std::bind( &MapGenerator::updateStage, mapGenerator, ph::_1 ) );
 
     viewport->viewUpdated.connect( std::bind( &MapGenerator::updateViewData, mapGenerator, ph::_1 ) );
+    viewport->viewUpdated.connect( std::bind( &WireGenerator::updateViewData, wireGenerator, ph::_1 ) );
+    viewport->viewUpdated.connect( [this]( ViewData ) { changes.mark(); } );
+    viewport->projectionUpdated.connect( std::bind( &Renderer::updateProjection, renderer, ph::_1 ) );
 
-    renderer->getProjection.connect( std::bind( &Viewport::projection, viewport ) );
-    renderer->renderSimpleTriangle.connect( std::bind( &DataKeeper::simpleTriangle, dataKeeper ) );
-    renderer->renderWireGlobe.connect( std::bind( &DataKeeper::wireGlobe, dataKeeper ) );
-    renderer->renderMapTiles.connect( std::bind( &DataKeeper::mapTiles, dataKeeper ) );
+    renderer->getUnitInMeter.connect( std::bind( &Viewport::unitInMeter, viewport ) );
+    renderer->getProjector.connect( [this]() -> auto { return projector; } );
+    renderer->changed.connect( [this] { changes.mark(); } );
 
     mapGenerator->getProjector.connect( [this]() -> auto { return projector; } );
     mapGenerator->requestTiles.connect( std::bind( &TileManager::requestTiles, tileManager, ph::_1, ph::_2 ) );
     mapGenerator->mapNotReady.connect( std::bind( &Renderer::setMapReady, renderer, false ) );
-    mapGenerator->updateMapTexture.connect( [this]( std::vector<GLfloat> vbo, int w, int h, std::vector<unsigned char> data )
+    mapGenerator->updateMapTexture.connect( [this]( const MapFrame& frame )
     {
-        ioc.post( [vbo, w, h, data, this]
+        // Unlike io_context::post(), free function accepts move-only handlers
+        boost::asio::post( ioc, [frame = frame.share(), this]() mutable
         {
-            dataKeeper->updateTexture( vbo, w, h, data );
+            dataKeeper->updateTexture( std::move( frame ) );
         } );
     } );
 
     tileManager->sendTiles.connect( std::bind( &MapGenerator::getTiles, mapGenerator, ph::_1 ) );
 
+    wireGenerator->getProjector.connect( [this]() -> auto { return projector; } );
+    wireGenerator->updateWireGlobe.connect( [this]( const WireFrame& frame )
+    {
+        ioc.post( [frame, this]
+        {
+            dataKeeper->updateWireGlobe( frame );
+        } );
+    } );
+
     dataKeeper->init();
+    renderer->updateProjection( viewport->projection() );
     mapGenerator->init( viewport->viewData() );
+    wireGenerator->init( viewport->viewData() );
 
     valid = true;
 }
 
 
+/*!
+ * Panning and zooming recalculate the view projection once, rotating
+ * rotates the Globe once, no matter how many input events were merged.
+ * Must be called in ioc thread.
+ */
+void GlobeViewer::Impl::applyInput()
+{
+    const auto delta = input.take();
+
+    if ( delta.moved() || delta.zoom != 0 )
+    {
+        viewport->moveZoom( delta );
+    }
+
+    if ( delta.rotateX != 0 || delta.rotateY != 0 )
+    {
+        dataKeeper->rotateGlobe( delta.rotateX, delta.rotateY );
+    }
+}
+
+
 /*!
  * Constructor must receive means to make current some OpenGL context.
  * \param[in] func A callable capable of making current some OpenGL context.
@@ -189,6 +260,52 @@ GlobeViewer::GlobeViewer( std::function<void()> func )
 }
 
 
+/*!
+ * Creates its own OpenGL context (EGL without surface), so it works without
+ * display, for instance, on servers with Mesa software rasterizer. Frames are
+ * rendered into a framebuffer of the given size, resize() changes it.
+ * \param[in] width Width of the view (in pixels).
+ * \param[in] height Height of the view (in pixels).
+ * \exception std::logic_error If GlobeViewer is built without headless rendering
+ * or the context cannot be created.
+ */
+GlobeViewer::GlobeViewer( int width, int height )
+    : impl_( new GlobeViewer::Impl( nullptr ) )
+{
+#ifdef GV_HEADLESS
+    impl_->headless.reset( new support::HeadlessContext() );
+    const auto headless = impl_->headless.get();
+    impl_->makeCurrent = [headless] { headless->makeCurrent(); };
+
+    std::promise<void> promInit;
+    impl_->ioc.post( [&promInit, this, width, height]
+    {
+        try
+        {
+            if ( !impl_->initGl() )
+            {
+                throw std::logic_error( "OpenGL initialization failed!" );
+            }
+
+            impl_->headless->resize( width, height );
+            impl_->initData();
+            impl_->viewport->resize( width, height );
+            promInit.set_value();
+        }
+        catch ( ... )
+        {
+            promInit.set_exception( std::current_exception() );
+        }
+    } );
+    promInit.get_future().get();
+#else
+    ( void ) width;
+    ( void ) height;
+    throw std::logic_error( "GlobeViewer is built without headless rendering!" );
+#endif
+}
+
+
 GlobeViewer::~GlobeViewer()
 {
 }
@@ -207,16 +324,131 @@ bool GlobeViewer::validSetup() const
 /*!
  * It must be called every time the view must be renewed.
  * It's often done by timer to get constant frame rate.
+ *
+ * At most one frame waits to be rendered. If the previous frame has not
+ * started rendering yet, the call is dropped since that frame will show
+ * the latest state anyway. So calling it in a tight loop doesn't queue
+ * frames behind slow ones.
+ *
+ * The frame picks up all changes made so far, needsRedraw() stays false
+ * till the next change.
  */
 void GlobeViewer::render()
 {
+    if ( !impl_->frames.request() )
+    {
+        return;
+    }
+
     impl_->ioc.post( [this] {
         if ( impl_ )
         {
+            impl_->frames.begin();
             impl_->makeCurrent();
+            impl_->applyInput();
+            impl_->dataKeeper->swapMapTexture();
+            impl_->changes.clear();
             impl_->renderer->render();
+
+            if ( impl_->dataKeeper->mapPending() )
+            {
+                // The next frame displays the texture once its transfer completes
+                impl_->changes.mark();
+            }
+
+            impl_->frames.end();
+        }
+    } );
+}
+
+
+/*!
+ * Waits till frames requested before are rendered and reads the view
+ * from the framebuffer OpenGL reads from: the offscreen one of headless
+ * GlobeViewer or the back buffer of the caller's context.
+ * \param[out] rgb Pixels of the view, three bytes (red, green, blue) per pixel,
+ * rows go from top to bottom.
+ * \param[out] width Width of the view (in pixels).
+ * \param[out] height Height of the view (in pixels).
+ */
+void GlobeViewer::readPixels( std::vector<unsigned char>& rgb, int& width, int& height )
+{
+    std::promise<void> promRead;
+    impl_->ioc.post( [&promRead, &rgb, &width, &height, this]
+    {
+        const auto vd = impl_->viewport->viewData();
+        const std::size_t row = 3 * static_cast<std::size_t>( vd.pixWidth );
+        width = vd.pixWidth;
+        height = vd.pixHeight;
+        rgb.resize( row * vd.pixHeight );
+
+        if ( !rgb.empty() )
+        {
+            glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+            glReadPixels( 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, rgb.data() );
+
+            // OpenGL rows go from bottom to top
+            for ( int y = 0; y < height / 2; ++y )
+            {
+                std::swap_ranges( rgb.begin() + y * row, rgb.begin() + ( y + 1 ) * row,
+                    rgb.begin() + ( height - 1 - y ) * row );
+            }
         }
+
+        promRead.set_value();
     } );
+    promRead.get_future().wait();
+}
+
+
+/*!
+ * Can be called from any thread. A frame is dropped if it's requested while
+ * another one is waiting to be rendered. A frame is late if it's rendered
+ * later than frame budget (defs::frameBudget) after it was requested.
+ * \return Statistics of frames since GlobeViewer creation.
+ */
+FrameStats GlobeViewer::frameStats() const
+{
+    return impl_->frames.stats();
+}
+
+
+/*!
+ * Can be called from any thread. The view changes when it's moved, zoomed
+ * or resized, when the Globe is rotated, when new map or wire-frame model
+ * arrives and when display settings are switched. A host that renders only
+ * when this is true doesn't spend anything while the view stays idle.
+ * \return True - the view has changed since the latest rendered frame, false - it's up to date.
+ */
+bool GlobeViewer::needsRedraw() const
+{
+    return impl_->changes.dirty();
+}
+
+
+/*!
+ * Blocks the calling thread till the view changes, so a host loop can sleep
+ * instead of rendering the same image over and over. Returns immediately
+ * if the view has changed already.
+ * \param[in] timeout The longest time to wait.
+ * \return True - the view has changed and must be rendered, false - timeout expired.
+ */
+bool GlobeViewer::waitForChange( std::chrono::milliseconds timeout )
+{
+    return impl_->changes.wait( timeout );
+}
+
+
+/*!
+ * Alternative to waitForChange() for hosts waiting for their own events:
+ * the callable can wake up the host loop. It's called in OpenGL thread once
+ * the view changes after a rendered frame, so it must be quick and must not
+ * wait for GlobeViewer.
+ * \param[in] func A callable or empty function to remove the previous one.
+ */
+void GlobeViewer::onChange( std::function<void()> func )
+{
+    impl_->changes.setCallback( std::move( func ) );
 }
 
 
@@ -231,6 +463,15 @@ void GlobeViewer::resize( int w, int h )
     impl_->ioc.post( [this, w, h] {
         if ( impl_ )
         {
+            impl_->applyInput();
+
+#ifdef GV_HEADLESS
+            if ( impl_->headless )
+            {
+                impl_->headless->resize( w, h );
+            }
+#endif
+
             impl_->viewport->resize( w, h );
         }
     } );
@@ -238,30 +479,42 @@ void GlobeViewer::resize( int w, int h )
 
 
 /*!
- * Panning view around {x, y} axises.
+ * Panning view around {x, y} axises. Offsets of calls made before
+ * the view is updated are summed up and applied at once.
  * \param[in] x Offset along x axis. Positive - move to the right, negative - move to the left. 
  * \param[in] y Offset along y axis. Positive - move up, negative - move down. 
  */
 void GlobeViewer::move( int x, int y )
 {
-    impl_->ioc.post( [this, x, y] {
+    if ( !impl_->input.move( x, y ) )
+    {
+        return;
+    }
+
+    impl_->ioc.post( [this] {
         if ( impl_ )
         {
-            impl_->viewport->move( x, y );
+            impl_->applyInput();
         }
     } );
 }
 
 
 /*!
+ * Steps of calls made before the view is updated are summed up and applied at once.
  * \param[in] steps Number of steps to zoom. Positive - zooming in, negative - zooming out.
  */
 void GlobeViewer::zoom( int steps )
 {
-    impl_->ioc.post( [this, steps] {
+    if ( !impl_->input.zoom( steps ) )
+    {
+        return;
+    }
+
+    impl_->ioc.post( [this] {
         if ( impl_ )
         {
-            impl_->viewport->zoom( steps );
+            impl_->applyInput();
         }
     } );
 }
@@ -275,6 +528,7 @@ void GlobeViewer::centerView()
     impl_->ioc.post( [this] {
         if ( impl_ )
         {
+            impl_->applyInput();
             impl_->viewport->center();
         }
     } );
@@ -290,6 +544,7 @@ void GlobeViewer::baseState()
     impl_->ioc.post( [this] {
         if ( impl_ )
         {
+            impl_->applyInput();
             impl_->dataKeeper->balanceGlobe();
         }
     } );
@@ -298,7 +553,8 @@ void GlobeViewer::baseState()
 
 /*!
  * Rotation degree in each direction is based on view pixel offset (set in this method)
- * and current Globe scale (changed in zoom method).
+ * and current Globe scale (changed in zoom method). Offsets of calls made before
+ * the Globe is updated are summed up and applied at once.
  * \param[in] x Positive - rotating right, negative - rotating left.
  * \param[in] y Positive - rotating up, negative - rotating down.
  *
@@ -308,10 +564,15 @@ void GlobeViewer::baseState()
  */
 void GlobeViewer::rotate( int x, int y )
 {
-    impl_->ioc.post( [this, x, y] {
+    if ( !impl_->input.rotate( x, y ) )
+    {
+        return;
+    }
+
+    impl_->ioc.post( [this] {
         if ( impl_ )
         {
-            impl_->dataKeeper->rotateGlobe( x, y );
+            impl_->applyInput();
         }
     } );
 }
@@ -329,6 +590,7 @@ void GlobeViewer::projectCenterAt( int x, int y )
     impl_->ioc.post( [this, x, y] {
         if ( impl_ )
         {
+            impl_->applyInput();
             impl_->dataKeeper->centerAt( x, y );
         }
     } );
@@ -379,6 +641,62 @@ void GlobeViewer::setMapTilesView( bool val )
 }
 
 
+/*!
+ * Mixed map zoom levels are on by default. Tiles far from projection center
+ * are foreshortened and get lower zoom level, so fewer tiles are downloaded.
+ * \param[in] val True - mixed map zoom levels, false - single map zoom level.
+ */
+void GlobeViewer::setTileLevelOfDetail( bool val )
+{
+    impl_->ioc.post( [this, val] {
+        if ( impl_ )
+        {
+            impl_->mapGenerator->updateTileLod( val );
+        }
+    } );
+}
+
+
+/*!
+ * Packed vertices are on by default. Texture coordinates take normalized
+ * unsigned shorts instead of floats, so every vertex takes 12 bytes instead of 16.
+ * \param[in] val True - packed texture coordinates, false - float texture coordinates.
+ */
+void GlobeViewer::setPackedVertices( bool val )
+{
+    impl_->ioc.post( [this, val] {
+        if ( impl_ )
+        {
+            impl_->mapGenerator->updatePackedVertices( val );
+        }
+    } );
+}
+
+
+/*!
+ * Projecting on the GPU is off by default. When it's on, map and wire-frame
+ * vertices are longitudes and latitudes projected by vertex shaders, so
+ * rotating the Globe only changes projection center and the map stays
+ * displayed while its texture is being regenerated.
+ * Shaders take vertices as 32-bit floats in radians and project them with
+ * float trigonometry, which is off by up to 3.5 meters on the Globe,
+ * less than a third of a pixel at map zoom level 13.
+ * Views zoomed in deeper than defs::gpuMaxZoom are projected on the CPU
+ * regardless of this setting.
+ * \param[in] val True - project on the GPU, false - project on the CPU.
+ */
+void GlobeViewer::setGpuProjection( bool val )
+{
+    impl_->ioc.post( [this, val] {
+        if ( impl_ )
+        {
+            impl_->wireGenerator->updateGpuProjection( val );
+            impl_->mapGenerator->updateGpuProjection( val );
+        }
+    } );
+}
+
+
 /*!
  * \warning Call this at the end of the main function if an instance of
  * GlobeViewer is a global variable. Otherwise it will conflict with
@@ -1,5 +1,10 @@
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <utility>
 
 #include "Defines.h"
 #include "LoadGL.h"
@@ -8,12 +13,82 @@
 #include "Projector.h"
 #include "stb_image.h"
 #include "ThreadSafePrinter.hpp"
+#include "TileSelector.h"
 
 
 using TSP = alt::ThreadSafePrinter<alt::MarkPolicy>;
 using namespace defs;
 
 
+namespace {
+
+
+const int meshDepth = 5;                                            //!< The deepest subdivision of a tile mesh into quarters.
+const int meshSide = 1 << meshDepth;                                //!< Cells along a side of a tile at the deepest subdivision.
+const int meshGrid = meshSide + 1;                                  //!< Grid points along a side of a tile at the deepest subdivision.
+const double meshTolerance = 0.5;                                   //!< Allowed deviation of a tile mesh from the Globe (in pixels).
+const double meshCellLon = 45.0;                                    //!< The widest mesh cell regardless of its deviation (in degrees).
+const double geoCellSpan = 2.0;                                     //!< The widest cell of geographic mesh (in degrees).
+const int horizonSteps = 12;                                        //!< Bisections of a cell side to find the horizon on it.
+const std::size_t maxCachedMeshes = 4096;                           //!< Number of tile meshes to keep before dropping the least recently used ones.
+const std::size_t keptMeshes = maxCachedMeshes * 3 / 4;             //!< Number of tile meshes left after dropping.
+const std::size_t spareMeshesKept = 64;                             //!< Number of buffers of dropped tile meshes kept for reuse.
+const std::size_t buffersPooled = 2;                                //!< Number of spare texture and geometry buffers kept for reuse.
+const std::chrono::seconds failedTileRetry( 30 );                   //!< Time before requesting a tile that failed again.
+
+
+/*!
+ * \param[in] lat Latitude.
+ * \return Mercator coordinate y of the latitude (in radians of the equator).
+ */
+double latToMercator( double lat )
+{
+    return std::log( std::tan( 0.25 * pi + 0.5 * lat * degToRad ) );
+}
+
+
+/*!
+ * \param[in] mer Mercator coordinate y (in radians of the equator).
+ * \return Latitude.
+ */
+double mercatorToLat( double mer )
+{
+    return std::atan( std::sinh( mer ) ) * radToDeg;
+}
+
+
+/*!
+ * \param[in] t Texture coordinate from 0 to 1.
+ * \return Texture coordinate as normalized unsigned short.
+ */
+GLushort packTexCoord( GLfloat t )
+{
+    return static_cast<GLushort>( std::lround( std::min( std::max( t, 0.0f ), 1.0f ) * 65535.0f ) );
+}
+
+
+/*!
+ * \param[in] x Column of a cell.
+ * \param[in] y Row of a cell.
+ * \return Position of the cell along Z-order curve.
+ */
+int mortonCode( int x, int y )
+{
+    int code = 0;
+
+    for ( int bit = 0; bit < meshDepth; ++bit )
+    {
+        code |= ( ( x >> bit ) & 1 ) << ( 2 * bit );
+        code |= ( ( y >> bit ) & 1 ) << ( 2 * bit + 1 );
+    }
+
+    return code;
+}
+
+
+}
+
+
 namespace gv {
 
 
@@ -21,8 +96,19 @@ using namespace support;
 
 
 MapGenerator::MapGenerator()
-    : ioc_()
+    : regenerationMemory_()
+    , ioc_()
     , work_( make_work_guard( ioc_ ) )
+    , workers_( std::max( 1u, std::min( 3u, std::thread::hardware_concurrency() - 1 ) ) )
+    , tileLod_( true )
+    , packedVertices_( true )
+    , gpuProjection_( false )
+    , geographic_( false )
+    , generation_( 0 )
+    , geometry_( std::make_shared<MapGeometry>() )
+    , data_( std::make_shared<std::vector<unsigned char>>() )
+    , geometryPool_( buffersPooled )
+    , dataPool_( buffersPooled )
     , active_( false )
     , pending_( false )
     , gotTiles_( false )
@@ -61,6 +147,7 @@ void MapGenerator::init( ViewData vd )
         projector_ = *getProjector();
     }
 
+    selector_.reset( new TileSelector() );
     newViewData_ = vd;
     viewData_ = vd;
     newTileServerType_ = TileServer::OSM;
@@ -70,10 +157,16 @@ void MapGenerator::init( ViewData vd )
 
 /*!
  * The Globe was rotated, hence map texture must be turned off as it became irrelevant.
+ * Geographic geometry projected on the GPU follows rotation by itself,
+ * so the map stays on while the texture is being regenerated.
  */
 void MapGenerator::updateGlobe()
 {
-    mapNotReady();
+    if ( !geographic_.load() )
+    {
+        mapNotReady();
+    }
+
     checkStates();
 }
 
@@ -102,15 +195,50 @@ void MapGenerator::updateTileServer( TileServer ts )
 }
 
 
+/*!
+ * Implements GlobeViewer::setTileLevelOfDetail.
+ * \param[in] val True - mixed map zoom levels, false - single map zoom level.
+ */
+void MapGenerator::updateTileLod( bool val )
+{
+    tileLod_.store( val );
+    checkStates();
+}
+
+
+/*!
+ * Implements GlobeViewer::setPackedVertices.
+ * \param[in] val True - texture coordinates are normalized unsigned shorts, false - floats.
+ */
+void MapGenerator::updatePackedVertices( bool val )
+{
+    packedVertices_.store( val );
+    checkStates();
+}
+
+
+/*!
+ * Implements GlobeViewer::setGpuProjection.
+ * \param[in] val True - project map on the GPU, false - project map on the CPU.
+ */
+void MapGenerator::updateGpuProjection( bool val )
+{
+    gpuProjection_.store( val );
+    checkStates();
+}
+
+
 /*!
  * In the end report that map tiles are ready and calls finalize.
+ * Only requested tiles arrive, the rest of the texture keeps pixels
+ * of tiles retained from the previous texture. Tiles that are empty or can't
+ * be decoded keep cleared pixels and aren't requested again till failedTileRetry
+ * passes or the tile server changes.
  * \param[in] vec Vector of TileImage containing header and bytes (data) for each
  * requested tile. Some or all tiles may be empty (data.size() == 0).
  */
 void MapGenerator::getTiles( const std::vector<TileImage>& vec )
 {
-    data_.clear();
-
     if ( vec.empty() )
     {
         gotTiles_.store( true );
@@ -118,30 +246,23 @@ void MapGenerator::getTiles( const std::vector<TileImage>& vec )
         return;
     }
 
-    int rowNum;
-    int colNum;
-    std::tie( colNum, rowNum ) = tileTex_.textureSize;
+    const int colNum = std::get<0>( tileTex_.textureSize );
     const int channels = 3;
     const int tileW = defs::tileSide * channels;
     const int texW = tileW * colNum;
 
-    data_.resize( defs::tileSide * tileW * rowNum * colNum, 0 );
-
     const auto& tiles = tileTex_.tiles;
+    auto& texData = writableData();
     int w;
     int h;
     int chans;
     stbi_set_flip_vertically_on_load( true );
 
+    const auto retry = std::chrono::steady_clock::now() + failedTileRetry;
+
     for ( const auto& ti : vec )
     {
         const auto& data = ti.data.data;
-
-        if ( data.empty() )
-        {
-            continue;
-        }
-
         auto it = tiles.find( ti.head );
 
         if ( it != tiles.end() )
@@ -149,14 +270,22 @@ void MapGenerator::getTiles( const std::vector<TileImage>& vec )
             const auto& row = it->second.row;
             const auto& col = it->second.col;
 
-            auto buffer = stbi_load_from_memory( &data[0], data.size(), &w, &h, &chans, STBI_rgb );
+            auto buffer = data.empty() ? nullptr : stbi_load_from_memory( &data[0], data.size(), &w, &h, &chans, STBI_rgb );
+
+            if ( !buffer )
+            {
+                failedTiles_[ti.head] = retry;
+                continue;
+            }
 
             for ( int i = 0; i < defs::tileSide; ++i )
             {
-                memcpy( &data_[( row * defs::tileSide + i ) * texW + col * tileW], &buffer[i * tileW], tileW );
+                memcpy( &texData[( row * defs::tileSide + i ) * texW + col * tileW], &buffer[i * tileW], tileW );
             }
             
             stbi_image_free( buffer );
+            loadedTiles_.emplace( ti.head );
+            failedTiles_.erase( ti.head );
         }
     }
 
@@ -165,6 +294,18 @@ void MapGenerator::getTiles( const std::vector<TileImage>& vec )
 }
 
 
+/*!
+ * Can be called from any thread. The stage belongs to MapGenerator until
+ * it's returned with a frame.
+ * \param[in] stage Mapped pixel buffer for the next texture.
+ */
+void MapGenerator::updateStage( MapStage stage )
+{
+    std::lock_guard<std::mutex> lock( mutexStage_ );
+    stage_ = stage;
+}
+
+
 /*!
  * If there's already an active request, mark pending_ true and exit.
  * Otherwise start generating new map texture.
@@ -181,7 +322,7 @@ void MapGenerator::checkStates()
     else
     {
         active_ = true;
-        ioc_.post( [this] { regenerateMap(); } );
+        postRegeneration();
     }
 }
 
@@ -189,140 +330,173 @@ void MapGenerator::checkStates()
 /*!
  * If there's a pending request, mark pending_ false and start generating
  * new map texture. Otherwise send results and mark active_ false.
+ * Texture data is written into the stage without holding the state, so new
+ * requests aren't blocked meanwhile. A request arriving during that is served
+ * right after the results are sent.
  */
 void MapGenerator::cleanupCheck()
 {
+    {
+        std::lock_guard<std::mutex> lock( mutexState_ );
+
+        if ( pending_ )
+        {
+            pending_ = false;
+            postRegeneration();
+            return;
+        }
+    }
+
+    int w = std::get<0>( tileTex_.textureSize ) * defs::tileSide;
+    int h = std::get<1>( tileTex_.textureSize ) * defs::tileSide;
+    updateMapTexture( MapFrame( geometry_, data_, w, h, stageTexture() ) );
+
     std::lock_guard<std::mutex> lock( mutexState_ );
 
     if ( pending_ )
     {
         pending_ = false;
-        ioc_.post( [this] { regenerateMap(); } );
+        postRegeneration();
     }
     else
     {
-        int w = std::get<0>( tileTex_.textureSize ) * defs::tileSide;
-        int h = std::get<1>( tileTex_.textureSize ) * defs::tileSide;
-        updateMapTexture( vbo_, w, h, data_ );
         active_ = false;
     }
 }
 
 
 /*!
- * Generates new map texture only for visible Globe as follows,
- * find all tiles to be processed and push them further to composeTileTexture.
+ * The stage is a pixel buffer DataKeeper has mapped, so writing texture data
+ * here leaves only unmapping and starting the transfer to the OpenGL thread.
+ * A stage too small for the texture is returned unused, DataKeeper copies
+ * the data itself then and maps a larger stage for the next texture.
+ * \return Stage with texture data, empty if DataKeeper hasn't provided one.
  */
-void MapGenerator::regenerateMap()
+MapStage MapGenerator::stageTexture()
 {
-    Profiler prof( "MapGenerator::regenerateMap" );
-
-    viewData_ = newViewData_;
-    tileServerType_ = newTileServerType_;
-
-    double lon;
-    double lat;
+    MapStage stage;
 
-    if ( !visiblePoint( lon, lat ) )
     {
-        cleanupCheck();
-        return;
+        std::lock_guard<std::mutex> lock( mutexStage_ );
+        std::swap( stage, stage_ );
     }
 
-    int mapZoomLevel = viewData_.mapZoomLevel;
-    int x = lonToTileX( lon, mapZoomLevel );
-    int y = latToTileY( lat, mapZoomLevel );
-
-    auto tiles = findTilesToProcess( mapZoomLevel, x, y );
+    if ( stage.data && !data_->empty() && data_->size() <= stage.size )
+    {
+        memcpy( stage.data, data_->data(), data_->size() );
+        stage.written = true;
+    }
 
-    composeTileTexture( tiles );
+    return stage;
 }
 
 
 /*!
- * \param[in] lon Longitude.
- * \param[in] z Map zoom level.
- * \return Tile coordinate x.
+ * States active_ and pending_ let a regeneration be posted only after
+ * the previous one has started, so it always takes the same memory.
  */
-int MapGenerator::lonToTileX( double lon, int z ) const
+void MapGenerator::postRegeneration()
 {
-    return static_cast<int>( std::floor( ( lon + 180.0 ) / 360.0 * std::pow( 2.0, z ) ) );
+    ioc_.post( support::bindMemory( regenerationMemory_, [this] { regenerateMap(); } ) );
 }
 
 
 /*!
- * \param[in] lat Latitude.
- * \param[in] z Map zoom level.
- * \return Tile coordinate y.
+ * Generates new map texture only for visible Globe as follows,
+ * find all tiles to be processed and push them further to composeTileTexture.
+ * Tiles are either of current map zoom level or of mixed levels not exceeding it.
+ * Changing tile server makes all tiles of the current texture irrelevant.
  */
-int MapGenerator::latToTileY( double lat, int z ) const
+void MapGenerator::regenerateMap()
 {
-    return static_cast<int>(
-        floor( ( 1.0 - log( tan( lat * degToRad ) + 1.0 / cos( lat * degToRad ) ) / pi ) /
-            2.0 * pow( 2.0, z ) ) );
-}
+    Profiler prof( "MapGenerator::regenerateMap" );
 
+    viewData_ = newViewData_;
+    projection_ = projector_->projection();
 
-/*!
- * \param[in] x Tile coordinate x.
- * \param[in] z Map zoom level.
- * \return Longitude.
- */
-double MapGenerator::tileXToLon( int x, int z ) const
-{
-    return x / pow( 2.0, z ) * 360.0 - 180;
-}
+    if ( tileServerType_ != newTileServerType_ )
+    {
+        tileServerType_ = newTileServerType_;
+        resetTileSet();
+    }
 
+    double lon;
+    double lat;
 
-/*!
- * \param[in] y Tile coordinate y.
- * \param[in] z Map zoom level.
- * \return Latitude.
- */
-double MapGenerator::tileYToLat( int y, int z ) const
-{
-    double n = pi - 2.0 * pi * y / std::pow( 2.0, z );
-    return 180.0 / pi * std::atan( 0.5 * ( std::exp( n ) - std::exp( -n ) ) );
+    if ( !visiblePoint( lon, lat ) )
+    {
+        composeTileTexture( {} );
+        return;
+    }
+
+    int mapZoomLevel = viewData_.mapZoomLevel;
+
+    if ( tileLod_.load() )
+    {
+        composeTileTexture( selector_->selectLod( *projection_, viewData_, mapZoomLevel ) );
+        return;
+    }
+
+    int x = TileSelector::lonToTileX( lon, mapZoomLevel );
+    int y = TileSelector::latToTileY( lat, mapZoomLevel );
+
+    const auto& tiles = selector_->select( *projection_, viewData_, mapZoomLevel, x, y );
+
+    composeTileTexture( tiles );
 }
 
 
 /*!
- * \param[in] lon Longitude.
- * \param[in] lat Latitude.
+ * The point of the view closest to the Globe center is found in closed form.
+ * If it's inside the projected Globe it's the point sought, otherwise
+ * no part of the Globe is visible. Its geographic coordinates are obtained
+ * by single inverted projection. Should that fail (the Globe outline is not
+ * exactly a circle for ellipsoidal projection) view borders are walked instead.
+ * \param[out] lon Longitude.
+ * \param[out] lat Latitude.
  * \return True - point is visible, false - point is not visible.
  */
 bool MapGenerator::visiblePoint( double& lon, double& lat )
 {
     Profiler prof( "MapGenerator::visiblePoint" );
 
-    double x0 = viewData_.glX0;
-    double x1 = viewData_.glX1;
-    double y0 = viewData_.glY0;
-    double y1 = viewData_.glY1;
-    float unitInMeter = viewData_.unitInMeter;
-    static const float unitLimit = static_cast<float>( defs::earthRadius * unitInMeter );
+    const double unitInMeter = viewData_.unitInMeter;
+    const double metX0 = viewData_.glX0 / unitInMeter;
+    const double metX1 = viewData_.glX1 / unitInMeter;
+    const double metY0 = viewData_.glY0 / unitInMeter;
+    const double metY1 = viewData_.glY1 / unitInMeter;
+
+    const double nearX = std::min( std::max( 0.0, metX0 ), metX1 );
+    const double nearY = std::min( std::max( 0.0, metY0 ), metY1 );
 
-    if ( unitLimit <= x0 || x1 <= -unitLimit || unitLimit <= y0 || y1 <= -unitLimit )
+    if ( projection_->globeRadius() - viewData_.meterInPixel <= std::hypot( nearX, nearY ) )
     {
         return false;
     }
 
-    static const double latLimit = 85.0;    // Safety measure, there are no tiles out of [-85.0511, +85.0511] latitude region
-    projector_->projectionCenter( lon, lat );
-
-    if ( x0 < -unitLimit && unitLimit < x1 && y0 < -unitLimit && unitLimit < y1 )
+    if ( !projection_->projectInv( nearX, nearY, lon, lat ) && !borderPoint( lon, lat ) )
     {
-        if ( std::abs( lat ) < latLimit )
-        {
-            return true;
-        }
-        else
-        {
-            lat = lat > 0 ? 85.0 : -85.0;
-            return true;
-        }
+        return false;
     }
 
+    static const double latLimit = 85.0;    // Safety measure, there are no tiles out of [-85.0511, +85.0511] latitude region
+    lat = std::min( std::max( lat, -latLimit ), latLimit );
+
+    return true;
+}
+
+
+/*!
+ * View borders are walked with 10 pixel step until a point inside the Globe is met.
+ * \param[out] lon Longitude.
+ * \param[out] lat Latitude.
+ * \return True - point is found, false - point is not found.
+ */
+bool MapGenerator::borderPoint( double& lon, double& lat )
+{
+    Profiler prof( "MapGenerator::borderPoint" );
+
+    float unitInMeter = viewData_.unitInMeter;
     static const int pixelStep = 10;
     const double meterStep = pixelStep * viewData_.meterInPixel;
     int pixelW = viewData_.pixWidth;
@@ -330,19 +504,19 @@ bool MapGenerator::visiblePoint( double& lon, double& lat )
     const int xNum = pixelW / pixelStep;
     const int yNum = pixelH / pixelStep;
 
-    double metX0 = x0 / unitInMeter;
-    double metX1 = x1 / unitInMeter;
-    double metY0 = y0 / unitInMeter;
-    double metY1 = y1 / unitInMeter;
+    double metX0 = viewData_.glX0 / unitInMeter;
+    double metX1 = viewData_.glX1 / unitInMeter;
+    double metY0 = viewData_.glY0 / unitInMeter;
+    double metY1 = viewData_.glY1 / unitInMeter;
 
     for ( int i = 0; i < xNum; ++i )
     {
-        if ( projector_->projectInv( metX0 + i * meterStep, metY0, lon, lat ) )
+        if ( projection_->projectInv( metX0 + i * meterStep, metY0, lon, lat ) )
         {
             return true;
         }
 
-        if ( projector_->projectInv( metX0 + i * meterStep, metY1, lon, lat ) )
+        if ( projection_->projectInv( metX0 + i * meterStep, metY1, lon, lat ) )
         {
             return true;
         }
@@ -350,12 +524,12 @@ bool MapGenerator::visiblePoint( double& lon, double& lat )
 
     for ( int i = 0; i < yNum; ++i )
     {
-        if ( projector_->projectInv( metX0, metY0 + i * meterStep, lon, lat ) )
+        if ( projection_->projectInv( metX0, metY0 + i * meterStep, lon, lat ) )
         {
             return true;
         }
 
-        if ( projector_->projectInv( metX1, metY0 + i * meterStep, lon, lat ) )
+        if ( projection_->projectInv( metX1, metY0 + i * meterStep, lon, lat ) )
         {
             return true;
         }
@@ -366,253 +540,946 @@ bool MapGenerator::visiblePoint( double& lon, double& lat )
 
 
 /*!
- * \param[in] z Map zoom level.
- * \param[in] x Tile coordinate x.
- * \param[in] y Tile coordinate y.
- * \return Vector of tile headers.
+ * Diffs new tile headers against the current texture. Tiles that are still
+ * visible keep their places, pixels and vertices. Tiles out of sight free their
+ * places for the newly visible ones. Only tiles that have no pixels yet are
+ * requested from the system, except the ones that failed recently. If there
+ * are none, no request is made at all.
+ * The texture is laid out anew only when the number of tiles exceeds its capacity
+ * or becomes much smaller than that. After processing calls vboFromTileTexture.
+ * \param[in] vec Vector of tile headers.
  */
-std::vector<TileHead> MapGenerator::findTilesToProcess( int z, int x, int y )
+void MapGenerator::composeTileTexture( const std::vector<TileHead>& vec )
 {
-    Profiler prof( "MapGenerator::findTilesToProcess" );
+    Profiler prof( "MapGenerator::composeTileTexture" );
+
+    // Tiles of the current texture live in the other arena
+    support::Arena& arena = arenas_[generation_++ % arenas_.size()];
+    arena.release();
+    TileMap kept{ TileMap::allocator_type( &arena ) };
+    std::vector<TileHead, support::ArenaAllocator<TileHead>> added( &arena );
+
+    for ( const auto& head : vec )
+    {
+        auto it = tileTex_.tiles.find( head );
+
+        if ( it != tileTex_.tiles.end() )
+        {
+            kept.emplace( head, it->second );
+        }
+        else
+        {
+            added.emplace_back( head );
+        }
+    }
+
+    int numX;
+    int numY;
+    std::tie( numX, numY ) = tileTex_.textureSize;
+
+    for ( const auto& tile : tileTex_.tiles )
+    {
+        if ( kept.find( tile.first ) == kept.end() )
+        {
+            loadedTiles_.erase( tile.first );
+            freeSlots_.emplace_back( tile.second.row * numX + tile.second.col );
+        }
+    }
 
-    std::vector<TileHead> res;
-    res.emplace_back( z, x, y );
+    const int tileCount = static_cast<int>( vec.size() );
+    const int capacity = numX * numY;
+
+    if ( capacity < tileCount || tileCount * 4 < capacity )
+    {
+        relayoutTexture( kept, tileCount );
+        numX = std::get<0>( tileTex_.textureSize );
+    }
 
-    std::vector<TileHead> vec[2];
-    const int maxInd = static_cast<int>( std::pow( 2, z ) - 1 );
-    int curr = 0;
-    int next = 0;
-    vec[0].emplace_back( z, x, y );
+    const int channels = 3;
+    const int tileW = defs::tileSide * channels;
+    const int texW = tileW * numX;
+    auto& texData = writableData();
 
-    while ( !vec[next].empty() )
+    for ( const auto& head : added )
     {
-        curr = next;
-        next = curr == 0 ? 1 : 0;
-        vec[next].clear();
+        const int slot = freeSlots_.back();
+        freeSlots_.pop_back();
+
+        TileBody body;
+        placeTile( head, body, slot / numX, slot % numX );
 
-        for ( std::size_t i = 0; i < vec[curr].size(); ++i )
+        for ( int i = 0; i < defs::tileSide; ++i )
         {
-            const auto& head = vec[curr][i];
-            decltype( res ) adj;
+            memset( &texData[( body.row * defs::tileSide + i ) * texW + body.col * tileW], 0, tileW );
+        }
 
-            if ( head.y < maxInd )
-            {
-                adj.emplace_back( head.z, head.x, head.y + 1 );
-            }
+        kept.emplace( head, std::move( body ) );
+    }
 
-            if ( head.y > 0 )
-            {
-                adj.emplace_back( head.z, head.x, head.y - 1 );
-            }
+    tileTex_.tileCount = tileCount;
+    tileTex_.tiles = std::move( kept );
 
-            adj.emplace_back( head.z, head.x == maxInd ? 0 : head.x + 1, head.y );
-            adj.emplace_back( head.z, head.x == 0 ? maxInd : head.x - 1, head.y );
+    std::vector<TileHead, support::ArenaAllocator<TileHead>> tileHeads( &arena );
 
-            for ( const auto& item : adj )
-            {
-                if ( std::find( res.begin(), res.end(), item ) != res.end() )
-                {
-                    continue;
-                }
+    if ( !failedTiles_.empty() )
+    {
+        const auto now = std::chrono::steady_clock::now();
 
-                res.emplace_back( item );
+        for ( auto it = failedTiles_.begin(); it != failedTiles_.end(); )
+        {
+            it = it->second <= now ? failedTiles_.erase( it ) : std::next( it );
+        }
+    }
 
-                if ( tileVisible( item ) )
-                {
-                    vec[next].emplace_back( item );
-                }
+    for ( const auto& head : vec )
+    {
+        if ( loadedTiles_.find( head ) == loadedTiles_.end() && failedTiles_.find( head ) == failedTiles_.end() )
+        {
+            tileHeads.emplace_back( head );
+        }
+    }
+
+    if ( tileHeads.empty() )
+    {
+        gotTiles_.store( true );
+    }
+    else
+    {
+        requestTiles( std::vector<TileHead>( tileHeads.begin(), tileHeads.end() ), tileServerType_ );
+    }
+
+    vboFromTileTexture( tileTex_ );
+}
+
+
+/*!
+ * Texture dimensions are calculated to keep it close to a square. Retained tiles
+ * get first places and take their pixels along, all other places are free.
+ * \param[in,out] kept Retained tiles, their bodies are updated with new places.
+ * \param[in] tileCount Total number of tiles the texture must fit.
+ */
+void MapGenerator::relayoutTexture( TileMap& kept, int tileCount )
+{
+    Profiler prof( "MapGenerator::relayoutTexture" );
+
+    const int channels = 3;
+    const int tileW = defs::tileSide * channels;
+    const int oldTexW = tileW * std::get<0>( tileTex_.textureSize );
+
+    const int numX = static_cast<int>( std::ceil( std::sqrt( tileCount ) ) );
+    const int numY = numX == 0 ? 0 : static_cast<int>( std::ceil( static_cast<double>( tileCount ) / numX ) );
+    const int texW = tileW * numX;
+    tileTex_.textureSize = std::make_tuple( numX, numY );
+
+    auto pooled = dataPool_.acquire();
+    auto& data = *pooled;
+    data.assign( defs::tileSide * texW * numY, 0 );
+    int slot = 0;
+
+    for ( auto& tile : kept )
+    {
+        const int row = slot / numX;
+        const int col = slot % numX;
+
+        if ( loadedTiles_.find( tile.first ) != loadedTiles_.end() )
+        {
+            const auto& body = tile.second;
+
+            for ( int i = 0; i < defs::tileSide; ++i )
+            {
+                memcpy( &data[( row * defs::tileSide + i ) * texW + col * tileW],
+                    &( *data_ )[( body.row * defs::tileSide + i ) * oldTexW + body.col * tileW], tileW );
             }
         }
+
+        placeTile( tile.first, tile.second, row, col );
+        ++slot;
     }
 
-    return res;
+    freeSlots_.clear();
+
+    for ( int i = numX * numY - 1; i >= slot; --i )
+    {
+        freeSlots_.emplace_back( i );
+    }
+
+    dataPool_.recycle( std::move( data_ ) );
+    data_ = std::move( pooled );
+}
+
+
+/*!
+ * \param[in] head Tile header.
+ * \param[out] body Tile body to fill.
+ * \param[in] row Row number in texture.
+ * \param[in] col Column number in texture.
+ */
+void MapGenerator::placeTile( const TileHead& head, TileBody& body, int row, int col ) const
+{
+    int numX;
+    int numY;
+    std::tie( numX, numY ) = tileTex_.textureSize;
+    const int sideX = numX * defs::tileSide;
+    const int sideY = numY * defs::tileSide;
+
+    body.lon0 = TileSelector::tileXToLon( head.x, head.z );
+    body.lon1 = TileSelector::tileXToLon( head.x + 1, head.z );
+    body.lat0 = TileSelector::tileYToLat( head.y + 1, head.z );
+    body.lat1 = TileSelector::tileYToLat( head.y, head.z );
+    const float tx = static_cast<float>( col * defs::tileSide );
+    const float ty = static_cast<float>( row * defs::tileSide );
+    body.tx0 = tx / static_cast<float>( sideX );
+    body.tx1 = ( tx + defs::tileSide ) / static_cast<float>( sideX );
+    body.ty0 = ty / static_cast<float>( sideY );
+    body.ty1 = ( ty + defs::tileSide ) / static_cast<float>( sideY );
+    body.row = row;
+    body.col = col;
 }
 
 
 /*!
- * \param[in] th Tile header.
- * \return True - tile is visible, false - tile is not visible.
+ * Next texture will be composed from scratch and all its tiles will be requested,
+ * including the ones the previous server failed to provide.
  */
-bool MapGenerator::tileVisible( TileHead th )
+void MapGenerator::resetTileSet()
 {
-    Profiler prof( "MapGenerator::tileVisible" );
+    tileTex_ = TileTexture();
+    loadedTiles_.clear();
+    failedTiles_.clear();
+    freeSlots_.clear();
+    dataPool_.recycle( std::move( data_ ) );
+    data_ = dataPool_.acquire();
+    data_->clear();
+}
+
+
+/*!
+ * Texture data is shared with frames sent for rendering. It's modified in place
+ * once all of them are released, otherwise it's copied first to a buffer
+ * from the pool.
+ * \return Texture data which can be modified.
+ */
+std::vector<unsigned char>& MapGenerator::writableData()
+{
+    if ( data_.use_count() > 1 )
+    {
+        auto data = dataPool_.acquire();
+        data->assign( data_->begin(), data_->end() );
+        dataPool_.recycle( std::move( data_ ) );
+        data_ = std::move( data );
+    }
+
+    // Pairs with release of the last frame by another thread
+    std::atomic_thread_fence( std::memory_order_acquire );
+    return *data_;
+}
+
+
+/*!
+ * Geometry is shared with frames sent for rendering. It's calculated anew
+ * every time, so it's never copied: its buffers are reused once all frames
+ * are released, otherwise geometry from the pool is taken.
+ * \return Geometry which can be modified.
+ */
+MapGeometry& MapGenerator::writableGeometry()
+{
+    if ( geometry_.use_count() > 1 )
+    {
+        geometryPool_.recycle( std::move( geometry_ ) );
+        geometry_ = geometryPool_.acquire();
+    }
+
+    std::atomic_thread_fence( std::memory_order_acquire );
+    return *geometry_;
+}
+
+
+/*!
+ * Projected geometry of a tile depends only on the tile, projection center
+ * and level of detail, so it's cached with texture coordinates relative to the tile.
+ * Panning, zooming within the same tiles and texture relayout reuse it as is,
+ * and so does returning to a former projection center. Geographic geometry
+ * projected on the GPU doesn't depend on projection center at all.
+ * Once there are more than maxCachedMeshes meshes, the least recently used
+ * ones are dropped down to keptMeshes and a few of them keep their buffers.
+ *
+ * Meshes of the tiles not in the cache are calculated in parallel, every tile
+ * writes into its own staging buffer, which keeps its capacity between calls.
+ * Then vertices and indices of map geometry are sized once and tiles are
+ * written into them in parallel at their offsets with their current places
+ * in the texture. Texture coordinates are packed into normalized unsigned
+ * shorts if packed vertices are on, and indices are unsigned shorts unless
+ * there are too many vertices. In the end report that vertex buffer object
+ * is ready and calls finalize.
+ * \param[in] tt Texture meta data.
+ */
+void MapGenerator::vboFromTileTexture( const TileTexture& tt )
+{
+    Profiler prof( "MapGenerator::vboFromTileTexture" );
 
-    double x0 = viewData_.glX0;
-    double x1 = viewData_.glX1;
-    double y0 = viewData_.glY0;
-    double y1 = viewData_.glY1;
-    float unitInMeter = viewData_.unitInMeter;
-    x0 /= unitInMeter;
-    x1 /= unitInMeter;
-    y0 /= unitInMeter;
-    y1 /= unitInMeter;
-
-    std::array<TileHead, 4> corners = { {
-        { th.z, th.x, th.y } , { th.z, th.x + 1, th.y },
-        { th.z, th.x, th.y + 1 }, { th.z, th.x + 1, th.y + 1 }
-        } };
-
-    double tx;
-    double ty;
     double lon;
     double lat;
+    projection_->projectionCenter( lon, lat );
+    const int detail = std::ilogb( viewData_.meterInPixel );
+    // Float radians are too coarse for the GPU to project deeper zoom levels
+    const bool geographic = gpuProjection_.load() && viewData_.mapZoomLevel <= defs::gpuMaxZoom;
 
-    for ( int i = 0; i < 4; ++i )
+    auto meshKey = [=]( const TileHead& head ) -> MeshKey
     {
-        lon = tileXToLon( corners[i].x, corners[i].z );
-        lat = tileYToLat( corners[i].y, corners[i].z );
+        return geographic ? MeshKey{ head, 0.0, 0.0, 0, true } : MeshKey{ head, lon, lat, detail, false };
+    };
 
-        if ( !projector_->projectFwd( lon, lat, tx, ty ) )
+    meshTiles_.clear();
+
+    for ( const auto& tile : tt.tiles )
+    {
+        if ( meshes_.find( meshKey( tile.first ) ) == meshes_.end() )
         {
-            continue;
+            meshTiles_.emplace_back( &tile );
         }
+    }
+
+    if ( meshStage_.size() < meshTiles_.size() )
+    {
+        meshStage_.resize( meshTiles_.size() );
+    }
 
-        if ( x0 < tx && tx < x1 && y0 < ty && ty < y1 )
+    workers_.parallelFor( meshTiles_.size(), [this, detail, geographic]( std::size_t i )
+    {
+        if ( geographic )
         {
-            return true;
+            geoTileMesh( meshTiles_[i]->second, meshStage_[i] );
+        }
+        else
+        {
+            tileMesh( meshTiles_[i]->second, detail, meshStage_[i] );
+        }
+    } );
+
+    for ( std::size_t i = 0; i < meshTiles_.size(); ++i )
+    {
+        // Stage keeps its buffers, cached mesh reuses buffers of an evicted one
+        auto& cached = meshes_[meshKey( meshTiles_[i]->first )];
+
+        if ( !spareMeshes_.empty() )
+        {
+            cached = std::move( spareMeshes_.back() );
+            spareMeshes_.pop_back();
         }
+
+        cached.vertices.assign( meshStage_[i].vertices.begin(), meshStage_[i].vertices.end() );
+        cached.indices.assign( meshStage_[i].indices.begin(), meshStage_[i].indices.end() );
     }
 
-    return false;
+    meshParts_.clear();
+    std::size_t vertexCount = 0;
+    std::size_t indexCount = 0;
+
+    for ( const auto& tile : tt.tiles )
+    {
+        auto& mesh = meshes_.find( meshKey( tile.first ) )->second;
+        mesh.used = generation_;
+        meshParts_.push_back( { &mesh, &tile.second, vertexCount, indexCount } );
+        vertexCount += mesh.vertices.size() / 4;
+        indexCount += mesh.indices.size();
+    }
+
+    MapGeometry& geometry = writableGeometry();
+    geometry.format = packedVertices_.load() ? VertexFormat::Packed : VertexFormat::Float;
+    geometry.geographic = geographic;
+    geographic_.store( geographic );
+    geometry.indexType = vertexCount <= std::numeric_limits<GLushort>::max() + std::size_t( 1 )
+        ? GL_UNSIGNED_SHORT
+        : GL_UNSIGNED_INT;
+    geometry.vertices.resize( vertexCount * MapGeometry::vertexSize( geometry.format ) );
+    geometry.indices.resize( indexCount * MapGeometry::indexSize( geometry.indexType ) );
+
+    workers_.parallelFor( meshParts_.size(), [this, &geometry]( std::size_t i )
+    {
+        const auto& part = meshParts_[i];
+        const TileBody& body = *part.body;
+        const float scaleX = body.tx1 - body.tx0;
+        const float scaleY = body.ty1 - body.ty0;
+        const auto& vertices = part.mesh->vertices;
+        const auto& indices = part.mesh->indices;
+        const std::size_t size = MapGeometry::vertexSize( geometry.format );
+        GLubyte* out = &geometry.vertices[part.vertex * size];
+
+        for ( std::size_t n = 0; n < vertices.size(); n += 4, out += size )
+        {
+            const GLfloat vertex[4] = {
+                vertices[n], vertices[n + 1],
+                body.tx0 + vertices[n + 2] * scaleX, body.ty0 + vertices[n + 3] * scaleY
+            };
+
+            if ( geometry.format == VertexFormat::Packed )
+            {
+                const GLushort tex[2] = { packTexCoord( vertex[2] ), packTexCoord( vertex[3] ) };
+                std::memcpy( out, vertex, 2 * sizeof( GLfloat ) );
+                std::memcpy( out + 2 * sizeof( GLfloat ), tex, sizeof( tex ) );
+            }
+            else
+            {
+                std::memcpy( out, vertex, sizeof( vertex ) );
+            }
+        }
+
+        const GLuint base = static_cast<GLuint>( part.vertex );
+        const std::size_t indexSize = MapGeometry::indexSize( geometry.indexType );
+        GLubyte* outIndex = &geometry.indices[part.index * indexSize];
+
+        for ( std::size_t n = 0; n < indices.size(); ++n, outIndex += indexSize )
+        {
+            const GLuint index = base + indices[n];
+            const GLushort shortIndex = static_cast<GLushort>( index );
+            std::memcpy( outIndex, indexSize == sizeof( GLushort ) ? ( const void* ) &shortIndex : &index, indexSize );
+        }
+    } );
+
+    if ( maxCachedMeshes < meshes_.size() )
+    {
+        evictMeshes();
+    }
+
+    calcedVbo_.store( true );
+    finalize();
 }
 
 
 /*!
- * After processing requests tiles from the system and calls vboFromTileTexture.
- * \param[in] vec Vector of tile headers.
+ * Meshes used by the current texture are never dropped, the rest are dropped
+ * in order of their last use. Meshes used as long ago as the last dropped one
+ * are dropped along with it.
  */
-void MapGenerator::composeTileTexture( const std::vector<TileHead>& vec )
+void MapGenerator::evictMeshes()
 {
-    Profiler prof( "MapGenerator::composeTileTexture" );
+    meshUses_.clear();
 
-    tileTex_.tileCount = vec.size();
-    const int numX = static_cast<int>( std::ceil( std::sqrt( tileTex_.tileCount ) ) );
-    const int numY = static_cast<int>( std::ceil( static_cast<double>( tileTex_.tileCount ) / numX ) );
-    const int sideX = numX * defs::tileSide;
-    const int sideY = numY * defs::tileSide;
-    tileTex_.textureSize = std::make_tuple( numX, numY );
-    tileTex_.tiles.clear();
+    for ( const auto& mesh : meshes_ )
+    {
+        meshUses_.push_back( mesh.second.used );
+    }
 
-    int row = 0;
-    int col = 0;
-    std::vector<TileHead> tileHeads;
+    const std::size_t dropped = meshes_.size() - keptMeshes;
+    std::nth_element( meshUses_.begin(), meshUses_.begin() + ( dropped - 1 ), meshUses_.end() );
+    const unsigned oldest = std::min( meshUses_[dropped - 1], generation_ - 1 );
 
-    for ( const auto& head : vec )
+    for ( auto it = meshes_.begin(); it != meshes_.end(); )
     {
-        tileHeads.emplace_back( head );
-        TileBody body;
-        body.lon0 = tileXToLon( head.x, head.z );
-        body.lon1 = tileXToLon( head.x + 1, head.z );
-        body.lat0 = tileYToLat( head.y + 1, head.z );
-        body.lat1 = tileYToLat( head.y, head.z );
-        const float tx = static_cast<float>( col * defs::tileSide );
-        const float ty = static_cast<float>( row * defs::tileSide );
-        body.tx0 = tx / static_cast<float>( sideX );
-        body.tx1 = ( tx + defs::tileSide ) / static_cast<float>( sideX );
-        body.ty0 = ty / static_cast<float>( sideY );
-        body.ty1 = ( ty + defs::tileSide ) / static_cast<float>( sideY );
-        body.row = row;
-        body.col = col;
-        tileTex_.tiles.emplace( std::move( head ), std::move( body ) );
+        if ( it->second.used > oldest )
+        {
+            ++it;
+            continue;
+        }
 
-        if ( ++col == numX )
+        if ( spareMeshes_.size() < spareMeshesKept )
         {
-            col= 0;
-            ++row;
+            spareMeshes_.emplace_back( std::move( it->second ) );
         }
-    }
 
-    requestTiles( tileHeads, tileServerType_ );
-    vboFromTileTexture( tileTex_ );
+        it = meshes_.erase( it );
+    }
 }
 
 
 /*!
- * In the end report that vertex buffer object is ready and calls finalize.
- * \param[in] tt Texture meta data.
+ * Tile is tessellated adaptively as a quadtree of cells in its texture space,
+ * so texture follows Mercator rows of the tile exactly. A cell is split into
+ * quarters while its projected edge midpoints and center deviate from
+ * the straight interpolation of its projected corners more than tolerance.
+ * Tolerance is a fraction of a pixel of the current zoom rounded down to
+ * a power of two, hence meshes can be cached per detail level.
+ *
+ * Cells crossing the horizon are split down to the deepest level and then
+ * clipped by it: invisible corners are replaced with the points of the cell
+ * sides where the horizon is found by bisection. Therefore the limb of the Globe
+ * is closed instead of being jagged by omitted cells. Cells on the far side
+ * are dropped as soon as the whole cell is known to be invisible.
+ *
+ * Cells are processed level by level, and all grid points required by a level
+ * are projected with a single call. Neighbouring cells of different size share
+ * grid points, so a larger cell gets the corners of its smaller neighbours on its
+ * sides and is split into a fan around its center to avoid cracks.
+ *
+ * Mesh is indexed: every grid point and every horizon point becomes a single
+ * vertex shared by all triangles around it. Leaves are emitted along Z-order
+ * curve and vertices are numbered in order of their first use, so consecutive
+ * triangles mostly reuse recent vertices.
+ * Texture coordinates are relative to the tile, from 0 to 1.
+ * Safe to call from several threads at once.
+ * \param[in] body Tile body.
+ * \param[in] detail Binary logarithm of tolerance (in meshTolerance pixels).
+ * \param[out] mesh Vertices and triangle indices of the tile.
  */
-void MapGenerator::vboFromTileTexture( TileTexture tt )
+void MapGenerator::tileMesh( const TileBody& body, int detail, TileMesh& mesh ) const
 {
-    static const int chunks = 10;
+    //! Square cell of the quadtree (in the deepest cells).
+    struct Cell
+    {
+        int x;          //!< Left column.
+        int y;          //!< Bottom row.
+        int depth;      //!< Subdivision level.
+    };
 
-    vbo_.clear();
-    vbo_.reserve( 24 * tt.tileCount * chunks );
+    static const int gridCount = meshGrid * meshGrid;
+    static const int cellCount = meshSide * meshSide;
 
-    for ( const auto& tile : tt.tiles )
+    const double tolerance = std::ldexp( meshTolerance, detail );
+    const double unitInMeter = viewData_.unitInMeter;
+    const double mer0 = latToMercator( body.lat0 );
+    const double mer1 = latToMercator( body.lat1 );
+
+    auto lonAt = [&body]( double u )
+    {
+        return body.lon0 + u * ( body.lon1 - body.lon0 );
+    };
+
+    auto latAt = [mer0, mer1]( double v )
+    {
+        return mercatorToLat( mer0 + v * ( mer1 - mer0 ) );
+    };
+
+    double colLon[meshGrid];
+    double rowLat[meshGrid];
+
+    for ( int i = 0; i < meshGrid; ++i )
+    {
+        colLon[i] = lonAt( static_cast<double>( i ) / meshSide );
+        rowLat[i] = latAt( static_cast<double>( i ) / meshSide );
+    }
+
+    // grid point (i, j) has index j * meshGrid + i, invisible points have HUGE_VAL
+    double gridX[gridCount];
+    double gridY[gridCount];
+    bool known[gridCount] = {};
+    int pending[gridCount];
+    double pendingX[gridCount];
+    double pendingY[gridCount];
+    int pendingCount = 0;
+
+    auto request = [&]( int i, int j )
+    {
+        const int n = j * meshGrid + i;
+
+        if ( !known[n] )
+        {
+            known[n] = true;
+            pendingX[pendingCount] = colLon[i];
+            pendingY[pendingCount] = rowLat[j];
+            pending[pendingCount++] = n;
+        }
+    };
+
+    // depth of the leaf covering every deepest cell
+    int depth[cellCount];
+    Cell cells[2][cellCount];
+    Cell leaves[cellCount];
+    int count = 1;
+    int leafCount = 0;
+    cells[0][0] = { 0, 0, 0 };
+
+    int minDepth = 0;
+
+    while ( minDepth < meshDepth && std::ldexp( meshCellLon, minDepth ) < body.lon1 - body.lon0 )
+    {
+        ++minDepth;
+    }
+
+    for ( int d = 0; count > 0; ++d )
     {
-        const auto& body = tile.second;
-        const double chunkLon = ( body.lon1 - body.lon0 ) / chunks;
-        const double chunkLat = ( body.lat1 - body.lat0 ) / chunks;
-        const float chunkTx = ( body.tx1 - body.tx0 ) / chunks;
-        const float chunkTy = ( body.ty1 - body.ty0 ) / chunks;
-
-        for ( int i = 0; i < chunks; ++i )
-        {
-            double lon[4];
-            lon[0] = body.lon0 + i * chunkLon;
-            lon[1] = body.lon0 + ( i + 1 ) * chunkLon;
-            lon[2] = lon[1];
-            lon[3] = lon[0];
-            float tx[4];
-            tx[0] = body.tx0 + i * chunkTx;
-            tx[1] = body.tx0 + ( i + 1 )* chunkTx;
-            tx[2] = tx[1];
-            tx[3] = tx[0];
-
-            for ( int j = 0; j < chunks; ++j )
+        const Cell* level = cells[d % 2];
+        Cell* next = cells[( d + 1 ) % 2];
+        const int s = meshSide >> d;
+        const int h = s / 2;
+
+        for ( int c = 0; c < count; ++c )
+        {
+            const int x = level[c].x;
+            const int y = level[c].y;
+            request( x, y );
+            request( x + s, y );
+            request( x + s, y + s );
+            request( x, y + s );
+
+            if ( h > 0 )
+            {
+                request( x + h, y );
+                request( x + s, y + h );
+                request( x + h, y + s );
+                request( x, y + h );
+                request( x + h, y + h );
+            }
+        }
+
+        projection_->projectFwd( pendingX, pendingY, pendingX, pendingY, pendingCount );
+
+        for ( int n = 0; n < pendingCount; ++n )
+        {
+            gridX[pending[n]] = pendingX[n];
+            gridY[pending[n]] = pendingY[n];
+        }
+
+        pendingCount = 0;
+        int nextCount = 0;
+
+        for ( int c = 0; c < count; ++c )
+        {
+            const int x = level[c].x;
+            const int y = level[c].y;
+            const int corner[4] = {
+                y * meshGrid + x, y * meshGrid + x + s,
+                ( y + s ) * meshGrid + x + s, ( y + s ) * meshGrid + x
+            };
+
+            int visible = 0;
+
+            for ( int n : corner )
+            {
+                visible += gridX[n] != HUGE_VAL;
+            }
+
+            bool split = false;
+
+            if ( h == 0 )
+            {
+                split = false;
+            }
+            else if ( d < minDepth )
             {
-                double lat[4];
-                lat[0] = body.lat0 + j * chunkLat;
-                lat[1] = lat[0];
-                lat[2] = body.lat0 + ( j + 1 ) * chunkLat;
-                lat[3] = lat[2];
-                float ty[4];
-                ty[0] = body.ty0 + j * chunkTy;
-                ty[1] = ty[0];
-                ty[2] = body.ty0 + ( j + 1 ) * chunkTy;
-                ty[3] = ty[2];
-
-                std::vector<int> ind;
-                GLfloat x[4];
-                GLfloat y[4];
-                double px;  // projected x
-                double py;  // projected y
-
-                for ( int n = 0; n < 4; ++n )
+                split = true;
+            }
+            else if ( visible == 0 )
+            {
+                split = projection_->facingArea( colLon[x], rowLat[y], colLon[x + s], rowLat[y + s] );
+            }
+            else if ( visible < 4 )
+            {
+                split = true;
+            }
+            else
+            {
+                // edge midpoints are compared with the middles of their edges, center with the middle of all corners
+                const int mid[5] = {
+                    y * meshGrid + x + h, ( y + h ) * meshGrid + x + s,
+                    ( y + s ) * meshGrid + x + h, ( y + h ) * meshGrid + x,
+                    ( y + h ) * meshGrid + x + h
+                };
+
+                for ( int n = 0; n < 5 && !split; ++n )
                 {
-                    if ( projector_->projectFwd( lon[n], lat[n], px, py ) )
+                    double ix;
+                    double iy;
+
+                    if ( n < 4 )
+                    {
+                        ix = 0.5 * ( gridX[corner[n]] + gridX[corner[( n + 1 ) % 4]] );
+                        iy = 0.5 * ( gridY[corner[n]] + gridY[corner[( n + 1 ) % 4]] );
+                    }
+                    else
                     {
-                        ind.emplace_back( n );
-                        x[n] = static_cast<GLfloat>( px * viewData_.unitInMeter );
-                        y[n] = static_cast<GLfloat>( py * viewData_.unitInMeter );
+                        ix = 0.25 * ( gridX[corner[0]] + gridX[corner[1]] + gridX[corner[2]] + gridX[corner[3]] );
+                        iy = 0.25 * ( gridY[corner[0]] + gridY[corner[1]] + gridY[corner[2]] + gridY[corner[3]] );
                     }
+
+                    split = gridX[mid[n]] == HUGE_VAL ||
+                        tolerance < std::hypot( gridX[mid[n]] - ix, gridY[mid[n]] - iy );
+                }
+            }
+
+            if ( split )
+            {
+                next[nextCount++] = { x, y, d + 1 };
+                next[nextCount++] = { x + h, y, d + 1 };
+                next[nextCount++] = { x + h, y + h, d + 1 };
+                next[nextCount++] = { x, y + h, d + 1 };
+            }
+            else
+            {
+                leaves[leafCount++] = level[c];
+
+                for ( int j = y; j < y + s; ++j )
+                {
+                    std::fill( depth + j * meshSide + x, depth + j * meshSide + x + s, d );
+                }
+            }
+        }
+
+        count = nextCount;
+    }
+
+    // leaves along Z-order curve and vertices numbered by their first use keep vertex cache warm
+    std::sort( leaves, leaves + leafCount, []( const Cell& lhs, const Cell& rhs )
+    {
+        return mortonCode( lhs.x, lhs.y ) < mortonCode( rhs.x, rhs.y );
+    } );
+
+    // point k of a side is a corner of a neighbour if its leaf before or after k starts or ends at k
+    auto shared = [&depth]( int k, int before, int after )
+    {
+        return k % ( meshSide >> depth[before] ) == 0 || k % ( meshSide >> depth[after] ) == 0;
+    };
+
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    auto addVertex = [&mesh, unitInMeter]( double x, double y, double u, double v )
+    {
+        mesh.vertices.push_back( static_cast<GLfloat>( x * unitInMeter ) );
+        mesh.vertices.push_back( static_cast<GLfloat>( y * unitInMeter ) );
+        mesh.vertices.push_back( static_cast<GLfloat>( u ) );
+        mesh.vertices.push_back( static_cast<GLfloat>( v ) );
+        return static_cast<int>( mesh.vertices.size() / 4 - 1 );
+    };
+
+    // mesh vertex of every grid point and of the horizon on every side of the deepest cells, -1 if none yet
+    int gridVertex[gridCount];
+    int sideVertex[2 * meshSide * meshGrid];
+    std::fill( gridVertex, gridVertex + gridCount, -1 );
+    std::fill( sideVertex, sideVertex + 2 * meshSide * meshGrid, -1 );
+
+    auto vertexAt = [&]( int n )
+    {
+        if ( gridVertex[n] < 0 )
+        {
+            gridVertex[n] = addVertex( gridX[n], gridY[n],
+                static_cast<double>( n % meshGrid ) / meshSide, static_cast<double>( n / meshGrid ) / meshSide );
+        }
+
+        return gridVertex[n];
+    };
+
+    // bisect a side between visible and invisible grid points to find the horizon
+    auto horizonAt = [&]( int in, int out )
+    {
+        const int inI = in % meshGrid;
+        const int inJ = in / meshGrid;
+        const int outI = out % meshGrid;
+        const int outJ = out / meshGrid;
+        const int side = inJ == outJ
+            ? inJ * meshSide + std::min( inI, outI )
+            : meshSide * meshGrid + inI * meshSide + std::min( inJ, outJ );
+
+        if ( sideVertex[side] < 0 )
+        {
+            const double inU = static_cast<double>( inI ) / meshSide;
+            const double inV = static_cast<double>( inJ ) / meshSide;
+            const double outU = static_cast<double>( outI ) / meshSide;
+            const double outV = static_cast<double>( outJ ) / meshSide;
+            double inside = 0.0;
+            double outside = 1.0;
+
+            for ( int n = 0; n < horizonSteps; ++n )
+            {
+                const double t = 0.5 * ( inside + outside );
+                const bool facing = projection_->facing(
+                    lonAt( inU + t * ( outU - inU ) ), latAt( inV + t * ( outV - inV ) ) );
+                ( facing ? inside : outside ) = t;
+            }
+
+            const double u = inU + inside * ( outU - inU );
+            const double v = inV + inside * ( outV - inV );
+            double x;
+            double y;
+
+            if ( projection_->projectFwd( lonAt( u ), latAt( v ), x, y ) )
+            {
+                sideVertex[side] = addVertex( x, y, u, v );
+            }
+        }
+
+        return sideVertex[side];
+    };
+
+    for ( int c = 0; c < leafCount; ++c )
+    {
+        const int x = leaves[c].x;
+        const int y = leaves[c].y;
+        const int s = meshSide >> leaves[c].depth;
+
+        // grid points of the cell go counterclockwise starting from the left-bottom corner
+        int poly[4 * meshSide];
+        int num = 0;
+        bool clip = false;
+
+        poly[num++] = y * meshGrid + x;
+
+        for ( int k = x + 1; k < x + s && 0 < y; ++k )
+        {
+            if ( shared( k, ( y - 1 ) * meshSide + k - 1, ( y - 1 ) * meshSide + k ) )
+            {
+                poly[num++] = y * meshGrid + k;
+            }
+        }
+
+        poly[num++] = y * meshGrid + x + s;
+
+        for ( int k = y + 1; k < y + s && x + s < meshSide; ++k )
+        {
+            if ( shared( k, ( k - 1 ) * meshSide + x + s, k * meshSide + x + s ) )
+            {
+                poly[num++] = k * meshGrid + x + s;
+            }
+        }
+
+        poly[num++] = ( y + s ) * meshGrid + x + s;
+
+        for ( int k = x + s - 1; k > x && y + s < meshSide; --k )
+        {
+            if ( shared( k, ( y + s ) * meshSide + k - 1, ( y + s ) * meshSide + k ) )
+            {
+                poly[num++] = ( y + s ) * meshGrid + k;
+            }
+        }
+
+        poly[num++] = ( y + s ) * meshGrid + x;
+
+        for ( int k = y + s - 1; k > y && 0 < x; --k )
+        {
+            if ( shared( k, ( k - 1 ) * meshSide + x - 1, k * meshSide + x - 1 ) )
+            {
+                poly[num++] = k * meshGrid + x;
+            }
+        }
+
+        for ( int n = 0; n < num; ++n )
+        {
+            clip = clip || gridX[poly[n]] == HUGE_VAL;
+        }
+
+        if ( !clip && num == 4 )
+        {
+            for ( int n : { 0, 1, 2, 0, 2, 3 } )
+            {
+                mesh.indices.push_back( static_cast<GLushort>( vertexAt( poly[n] ) ) );
+            }
+        }
+        else if ( !clip )
+        {
+            const int center = ( y + s / 2 ) * meshGrid + x + s / 2;
+
+            for ( int n = 0; n < num; ++n )
+            {
+                mesh.indices.push_back( static_cast<GLushort>( vertexAt( center ) ) );
+                mesh.indices.push_back( static_cast<GLushort>( vertexAt( poly[n] ) ) );
+                mesh.indices.push_back( static_cast<GLushort>( vertexAt( poly[( n + 1 ) % num] ) ) );
+            }
+        }
+        else
+        {
+            // cells crossing the horizon are the deepest ones, so their sides are single grid steps
+            int part[8 * meshSide];
+            int partNum = 0;
+
+            for ( int n = 0; n < num; ++n )
+            {
+                const int a = poly[n];
+                const int b = poly[( n + 1 ) % num];
+                const bool inA = gridX[a] != HUGE_VAL;
+                const bool inB = gridX[b] != HUGE_VAL;
+
+                if ( inA )
+                {
+                    part[partNum++] = vertexAt( a );
                 }
 
-                if ( ind.size() > 2 )
+                if ( inA != inB )
                 {
-                    std::vector<GLfloat> vecChunk = {
-                        x[ind[0]], y[ind[0]], tx[ind[0]], ty[ind[0]],
-                        x[ind[1]], y[ind[1]], tx[ind[1]], ty[ind[1]],
-                        x[ind[2]], y[ind[2]], tx[ind[2]], ty[ind[2]]
-                    };
+                    const int vertex = inA ? horizonAt( a, b ) : horizonAt( b, a );
 
-                    if ( ind.size() == 4 )
+                    if ( 0 <= vertex )
                     {
-                        vecChunk.insert( vecChunk.end(), {
-                            x[ind[0]], y[ind[0]], tx[ind[0]], ty[ind[0]],
-                            x[ind[2]], y[ind[2]], tx[ind[2]], ty[ind[2]],
-                            x[ind[3]], y[ind[3]], tx[ind[3]], ty[ind[3]] }
-                        );
+                        part[partNum++] = vertex;
                     }
+                }
+            }
 
-                    std::move( vecChunk.begin(), vecChunk.end(), std::back_inserter( vbo_ ) );
+            for ( int n = 1; n + 1 < partNum; ++n )
+            {
+                for ( int vertex : { part[0], part[n], part[n + 1] } )
+                {
+                    mesh.indices.push_back( static_cast<GLushort>( vertex ) );
                 }
             }
         }
     }
+}
 
-    calcedVbo_.store( true );
-    finalize();
+
+/*!
+ * Geographic mesh is a regular grid of the tile in its texture space with
+ * longitudes and latitudes (in radians) instead of projected coordinates,
+ * it doesn't depend on projection center at all. Cells are small enough
+ * for straight sides to stay close to the Globe wherever it's projected.
+ * Cells crossing the horizon are kept, the GPU discards their far side.
+ * Coordinates are stored as floats, which limits this mesh to views not
+ * deeper than defs::gpuMaxZoom.
+ * Cells are emitted along Z-order curve and vertices are numbered in order
+ * of their first use. Texture coordinates are relative to the tile, from 0 to 1.
+ * Safe to call from several threads at once.
+ * \param[in] body Tile body.
+ * \param[out] mesh Vertices and triangle indices of the tile.
+ */
+void MapGenerator::geoTileMesh( const TileBody& body, TileMesh& mesh ) const
+{
+    const double span = std::max( body.lon1 - body.lon0, body.lat1 - body.lat0 );
+    const double mer0 = latToMercator( body.lat0 );
+    const double mer1 = latToMercator( body.lat1 );
+    int depth = 0;
+
+    while ( depth < meshDepth && std::ldexp( geoCellSpan, depth ) < span )
+    {
+        ++depth;
+    }
+
+    const int side = 1 << depth;
+    const int grid = side + 1;
+    int gridVertex[meshGrid * meshGrid];
+    std::fill( gridVertex, gridVertex + grid * grid, -1 );
+
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    auto vertexAt = [&]( int i, int j )
+    {
+        int& vertex = gridVertex[j * grid + i];
+
+        if ( vertex < 0 )
+        {
+            const double u = static_cast<double>( i ) / side;
+            const double v = static_cast<double>( j ) / side;
+            const double lon = body.lon0 + u * ( body.lon1 - body.lon0 );
+            const double lat = mercatorToLat( mer0 + v * ( mer1 - mer0 ) );
+            mesh.vertices.push_back( static_cast<GLfloat>( lon * degToRad ) );
+            mesh.vertices.push_back( static_cast<GLfloat>( lat * degToRad ) );
+            mesh.vertices.push_back( static_cast<GLfloat>( u ) );
+            mesh.vertices.push_back( static_cast<GLfloat>( v ) );
+            vertex = static_cast<int>( mesh.vertices.size() / 4 - 1 );
+        }
+
+        return static_cast<GLushort>( vertex );
+    };
+
+    for ( int code = 0; code < side * side; ++code )
+    {
+        int x = 0;
+        int y = 0;
+
+        for ( int bit = 0; bit < depth; ++bit )
+        {
+            x |= ( ( code >> ( 2 * bit ) ) & 1 ) << bit;
+            y |= ( ( code >> ( 2 * bit + 1 ) ) & 1 ) << bit;
+        }
+
+        const GLushort corner[4] = {
+            vertexAt( x, y ), vertexAt( x + 1, y ),
+            vertexAt( x + 1, y + 1 ), vertexAt( x, y + 1 )
+        };
+
+        for ( int n : { 0, 1, 2, 0, 2, 3 } )
+        {
+            mesh.indices.push_back( corner[n] );
+        }
+    }
 }
 
 
@@ -632,4 +1499,29 @@ void MapGenerator::finalize()
 }
 
 
+/*!
+ * \param[in] rhs Key to compare with.
+ * \return True - keys are equal, false - otherwise.
+ */
+bool MapGenerator::MeshKey::operator==( const MeshKey& rhs ) const
+{
+    return head == rhs.head && lon == rhs.lon && lat == rhs.lat && detail == rhs.detail && geographic == rhs.geographic;
+}
+
+
+/*!
+ * \param[in] key Key of a mesh.
+ * \return Hash value.
+ */
+std::size_t MapGenerator::MeshKeyHash::operator()( const MeshKey& key ) const
+{
+    std::size_t res = std::hash<TileHead>()( key.head );
+    res ^= std::hash<double>()( key.lon ) + 0x9e3779b9 + ( res << 6 ) + ( res >> 2 );
+    res ^= std::hash<double>()( key.lat ) + 0x9e3779b9 + ( res << 6 ) + ( res >> 2 );
+    res ^= std::hash<int>()( key.detail ) + 0x9e3779b9 + ( res << 6 ) + ( res >> 2 );
+    res ^= std::hash<bool>()( key.geographic ) + 0x9e3779b9 + ( res << 6 ) + ( res >> 2 );
+    return res;
+}
+
+
 }
@@ -0,0 +1,422 @@
+#include <atomic>
+#include <cmath>
+#include <initializer_list>
+
+#include "OrthoMath.hpp"
+
+#if defined( GV_ORTHO_SSE2 )
+#include <emmintrin.h>
+#endif
+
+#if defined( GV_ORTHO_NEON )
+#include <arm_neon.h>
+#endif
+
+#if defined( GV_ORTHO_AVX2 ) && defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+
+namespace {
+
+
+const double semiMajor = 6378137.0;                 //!< WGS84 semi-major axis.
+const double flattening = 1.0 / 298.257223563;      //!< WGS84 flattening.
+
+std::atomic<int> selectedSet( -1 );                 //!< Selected instruction set, -1 until the first use.
+
+
+/*!
+ * \brief Lane of a single double, works everywhere.
+ */
+struct LaneScalar
+{
+    typedef double V;
+    typedef bool M;
+    static const std::size_t width = 1;
+
+    static V load( const double* p ) { return *p; }
+    static void store( double* p, V v ) { *p = v; }
+    static V set( double v ) { return v; }
+    static V add( V a, V b ) { return a + b; }
+    static V sub( V a, V b ) { return a - b; }
+    static V mul( V a, V b ) { return a * b; }
+    static V mulAdd( V a, V b, V c ) { return a * b + c; }
+    static V div( V a, V b ) { return a / b; }
+    static V sqrt( V a ) { return std::sqrt( a ); }
+    static V round( V a ) { return std::nearbyint( a ); }
+    static V max( V a, V b ) { return a < b ? b : a; }
+    static M lt( V a, V b ) { return a < b; }
+    static M gt( V a, V b ) { return a > b; }
+    static M ge( V a, V b ) { return a >= b; }
+    static M eq( V a, V b ) { return a == b; }
+    static M land( M a, M b ) { return a && b; }
+    static M lor( M a, M b ) { return a || b; }
+    static V select( M m, V a, V b ) { return m ? a : b; }
+    static std::size_t count( M m ) { return m ? 1 : 0; }
+    static V exponent( V a ) { return std::ilogb( a ); }
+    static V mantissa( V a ) { return std::scalbn( a, -std::ilogb( a ) ); }
+};
+
+
+#if defined( GV_ORTHO_SSE2 )
+
+/*!
+ * \brief Lane of two doubles with SSE2.
+ */
+struct LaneSSE2
+{
+    typedef __m128d V;
+    typedef __m128d M;
+    static const std::size_t width = 2;
+
+    static V load( const double* p ) { return _mm_loadu_pd( p ); }
+    static void store( double* p, V v ) { _mm_storeu_pd( p, v ); }
+    static V set( double v ) { return _mm_set1_pd( v ); }
+    static V add( V a, V b ) { return _mm_add_pd( a, b ); }
+    static V sub( V a, V b ) { return _mm_sub_pd( a, b ); }
+    static V mul( V a, V b ) { return _mm_mul_pd( a, b ); }
+    static V mulAdd( V a, V b, V c ) { return _mm_add_pd( _mm_mul_pd( a, b ), c ); }
+    static V div( V a, V b ) { return _mm_div_pd( a, b ); }
+    static V sqrt( V a ) { return _mm_sqrt_pd( a ); }
+    static V max( V a, V b ) { return _mm_max_pd( a, b ); }
+    static M lt( V a, V b ) { return _mm_cmplt_pd( a, b ); }
+    static M gt( V a, V b ) { return _mm_cmpgt_pd( a, b ); }
+    static M ge( V a, V b ) { return _mm_cmpge_pd( a, b ); }
+    static M eq( V a, V b ) { return _mm_cmpeq_pd( a, b ); }
+    static M land( M a, M b ) { return _mm_and_pd( a, b ); }
+    static M lor( M a, M b ) { return _mm_or_pd( a, b ); }
+    static V select( M m, V a, V b ) { return _mm_or_pd( _mm_and_pd( m, a ), _mm_andnot_pd( m, b ) ); }
+
+    static std::size_t count( M m )
+    {
+        const int bits = _mm_movemask_pd( m );
+        return ( bits & 1 ) + ( ( bits >> 1 ) & 1 );
+    }
+
+    // biased exponent bits are put into mantissa of 2^52 and the bias is subtracted
+    static V exponent( V a )
+    {
+        const V magic = _mm_set1_pd( 4503599627370496.0 );
+        const V bits = _mm_castsi128_pd( _mm_srli_epi64( _mm_castpd_si128( a ), 52 ) );
+        return _mm_sub_pd( _mm_or_pd( bits, magic ), _mm_set1_pd( 4503599627370496.0 + 1023.0 ) );
+    }
+
+    static V mantissa( V a )
+    {
+        const V fraction = _mm_castsi128_pd( _mm_set1_epi64x( 0x000fffffffffffffLL ) );
+        return _mm_or_pd( _mm_and_pd( a, fraction ), _mm_set1_pd( 1.0 ) );
+    }
+
+    // SSE2 has no rounding instruction, adding 1.5 * 2^52 drops the fraction
+    static V round( V a )
+    {
+        const V magic = _mm_set1_pd( 6755399441055744.0 );
+        const V absA = _mm_andnot_pd( _mm_set1_pd( -0.0 ), a );
+        const V res = _mm_sub_pd( _mm_add_pd( a, magic ), magic );
+        return select( _mm_cmplt_pd( absA, _mm_set1_pd( 2251799813685248.0 ) ), res, a );
+    }
+};
+
+#endif
+
+
+#if defined( GV_ORTHO_NEON )
+
+/*!
+ * \brief Lane of two doubles with NEON.
+ */
+struct LaneNEON
+{
+    typedef float64x2_t V;
+    typedef uint64x2_t M;
+    static const std::size_t width = 2;
+
+    static V load( const double* p ) { return vld1q_f64( p ); }
+    static void store( double* p, V v ) { vst1q_f64( p, v ); }
+    static V set( double v ) { return vdupq_n_f64( v ); }
+    static V add( V a, V b ) { return vaddq_f64( a, b ); }
+    static V sub( V a, V b ) { return vsubq_f64( a, b ); }
+    static V mul( V a, V b ) { return vmulq_f64( a, b ); }
+    static V mulAdd( V a, V b, V c ) { return vfmaq_f64( c, a, b ); }
+    static V div( V a, V b ) { return vdivq_f64( a, b ); }
+    static V sqrt( V a ) { return vsqrtq_f64( a ); }
+    static V round( V a ) { return vrndnq_f64( a ); }
+    static V max( V a, V b ) { return vmaxq_f64( a, b ); }
+    static M lt( V a, V b ) { return vcltq_f64( a, b ); }
+    static M gt( V a, V b ) { return vcgtq_f64( a, b ); }
+    static M ge( V a, V b ) { return vcgeq_f64( a, b ); }
+    static M eq( V a, V b ) { return vceqq_f64( a, b ); }
+    static M land( M a, M b ) { return vandq_u64( a, b ); }
+    static M lor( M a, M b ) { return vorrq_u64( a, b ); }
+    static V select( M m, V a, V b ) { return vbslq_f64( m, a, b ); }
+
+    static std::size_t count( M m )
+    {
+        return ( vgetq_lane_u64( m, 0 ) & 1 ) + ( vgetq_lane_u64( m, 1 ) & 1 );
+    }
+
+    // biased exponent bits are put into mantissa of 2^52 and the bias is subtracted
+    static V exponent( V a )
+    {
+        const M magic = vreinterpretq_u64_f64( vdupq_n_f64( 4503599627370496.0 ) );
+        const M bits = vshrq_n_u64( vreinterpretq_u64_f64( a ), 52 );
+        return vsubq_f64( vreinterpretq_f64_u64( vorrq_u64( bits, magic ) ), vdupq_n_f64( 4503599627370496.0 + 1023.0 ) );
+    }
+
+    static V mantissa( V a )
+    {
+        const M fraction = vandq_u64( vreinterpretq_u64_f64( a ), vdupq_n_u64( 0x000fffffffffffffULL ) );
+        return vreinterpretq_f64_u64( vorrq_u64( fraction, vreinterpretq_u64_f64( vdupq_n_f64( 1.0 ) ) ) );
+    }
+};
+
+#endif
+
+
+/*!
+ * \brief Check if the processor and the operating system support AVX2 and FMA.
+ * \return True - supported, false - not supported.
+ */
+bool cpuHasAVX2()
+{
+#if defined( GV_ORTHO_AVX2 ) && defined( _MSC_VER )
+    int info[4];
+    __cpuid( info, 1 );
+    const bool fma = ( info[2] & ( 1 << 12 ) ) != 0;
+    const bool osxsave = ( info[2] & ( 1 << 27 ) ) != 0;
+
+    if ( !fma || !osxsave || ( _xgetbv( 0 ) & 6 ) != 6 )
+    {
+        return false;
+    }
+
+    __cpuidex( info, 7, 0 );
+    return ( info[1] & ( 1 << 5 ) ) != 0;
+#elif defined( GV_ORTHO_AVX2 )
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" );
+#else
+    return false;
+#endif
+}
+
+
+}
+
+
+namespace gv {
+
+
+using namespace ortho;
+
+
+/*!
+ * Center is expected to be the one PROJ.4 gets to make results comparable.
+ * \param[in] lon Longitude of projection center.
+ * \param[in] lat Latitude of projection center.
+ * \param[in] shape Earth model.
+ */
+OrthoKernel::OrthoKernel( double lon, double lat, Shape shape )
+{
+    const double phi0 = lat * degToRad;
+    params_.a = semiMajor;
+    params_.invA = 1.0 / semiMajor;
+    params_.e2 = shape == Shape::Ellipsoid ? flattening * ( 2.0 - flattening ) : 0.0;
+    params_.lam0 = lon * degToRad;
+    params_.sinPhi0 = std::sin( phi0 );
+    params_.cosPhi0 = std::cos( phi0 );
+    params_.nu0 = 1.0 / std::sqrt( 1.0 - params_.e2 * params_.sinPhi0 * params_.sinPhi0 );
+    params_.w = 1.0 / ( 1.0 - params_.e2 );
+    params_.d = -params_.e2 * params_.nu0 * params_.sinPhi0 * params_.cosPhi0;
+    params_.qa = params_.cosPhi0 * params_.cosPhi0 + params_.w * params_.sinPhi0 * params_.sinPhi0;
+}
+
+
+/*!
+ * Input and output arrays may be the same.
+ * \param[in] lon Array of longitudes.
+ * \param[in] lat Array of latitudes.
+ * \param[out] x Array of projected meters along axis x (HUGE_VAL if point is on the far side).
+ * \param[out] y Array of projected meters along axis y (HUGE_VAL if point is on the far side).
+ * \param[in] count Number of points.
+ * \return Number of successfully projected points.
+ */
+std::size_t OrthoKernel::forward( const double* lon, const double* lat, double* x, double* y, std::size_t count ) const
+{
+    switch ( selected() )
+    {
+#if defined( GV_ORTHO_AVX2 )
+    case InstructionSet::AVX2:
+        return forwardAVX2( params_, lon, lat, x, y, count );
+#endif
+#if defined( GV_ORTHO_SSE2 )
+    case InstructionSet::SSE2:
+        return run<LaneSSE2, forwardBlock<LaneSSE2>>( params_, lon, lat, x, y, count );
+#endif
+#if defined( GV_ORTHO_NEON )
+    case InstructionSet::NEON:
+        return run<LaneNEON, forwardBlock<LaneNEON>>( params_, lon, lat, x, y, count );
+#endif
+    default:
+        return run<LaneScalar, forwardBlock<LaneScalar>>( params_, lon, lat, x, y, count );
+    }
+}
+
+
+/*!
+ * Input and output arrays may be the same.
+ * \param[in] x Array of projected meters along axis x.
+ * \param[in] y Array of projected meters along axis y.
+ * \param[out] lon Array of longitudes (HUGE_VAL if point is out of the Globe).
+ * \param[out] lat Array of latitudes (HUGE_VAL if point is out of the Globe).
+ * \param[in] count Number of points.
+ * \return Number of successfully projected points.
+ */
+std::size_t OrthoKernel::inverse( const double* x, const double* y, double* lon, double* lat, std::size_t count ) const
+{
+    switch ( selected() )
+    {
+#if defined( GV_ORTHO_AVX2 )
+    case InstructionSet::AVX2:
+        return inverseAVX2( params_, x, y, lon, lat, count );
+#endif
+#if defined( GV_ORTHO_SSE2 )
+    case InstructionSet::SSE2:
+        return run<LaneSSE2, inverseBlock<LaneSSE2>>( params_, x, y, lon, lat, count );
+#endif
+#if defined( GV_ORTHO_NEON )
+    case InstructionSet::NEON:
+        return run<LaneNEON, inverseBlock<LaneNEON>>( params_, x, y, lon, lat, count );
+#endif
+    default:
+        return run<LaneScalar, inverseBlock<LaneScalar>>( params_, x, y, lon, lat, count );
+    }
+}
+
+
+/*!
+ * Input and output arrays may be the same.
+ * \param[in] x Array of projected meters along axis x.
+ * \param[in] y Array of projected meters along axis y.
+ * \param[out] mx Array of Mercator abscissas from 0 to 1 (HUGE_VAL if point is off the map).
+ * \param[out] my Array of Mercator ordinates from 0 (north) to 1 (HUGE_VAL if point is off the map).
+ * \param[in] count Number of points.
+ * \return Number of points on the map.
+ */
+std::size_t OrthoKernel::inverseMercator( const double* x, const double* y, double* mx, double* my, std::size_t count ) const
+{
+    switch ( selected() )
+    {
+#if defined( GV_ORTHO_AVX2 )
+    case InstructionSet::AVX2:
+        return mercatorAVX2( params_, x, y, mx, my, count );
+#endif
+#if defined( GV_ORTHO_SSE2 )
+    case InstructionSet::SSE2:
+        return run<LaneSSE2, mercatorBlock<LaneSSE2>>( params_, x, y, mx, my, count );
+#endif
+#if defined( GV_ORTHO_NEON )
+    case InstructionSet::NEON:
+        return run<LaneNEON, mercatorBlock<LaneNEON>>( params_, x, y, mx, my, count );
+#endif
+    default:
+        return run<LaneScalar, mercatorBlock<LaneScalar>>( params_, x, y, mx, my, count );
+    }
+}
+
+
+/*!
+ * \return Parameters of projection center and the Earth model.
+ */
+const OrthoParams& OrthoKernel::params() const
+{
+    return params_;
+}
+
+
+/*!
+ * \param[in] set Instruction set.
+ * \return True - both the build and the processor support it, false - otherwise.
+ */
+bool OrthoKernel::supported( InstructionSet set )
+{
+    switch ( set )
+    {
+    case InstructionSet::Scalar:
+        return true;
+    case InstructionSet::SSE2:
+#if defined( GV_ORTHO_SSE2 )
+        return true;
+#else
+        return false;
+#endif
+    case InstructionSet::AVX2:
+    {
+        static const bool avx2 = cpuHasAVX2();
+        return avx2;
+    }
+    case InstructionSet::NEON:
+#if defined( GV_ORTHO_NEON )
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+
+/*!
+ * \return The widest supported instruction set.
+ */
+OrthoKernel::InstructionSet OrthoKernel::best()
+{
+    for ( auto set : { InstructionSet::AVX2, InstructionSet::NEON, InstructionSet::SSE2 } )
+    {
+        if ( supported( set ) )
+        {
+            return set;
+        }
+    }
+
+    return InstructionSet::Scalar;
+}
+
+
+/*!
+ * Selection affects all kernels immediately, including the ones in use by other threads.
+ * \param[in] set Instruction set.
+ * \return True - instruction set is selected, false - it's not supported and nothing changed.
+ */
+bool OrthoKernel::select( InstructionSet set )
+{
+    if ( !supported( set ) )
+    {
+        return false;
+    }
+
+    selectedSet.store( static_cast<int>( set ) );
+    return true;
+}
+
+
+/*!
+ * \return Selected instruction set, the best one if none was selected yet.
+ */
+OrthoKernel::InstructionSet OrthoKernel::selected()
+{
+    int set = selectedSet.load( std::memory_order_relaxed );
+
+    if ( set < 0 )
+    {
+        const int fastest = static_cast<int>( best() );
+        set = selectedSet.compare_exchange_strong( set, fastest ) ? fastest : set;
+    }
+
+    return static_cast<InstructionSet>( set );
+}
+
+
+}
@@ -0,0 +1,121 @@
+/*
+ * Built with AVX2 and FMA enabled, so nothing but AVX2 kernels may live here.
+ * Everything is kept local to this translation unit to never let the linker
+ * pick AVX2 code for a processor that doesn't support it.
+ */
+#include "OrthoMath.hpp"
+
+#if defined( GV_ORTHO_AVX2 )
+
+#include <immintrin.h>
+
+
+namespace {
+
+
+/*!
+ * \brief Lane of four doubles with AVX2 and FMA.
+ */
+struct LaneAVX2
+{
+    typedef __m256d V;
+    typedef __m256d M;
+    static const std::size_t width = 4;
+
+    static V load( const double* p ) { return _mm256_loadu_pd( p ); }
+    static void store( double* p, V v ) { _mm256_storeu_pd( p, v ); }
+    static V set( double v ) { return _mm256_set1_pd( v ); }
+    static V add( V a, V b ) { return _mm256_add_pd( a, b ); }
+    static V sub( V a, V b ) { return _mm256_sub_pd( a, b ); }
+    static V mul( V a, V b ) { return _mm256_mul_pd( a, b ); }
+    static V mulAdd( V a, V b, V c ) { return _mm256_fmadd_pd( a, b, c ); }
+    static V div( V a, V b ) { return _mm256_div_pd( a, b ); }
+    static V sqrt( V a ) { return _mm256_sqrt_pd( a ); }
+    static V round( V a ) { return _mm256_round_pd( a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ); }
+    static V max( V a, V b ) { return _mm256_max_pd( a, b ); }
+    static M lt( V a, V b ) { return _mm256_cmp_pd( a, b, _CMP_LT_OQ ); }
+    static M gt( V a, V b ) { return _mm256_cmp_pd( a, b, _CMP_GT_OQ ); }
+    static M ge( V a, V b ) { return _mm256_cmp_pd( a, b, _CMP_GE_OQ ); }
+    static M eq( V a, V b ) { return _mm256_cmp_pd( a, b, _CMP_EQ_OQ ); }
+    static M land( M a, M b ) { return _mm256_and_pd( a, b ); }
+    static M lor( M a, M b ) { return _mm256_or_pd( a, b ); }
+    static V select( M m, V a, V b ) { return _mm256_blendv_pd( b, a, m ); }
+
+    static std::size_t count( M m )
+    {
+        const int bits = _mm256_movemask_pd( m );
+        return ( bits & 1 ) + ( ( bits >> 1 ) & 1 ) + ( ( bits >> 2 ) & 1 ) + ( ( bits >> 3 ) & 1 );
+    }
+
+    // biased exponent bits are put into mantissa of 2^52 and the bias is subtracted
+    static V exponent( V a )
+    {
+        const V magic = _mm256_set1_pd( 4503599627370496.0 );
+        const V bits = _mm256_castsi256_pd( _mm256_srli_epi64( _mm256_castpd_si256( a ), 52 ) );
+        return _mm256_sub_pd( _mm256_or_pd( bits, magic ), _mm256_set1_pd( 4503599627370496.0 + 1023.0 ) );
+    }
+
+    static V mantissa( V a )
+    {
+        const V fraction = _mm256_castsi256_pd( _mm256_set1_epi64x( 0x000fffffffffffffLL ) );
+        return _mm256_or_pd( _mm256_and_pd( a, fraction ), _mm256_set1_pd( 1.0 ) );
+    }
+};
+
+
+}
+
+
+namespace gv {
+namespace ortho {
+
+
+/*!
+ * \param[in] p Projection parameters.
+ * \param[in] lon Array of longitudes.
+ * \param[in] lat Array of latitudes.
+ * \param[out] x Array of projected meters along axis x.
+ * \param[out] y Array of projected meters along axis y.
+ * \param[in] count Number of points.
+ * \return Number of successfully projected points.
+ */
+std::size_t forwardAVX2( const OrthoParams& p, const double* lon, const double* lat, double* x, double* y, std::size_t count )
+{
+    return run<LaneAVX2, forwardBlock<LaneAVX2>>( p, lon, lat, x, y, count );
+}
+
+
+/*!
+ * \param[in] p Projection parameters.
+ * \param[in] x Array of projected meters along axis x.
+ * \param[in] y Array of projected meters along axis y.
+ * \param[out] lon Array of longitudes.
+ * \param[out] lat Array of latitudes.
+ * \param[in] count Number of points.
+ * \return Number of successfully projected points.
+ */
+std::size_t inverseAVX2( const OrthoParams& p, const double* x, const double* y, double* lon, double* lat, std::size_t count )
+{
+    return run<LaneAVX2, inverseBlock<LaneAVX2>>( p, x, y, lon, lat, count );
+}
+
+
+/*!
+ * \param[in] p Projection parameters.
+ * \param[in] x Array of projected meters along axis x.
+ * \param[in] y Array of projected meters along axis y.
+ * \param[out] mx Array of Mercator abscissas.
+ * \param[out] my Array of Mercator ordinates.
+ * \param[in] count Number of points.
+ * \return Number of points on the map.
+ */
+std::size_t mercatorAVX2( const OrthoParams& p, const double* x, const double* y, double* mx, double* my, std::size_t count )
+{
+    return run<LaneAVX2, mercatorBlock<LaneAVX2>>( p, x, y, mx, my, count );
+}
+
+
+}
+}
+
+#endif
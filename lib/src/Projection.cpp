@@ -0,0 +1,615 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Defines.h"
+#include "Projection.h"
+
+
+namespace {
+
+
+const double semiMajor = 6378137.0; //!< WGS84 semi-major axis, radius of PROJ.4 orthographic sphere.
+const double eps = 1.0e-10;         //!< Tolerance PROJ.4 uses to decide if a point is visible.
+
+const double precision = 1.0e6;     //!< Steps in a degree of projection center, std::to_string keeps 6 decimals.
+const std::size_t cacheSize = 16;   //!< Number of PROJ.4 projections kept by a thread.
+const double mercatorSinLimit = std::tanh( defs::pi );  //!< Sine of the latitude Web Mercator is cut at.
+
+
+/*!
+ * \brief PROJ.4 objects owned by a single thread.
+ *
+ * PROJ.4 objects must not be shared between threads, so every thread
+ * creates its own context and projections. Creating a projection means
+ * parsing its definition and initializing it, so a few recently used
+ * projections are kept keyed by their centers. Dragging the Globe back
+ * and forth or resetting it to a known center reuses them.
+ */
+struct ThreadProjection
+{
+    //! Cached projection.
+    struct Entry
+    {
+        std::int64_t lon;               //!< Longitude of projection center (in steps).
+        std::int64_t lat;               //!< Latitude of projection center (in steps).
+        PJ* projection;                 //!< PROJ.4 projection.
+    };
+
+    PJ_CONTEXT* context = nullptr;      //!< PROJ.4 context of the thread.
+    std::vector<Entry> entries;         //!< Cached projections, the most recently used is the last.
+
+    ~ThreadProjection()
+    {
+        for ( auto& entry : entries )
+        {
+            proj_destroy( entry.projection );
+        }
+
+        if ( context )
+        {
+            proj_context_destroy( context );
+        }
+    }
+};
+
+
+thread_local ThreadProjection threadProjection;    //!< PROJ.4 objects of the current thread.
+
+
+}
+
+
+namespace gv
+{
+
+
+/*!
+ * \param[in] lon Longitude of projection center.
+ * \param[in] lat Latitude of projection center.
+ * \param[in] closedForm Closed form to use instead of PROJ.4.
+ */
+Projection::Projection( double lon, double lat, ClosedForm closedForm )
+    : keyLon_( std::llround( lon * precision ) )
+    , keyLat_( std::llround( lat * precision ) )
+    , closedForm_( closedForm )
+    , kernel_( keyLon_ / precision, keyLat_ / precision,
+        closedForm == ClosedForm::Ellipsoid ? OrthoKernel::Shape::Ellipsoid : OrthoKernel::Shape::Sphere )
+{
+    if ( lon < -180.0 ) projLon_ = lon + 360.0;
+    else if ( lon >= 180.0 ) projLon_ = lon - 360.0;
+    else projLon_ = lon;
+
+    projLat_ = lat;
+
+    // closed form must use the center PROJ.4 gets
+    lam0_ = keyLon_ / precision * defs::degToRad;
+    const double phi0 = keyLat_ / precision * defs::degToRad;
+    sinPhi0_ = std::sin( phi0 );
+    cosPhi0_ = std::cos( phi0 );
+}
+
+
+Projection::~Projection()
+{
+}
+
+
+/*!
+ * \param[in] lon Longitude.
+ * \param[in] lat Latitude.
+ * \param[out] x Projected meters along axis x.
+ * \param[out] y Projected meters along axis y.
+ * \return
+ * True - projecting succeeded.\n
+ * False - projecting failed.
+ */
+bool Projection::projectFwd( double lon, double lat, double& x, double& y ) const
+{
+    if ( closedForm_ != ClosedForm::None )
+    {
+        return kernel_.forward( &lon, &lat, &x, &y, 1 ) == 1;
+    }
+
+    PJ* pj = threadPJ();
+
+    if ( !pj )
+    {
+        x = y = HUGE_VAL;
+        return false;
+    }
+
+    PJ_COORD src = proj_coord( proj_torad( lon ), proj_torad( lat ), 0.0, 0.0 );
+    PJ_COORD res = proj_trans( pj, PJ_FWD, src );
+    x = res.xy.x;
+    y = res.xy.y;
+
+    return ( x != HUGE_VAL && y != HUGE_VAL );
+}
+
+
+/*!
+ * \param[in] lon Longitude.
+ * \param[in] lat Latitude.
+ * \return Tuple:\n
+ * (0) Result (true - projecting succeeded, false - projecting failed). \n
+ * (1) Projected meters along axis x. \n
+ * (2) Projected meters along axis y.
+ */
+std::tuple<bool, double, double> Projection::projectFwd( double lon, double lat ) const
+{
+    double x;
+    double y;
+    bool ok = projectFwd( lon, lat, x, y );
+    return std::make_tuple( ok, x, y );
+}
+
+
+/*!
+ * \param[in] x Projected meters along axis x.
+ * \param[in] y Projected meters along axis y.
+ * \param[out] lon Longitude.
+ * \param[out] lat Latitude.
+ * \return
+ * True - projecting succeeded.\n
+ * False - projecting failed.
+ */
+bool Projection::projectInv( double x, double y, double& lon, double& lat ) const
+{
+    if ( closedForm_ != ClosedForm::None )
+    {
+        return kernel_.inverse( &x, &y, &lon, &lat, 1 ) == 1;
+    }
+
+    PJ* pj = threadPJ();
+
+    if ( !pj )
+    {
+        lon = lat = HUGE_VAL;
+        return false;
+    }
+
+    PJ_COORD src = proj_coord( x, y, 0.0, 0.0 );
+    PJ_COORD res = proj_trans( pj, PJ_INV, src );
+    lon = proj_todeg( res.lp.lam );
+    lat = proj_todeg( res.lp.phi );
+
+    return ( lon != HUGE_VAL && lat != HUGE_VAL );
+}
+
+
+/*!
+ * \param[in] x Projected meters along axis x.
+ * \param[in] y Projected meters along axis y.
+ * \return
+ * (0) Result (true - projecting succeeded, false - projecting failed). \n
+ * (1) Longitude. \n
+ * (2) Latitude.
+ */
+std::tuple<bool, double, double> Projection::projectInv( double x, double y ) const
+{
+    double lon;
+    double lat;
+    bool ok = projectInv( x, y, lon, lat );
+    return std::make_tuple( ok, lon, lat );
+}
+
+
+/*!
+ * All points are transformed with one call of the native kernel or PROJ.4,
+ * which is much faster than projecting them one by one.
+ * Input and output arrays may be the same.
+ * \param[in] lon Array of longitudes.
+ * \param[in] lat Array of latitudes.
+ * \param[out] x Array of projected meters along axis x (HUGE_VAL if projecting failed).
+ * \param[out] y Array of projected meters along axis y (HUGE_VAL if projecting failed).
+ * \param[in] count Number of points.
+ * \return Number of successfully projected points.
+ */
+std::size_t Projection::projectFwd( const double* lon, const double* lat, double* x, double* y, std::size_t count ) const
+{
+    if ( closedForm_ != ClosedForm::None )
+    {
+        return kernel_.forward( lon, lat, x, y, count );
+    }
+
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        x[i] = proj_torad( lon[i] );
+        y[i] = proj_torad( lat[i] );
+    }
+
+    return transform( PJ_FWD, x, y, count );
+}
+
+
+/*!
+ * All points are transformed with one call of the native kernel or PROJ.4,
+ * which is much faster than projecting them one by one.
+ * Input and output arrays may be the same.
+ * \param[in] x Array of projected meters along axis x.
+ * \param[in] y Array of projected meters along axis y.
+ * \param[out] lon Array of longitudes (HUGE_VAL if projecting failed).
+ * \param[out] lat Array of latitudes (HUGE_VAL if projecting failed).
+ * \param[in] count Number of points.
+ * \return Number of successfully projected points.
+ */
+std::size_t Projection::projectInv( const double* x, const double* y, double* lon, double* lat, std::size_t count ) const
+{
+    if ( closedForm_ != ClosedForm::None )
+    {
+        return kernel_.inverse( x, y, lon, lat, count );
+    }
+
+    if ( lon != x )
+    {
+        std::copy( x, x + count, lon );
+    }
+
+    if ( lat != y )
+    {
+        std::copy( y, y + count, lat );
+    }
+
+    const auto res = transform( PJ_INV, lon, lat, count );
+
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        if ( lon[i] != HUGE_VAL )
+        {
+            lon[i] = proj_todeg( lon[i] );
+            lat[i] = proj_todeg( lat[i] );
+        }
+    }
+
+    return res;
+}
+
+
+/*!
+ * Web Mercator coordinates are normalized to the whole map, so multiplied by
+ * the number of tiles in a row they give tile coordinates of a point. The native
+ * kernel goes from the plane to Mercator without intermediate degrees, while
+ * PROJ.4 results are converted point by point.
+ * Input and output arrays may be the same.
+ * \param[in] x Array of projected meters along axis x.
+ * \param[in] y Array of projected meters along axis y.
+ * \param[out] mx Array of Mercator abscissas from 0 (180 degrees west) to 1 (HUGE_VAL if point is off the map).
+ * \param[out] my Array of Mercator ordinates from 0 (north) to 1 (HUGE_VAL if point is off the map).
+ * \param[in] count Number of points.
+ * \return Number of points on the map.
+ */
+std::size_t Projection::projectInvMercator( const double* x, const double* y, double* mx, double* my, std::size_t count ) const
+{
+    if ( closedForm_ != ClosedForm::None )
+    {
+        return kernel_.inverseMercator( x, y, mx, my, count );
+    }
+
+    projectInv( x, y, mx, my, count );
+    std::size_t res = 0;
+
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        const double sinLat = std::sin( my[i] * defs::degToRad );
+
+        if ( mx[i] == HUGE_VAL || std::abs( sinLat ) >= mercatorSinLimit )
+        {
+            mx[i] = my[i] = HUGE_VAL;
+            continue;
+        }
+
+        mx[i] = mx[i] / 360.0 + 0.5;
+        my[i] = 0.5 - std::log( ( 1.0 + sinLat ) / ( 1.0 - sinLat ) ) / ( 4.0 * defs::pi );
+        ++res;
+    }
+
+    return res;
+}
+
+
+/*!
+ * \param[out] lon Longitude.
+ * \param[out] lat Latitude.
+ */
+void Projection::projectionCenter( double& lon, double& lat ) const
+{
+    lon = projLon_;
+    lat = projLat_;
+}
+
+
+/*!
+ * \return
+ * (0) Longitude. \n
+ * (1) Latitude.
+ */
+std::tuple<double, double> Projection::projectionCenter() const
+{
+    return std::make_tuple( projLon_, projLat_ );
+}
+
+
+/*!
+ * \param[in] lon Longitude.
+ * \param[in] lat Latitude.
+ * \return True - point is visible, false - point is on the far side.
+ */
+bool Projection::facing( double lon, double lat ) const
+{
+    const double phi = lat * defs::degToRad;
+    const double lam = lon * defs::degToRad;
+    return sinPhi0_ * std::sin( phi ) + cosPhi0_ * std::cos( phi ) * std::cos( lam - lam0_ ) >= -eps;
+}
+
+
+/*!
+ * The dot product of normals reaches its maximum over longitudes at the one
+ * closest to projection center. What remains is A * sin(phi) + B * cos(phi),
+ * which has a single maximum at atan2(A, B), otherwise maximum is at an end
+ * of latitude range.
+ * \param[in] lon0 Western longitude.
+ * \param[in] lat0 Southern latitude.
+ * \param[in] lon1 Eastern longitude.
+ * \param[in] lat1 Northern latitude.
+ * \return True - some part of rectangle is visible, false - whole rectangle is on the far side.
+ */
+bool Projection::facingArea( double lon0, double lat0, double lon1, double lat1 ) const
+{
+    const double lam0 = lon0 * defs::degToRad;
+    const double lam1 = lon1 * defs::degToRad;
+    const double phi0 = lat0 * defs::degToRad;
+    const double phi1 = lat1 * defs::degToRad;
+
+    const double lamC = lam0_;
+    const double sinPhiC = sinPhi0_;
+    const double cosPhiC = cosPhi0_;
+
+    const double twoPi = 2.0 * defs::pi;
+    const double toCenter = std::fmod( std::fmod( lamC - lam0, twoPi ) + twoPi, twoPi );
+    const double cosLam = toCenter <= lam1 - lam0
+        ? 1.0
+        : std::max( std::cos( lam0 - lamC ), std::cos( lam1 - lamC ) );
+
+    const double a = sinPhiC;
+    const double b = cosPhiC * cosLam;
+    const double top = std::atan2( a, b );
+    double best;
+
+    if ( phi0 <= top && top <= phi1 )
+    {
+        best = std::sqrt( a * a + b * b );
+    }
+    else
+    {
+        best = std::max( a * std::sin( phi0 ) + b * std::cos( phi0 ), a * std::sin( phi1 ) + b * std::cos( phi1 ) );
+    }
+
+    return best >= -eps;
+}
+
+
+/*!
+ * \return Radius of the projected Globe.
+ */
+double Projection::globeRadius() const
+{
+    return semiMajor;
+}
+
+
+/*!
+ * Points around projection center on both hemispheres are projected forward
+ * and back by PROJ.4 and the closed form, spherical and ellipsoidal results
+ * differ there by kilometers.
+ * \return True - results agree within a millimeter, false - otherwise.
+ */
+bool Projection::validateClosedForm() const
+{
+    static const double tolerance = 1.0e-3;
+    static const double toleranceDeg = 1.0e-8;
+    static const int side = 9;
+    static const int count = side * side;
+
+    if ( closedForm_ == ClosedForm::None )
+    {
+        return false;
+    }
+
+    double lon[count];
+    double lat[count];
+    double projX[count];
+    double projY[count];
+
+    for ( int j = 0; j < side; ++j )
+    {
+        for ( int i = 0; i < side; ++i )
+        {
+            lon[j * side + i] = projLon_ - 80.0 + 20.0 * i;
+            lat[j * side + i] = -80.0 + 20.0 * j;
+            projX[j * side + i] = proj_torad( lon[j * side + i] );
+            projY[j * side + i] = proj_torad( lat[j * side + i] );
+        }
+    }
+
+    double x[count];
+    double y[count];
+
+    if ( transform( PJ_FWD, projX, projY, count ) == 0
+        || kernel_.forward( lon, lat, x, y, count ) == 0 )
+    {
+        return false;
+    }
+
+    for ( int i = 0; i < count; ++i )
+    {
+        if ( ( projX[i] == HUGE_VAL ) != ( x[i] == HUGE_VAL )
+            || tolerance < std::abs( projX[i] - x[i] ) || tolerance < std::abs( projY[i] - y[i] ) )
+        {
+            return false;
+        }
+    }
+
+    // both sides are fed with points PROJ.4 projected forward
+    std::copy( projX, projX + count, x );
+    std::copy( projY, projY + count, y );
+    transform( PJ_INV, projX, projY, count );
+    kernel_.inverse( x, y, x, y, count );
+
+    for ( int i = 0; i < count; ++i )
+    {
+        if ( ( projX[i] == HUGE_VAL ) != ( x[i] == HUGE_VAL ) )
+        {
+            return false;
+        }
+
+        if ( x[i] != HUGE_VAL )
+        {
+            const double diffLon = std::abs( std::remainder( proj_todeg( projX[i] ) - x[i], 360.0 ) );
+
+            if ( toleranceDeg < diffLon || toleranceDeg < std::abs( proj_todeg( projY[i] ) - y[i] ) )
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * If any coordinate of a point fails, both are set to HUGE_VAL.
+ * \param[in] dir Direction of projection.
+ * \param[in,out] x Array of first coordinates.
+ * \param[in,out] y Array of second coordinates.
+ * \param[in] count Number of points.
+ * \return Number of successfully transformed points.
+ */
+std::size_t Projection::transform( PJ_DIRECTION dir, double* x, double* y, std::size_t count ) const
+{
+    if ( count == 0 )
+    {
+        return 0;
+    }
+
+    PJ* pj = threadPJ();
+
+    if ( !pj )
+    {
+        std::fill( x, x + count, HUGE_VAL );
+        std::fill( y, y + count, HUGE_VAL );
+        return 0;
+    }
+
+    proj_trans_generic( pj, dir,
+        x, sizeof( double ), count,
+        y, sizeof( double ), count,
+        nullptr, 0, 0,
+        nullptr, 0, 0 );
+    proj_errno_reset( pj );
+
+    std::size_t res = 0;
+
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        if ( x[i] == HUGE_VAL || y[i] == HUGE_VAL )
+        {
+            x[i] = y[i] = HUGE_VAL;
+        }
+        else
+        {
+            ++res;
+        }
+    }
+
+    return res;
+}
+
+
+/*!
+ * \return Closed form used instead of PROJ.4.
+ */
+Projection::ClosedForm Projection::closedForm() const
+{
+    return closedForm_;
+}
+
+
+/*!
+ * Parameters allow projecting on the GPU the same way OrthoKernel does.
+ * When there's no closed form they describe the sphere.
+ * \return Parameters of native orthographic projection.
+ */
+const OrthoParams& Projection::orthoParams() const
+{
+    return kernel_.params();
+}
+
+
+/*!
+ * Projection is taken from the cache of the calling thread. Only on a miss
+ * the definition is built and parsed, then the least recently used
+ * projection is dropped if the cache is full.
+ * \return PROJ.4 projection of the calling thread, nullptr if it cannot be created.
+ */
+PJ* Projection::threadPJ() const
+{
+    auto& tp = threadProjection;
+    auto& entries = tp.entries;
+
+    if ( !entries.empty() && entries.back().lon == keyLon_ && entries.back().lat == keyLat_ )
+    {
+        return entries.back().projection;
+    }
+
+    auto it = std::find_if( entries.begin(), entries.end(),
+        [this]( const ThreadProjection::Entry& entry ) { return entry.lon == keyLon_ && entry.lat == keyLat_; } );
+
+    if ( it != entries.end() )
+    {
+        std::rotate( it, it + 1, entries.end() );
+        return entries.back().projection;
+    }
+
+    if ( !tp.context )
+    {
+        tp.context = proj_context_create();
+    }
+
+    PJ* projection = proj_create( tp.context, definition().c_str() );
+
+    if ( !projection )
+    {
+        return nullptr;
+    }
+
+    if ( entries.size() == cacheSize )
+    {
+        proj_destroy( entries.front().projection );
+        entries.erase( entries.begin() );
+    }
+
+    entries.push_back( { keyLon_, keyLat_, projection } );
+
+    return projection;
+}
+
+
+/*!
+ * Center is written with exactly the precision it's quantized to.
+ * \return PROJ.4 definition string.
+ */
+std::string Projection::definition() const
+{
+    std::string strLon = std::to_string( keyLon_ / precision );
+    std::replace( strLon.begin(), strLon.end(), ',', '.' );
+    std::string strLat = std::to_string( keyLat_ / precision );
+    std::replace( strLat.begin(), strLat.end(), ',', '.' );
+    return "+proj=ortho +ellps=WGS84 +lon_0=" + strLon + " +lat_0=" + strLat;
+}
+
+
+}
@@ -1,6 +1,4 @@
-﻿#include <algorithm>
-#include <cmath>
-#include <string>
+#include <initializer_list>
 
 #include "Projector.h"
 
@@ -9,154 +7,114 @@ namespace gv
 {
 
 
-Projector::Projector()
-    : projection_( nullptr )
-{
-    context_ = proj_context_create();
-    setProjectionAt( 0.0, 0.0 );
-    projLon_ = 0.0;
-    projLat_ = 0.0;
-}
+namespace {
 
 
-Projector::~Projector()
-{
-    proj_destroy( projection_ );
-    proj_context_destroy( context_ );
-}
+//! Latest version of projection published by any Projector.
+std::atomic<unsigned long long> lastVersion( 0 );
 
 
-/*!
- * \param[in] lon Longitude.
- * \param[in] lat Latitude.
- */
-void Projector::setProjectionAt( double lon, double lat )
+//! Projection of a Projector taken by a thread last.
+struct CachedProjection
 {
-    std::lock_guard<std::mutex> lock( mutex_ );
+    const void* owner = nullptr;                    //!< Projector the projection was taken from.
+    unsigned long long version = 0;                 //!< Version of the projection.
+    std::shared_ptr<const Projection> projection;   //!< Projection.
+};
 
-    if ( projection_ )
-    {
-        proj_destroy( projection_ );
-    }
 
-    std::string strLon = std::to_string( lon );
-    std::replace( strLon.begin(), strLon.end(), ',', '.' );
-    std::string strLat = std::to_string( lat );
-    std::replace( strLat.begin(), strLat.end(), ',', '.' );
-    std::string strProj = "+proj=ortho +ellps=WGS84 +lon_0=" + strLon + " +lat_0=" + strLat;
-    projection_ = proj_create( context_, strProj.c_str() );
+//! Number of Projectors a thread keeps projections of.
+const std::size_t cachedProjectors = 4;
 
-    if ( lon < -180.0 ) projLon_ = lon + 360.0;
-    else if ( lon >= 180.0 ) projLon_ = lon - 360.0;
-    else projLon_ = lon;
 
-    projLat_ = lat;
 }
 
 
 /*!
- * \param[in] lon Longitude.
- * \param[in] lat Latitude.
- * \param[out] x Projected meters along axis x.
- * \param[out] y Projected meters along axis y.
- * \return
- * True - projecting succeeded.\n
- * False - projecting failed.
+ * Closed forms are checked at an oblique projection center,
+ * where Earth models differ the most.
  */
-bool Projector::projectFwd( double lon, double lat, double& x, double& y ) const
+Projector::Projector()
+    : version_( 0 )
+    , closedForm_( Projection::ClosedForm::None )
 {
-    PJ_COORD res;
+    for ( auto form : { Projection::ClosedForm::Ellipsoid, Projection::ClosedForm::Sphere } )
     {
-        std::lock_guard<std::mutex> lock( mutex_ );
-        PJ_COORD src = proj_coord( proj_torad( lon ), proj_torad( lat ), 0.0, 0.0 );
-        res = proj_trans( projection_, PJ_FWD, src );
+        if ( Projection( 30.0, 45.0, form ).validateClosedForm() )
+        {
+            closedForm_ = form;
+            break;
+        }
     }
-    x = res.xy.x;
-    y = res.xy.y;
 
-    return ( x != HUGE_VAL && y != HUGE_VAL );
+    setProjectionAt( 0.0, 0.0 );
 }
 
 
-/*!
- * \param[in] lon Longitude.
- * \param[in] lat Latitude.
- * \return Tuple:\n
- * (0) Result (true - projecting succeeded, false - projecting failed). \n
- * (1) Projected meters along axis x. \n
- * (2) Projected meters along axis y.
- */
-std::tuple<bool, double, double> Projector::projectFwd( double lon, double lat ) const
+Projector::~Projector()
 {
-    double x;
-    double y;
-    bool ok = projectFwd( lon, lat, x, y );
-    return std::make_tuple( ok, x, y );
 }
 
 
 /*!
- * \param[in] x Projected meters along axis x.
- * \param[in] y Projected meters along axis y.
- * \param[out] lon Longitude.
- * \param[out] lat Latitude.
- * \return
- * True - projecting succeeded.\n
- * False - projecting failed.
+ * Projection is built before taking the lock. Versions come from a counter
+ * shared by all Projectors, so a Projector created where a destroyed one was
+ * never matches projections threads have cached from the old one.
+ * \param[in] lon Longitude.
+ * \param[in] lat Latitude.
  */
-bool Projector::projectInv( double x, double y, double& lon, double& lat ) const
+void Projector::setProjectionAt( double lon, double lat )
 {
-    PJ_COORD res;
-    {
-        std::lock_guard<std::mutex> lock( mutex_ );
-        PJ_COORD src = proj_coord( x, y, 0.0, 0.0 );
-        res = proj_trans( projection_, PJ_INV, src );
-    }
-    lon = proj_todeg( res.lp.lam );
-    lat = proj_todeg( res.lp.phi );
+    auto projection = std::make_shared<const Projection>( lon, lat, closedForm_ );
 
-    return ( lon != HUGE_VAL && lat != HUGE_VAL );
+    std::lock_guard<std::mutex> lock( mutex_ );
+    projection_ = std::move( projection );
+    version_.store( ++lastVersion, std::memory_order_release );
 }
 
 
 /*!
- * \param[in] x Projected meters along axis x.
- * \param[in] y Projected meters along axis y.
- * \return
- * (0) Result (true - projecting succeeded, false - projecting failed). \n
- * (1) Longitude. \n
- * (2) Latitude.
+ * Returned Projection stays valid and unchanged even if projection center
+ * is set again later. The thread's cached projection is returned while its
+ * version is current, only the first call after a change takes the lock.
+ * Cached projections of a thread stay alive till other Projectors replace
+ * them or the thread exits.
+ * \return Current projection.
  */
-std::tuple<bool, double, double> Projector::projectInv( double x, double y ) const
+std::shared_ptr<const Projection> Projector::projection() const
 {
-    double lon;
-    double lat;
-    bool ok = projectInv( x, y, lon, lat );
-    return std::make_tuple( ok, lon, lat );
-}
+    thread_local CachedProjection cache[cachedProjectors];
+    thread_local std::size_t next = 0;
 
+    const unsigned long long version = version_.load( std::memory_order_acquire );
+    CachedProjection* entry = nullptr;
 
-/*!
- * \param[out] lon Longitude.
- * \param[out] lat Latitude.
- */
-void Projector::projectionCenter( double& lon, double& lat ) const
-{
-    std::lock_guard<std::mutex> lock( mutex_ );
-    lon = projLon_;
-    lat = projLat_;
-}
+    for ( auto& cached : cache )
+    {
+        if ( cached.owner == this )
+        {
+            if ( cached.version == version )
+            {
+                return cached.projection;
+            }
+
+            entry = &cached;
+            break;
+        }
+    }
 
+    if ( !entry )
+    {
+        entry = &cache[next];
+        next = ( next + 1 ) % cachedProjectors;
+    }
 
-/*!
- * \return
- * (0) Longitude. \n
- * (1) Latitude.
- */
-std::tuple<double, double> Projector::projectionCenter() const
-{
     std::lock_guard<std::mutex> lock( mutex_ );
-    return std::make_tuple( projLon_, projLat_ );
+    entry->owner = this;
+    entry->version = version_.load( std::memory_order_relaxed );
+    entry->projection = projection_;
+
+    return entry->projection;
 }
 
 
@@ -1,10 +1,8 @@
 ﻿#include <exception>
-#include <thread>
-#include <tuple>
 
-#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "Projector.h"
 #include "Renderer.h"
 #include "Shader.h"
 
@@ -12,23 +10,33 @@
 namespace gv {
 
 
+/*!
+ * State that never changes is set once here: clear colour, line width,
+ * texture unit and wire-frame colour.
+ */
 Renderer::Renderer()
-    : mapReady_( false )
+    : current_( nullptr )
+    , unitInMeter_( 0.0f )
+    , projVersion_( 0 )
+    , wire_{ &simple_, 0, 0, GL_LINES, 0, GL_UNSIGNED_SHORT, false }
+    , map_{ &texture_, 0, 0, GL_TRIANGLES, 0, GL_UNSIGNED_INT, false }
+    , listValid_( false )
+    , mapReady_( false )
     , drawWires_( true )
     , drawMap_( true )
 {
-    shaderSimple_.reset( new support::Shader( "shaders/simple.vs", "shaders/simple.fs" ) );
-    shaderTexture_.reset( new support::Shader( "shaders/texture.vs", "shaders/texture.fs" ) );
+    loadProgram( simple_, "shaders/simple.vs", "shaders/simple.fs" );
+    loadProgram( texture_, "shaders/texture.vs", "shaders/texture.fs" );
 
-    if ( !shaderSimple_->isValid() || !shaderTexture_->isValid() )
-    {
-        throw std::logic_error( "Shader initialization failed!" );
-    }
+    simple_.shader->use();
+    glUniform4f( simple_.shader->uniformLocation( "colorIn" ), 1.0f, 1.0f, 0.0f, 1.0f );
+    texture_.shader->use();
+    glUniform1i( texture_.shader->uniformLocation( "sample" ), 0 );
+    current_ = &texture_;
 
-    ssProj_ = shaderSimple_->uniformLocation( "proj" );
-    ssColor_ = shaderSimple_->uniformLocation( "colorIn" );
-    stProj_ = shaderTexture_->uniformLocation( "proj" );
-    stSample_ = shaderTexture_->uniformLocation( "sample" );
+    glClearColor( 0.2f, 0.3f, 0.3f, 1.0f );
+    glLineWidth( 1.0f );
+    glActiveTexture( GL_TEXTURE0 );
 }
 
 
@@ -37,128 +45,230 @@ Renderer::~Renderer()
 }
 
 
-
-
 /*!
  * Implements GlobeViewer::render.
  */
 void Renderer::render()
 {
-    glClearColor( 0.2f, 0.3f, 0.3f, 1.0f );
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-    boost::optional<glm::mat4> optProjection = getProjection();
-
-    if ( !optProjection )
+    if ( !listValid_.exchange( true ) )
     {
-        throw std::logic_error( "Renderer cannot get projection!" );
+        buildDrawList();
     }
 
-    const auto proj = *optProjection;
-
-    shaderTexture_->use();
-    glUniformMatrix4fv( stProj_, 1, GL_FALSE, glm::value_ptr( proj ) );
-
-    if ( drawMap_ && mapReady_ )
-    {   // Map tiles
-        boost::optional<std::tuple<GLuint, GLuint, GLsizei>> optMapTiles = renderMapTiles();
+    for ( const auto& call : drawList_ )
+    {
+        Program& program = *call.program;
 
-        if ( optMapTiles )
+        if ( current_ != &program )
         {
-            std::tuple<GLuint, GLuint, GLsizei> params = *optMapTiles;
-            const auto vao = std::get<0>( params );
-            const auto tex = std::get<1>( params );
-            const auto num = std::get<2>( params );
-
-            if ( num > 0 )
-            {
-                glBindVertexArray( vao );
-                glActiveTexture( GL_TEXTURE0 );
-                glBindTexture( GL_TEXTURE_2D, tex );
-                glDrawArrays( GL_TRIANGLES, 0, num );
-                glBindTexture( GL_TEXTURE_2D, 0 );
-                glBindVertexArray( 0 );
-            }
+            program.shader->use();
+            current_ = &program;
         }
-    }
-
-    shaderSimple_->use();
-    glUniformMatrix4fv( ssProj_, 1, GL_FALSE, glm::value_ptr( proj ) );
-
-    /*
-    {   // Simple Triangle
-        glUniform4fv( ssColor_, 1, glm::value_ptr( glm::vec4( 1.0f, 0.0f, 0.0f, 1.0f ) ) );
 
-        boost::optional<std::tuple<GLuint, GLsizei>> optSimpleTriangle = renderSimpleTriangle();
-
-        if ( optSimpleTriangle )
+        if ( program.projVersion != projVersion_ )
         {
-            std::tuple<GLuint, std::size_t> params = *optSimpleTriangle;
-            const auto vao = std::get<0>( params );
-            const auto num = std::get<1>( params );
-
-            if ( num > 0 )
-            {
-                glBindVertexArray( vao );
-                glDrawArrays( GL_TRIANGLES, 0, num );
-                glBindVertexArray( 0 );
-            }
+            glUniformMatrix4fv( program.proj, 1, GL_FALSE, glm::value_ptr( proj_ ) );
+            program.projVersion = projVersion_;
         }
-    }
-    //*/
-
-    if ( drawWires_ )
-    {   // Wire Globe
-        glUniform4fv( ssColor_, 1, glm::value_ptr( glm::vec4( 1.0f, 1.0f, 0.0f, 1.0f ) ) );
 
-        boost::optional<std::tuple<GLuint, GLsizei>> optWireGlobe = renderWireGlobe();
+        setGlobeUniforms( program, call.geographic );
+        glBindVertexArray( call.vao );
 
-        if ( optWireGlobe )
+        if ( call.tex != 0 )
         {
-            std::tuple<GLuint, std::size_t> params = *optWireGlobe;
-            const auto vao = std::get<0>( params );
-            const auto num = std::get<1>( params );
-
-            if ( num > 0 )
-            {
-                glLineWidth( 1.0f );
-                glBindVertexArray( vao );
-                glDrawArrays( GL_LINES, 0, num );
-                glBindVertexArray( 0 );
-            }
+            glBindTexture( GL_TEXTURE_2D, call.tex );
         }
+
+        glDrawElements( call.mode, call.num, call.type, ( void* ) 0 );
     }
+
+    glBindVertexArray( 0 );
 }
 
 
 /*!
+ * Can be called from any thread.
  * \param[in] val True - ready, false - not ready.
  */
 void Renderer::setMapReady( bool val )
 {
-    mapReady_ = val;
+    if ( mapReady_.exchange( val ) != val )
+    {
+        listValid_ = false;
+        changed();
+    }
 }
 
 
-
 /*!
  * Implements GlobeViewer::setWireFrameView.
  * \param[in] val True - turn on, false - turn off.
  */
 void Renderer::setDrawWires( bool val )
 {
-    drawWires_ = val;
+    if ( drawWires_ != val )
+    {
+        drawWires_ = val;
+        listValid_ = false;
+        changed();
+    }
 }
 
 
-
 /*!
-* Implements GlobeViewer::setMapTilesView.
-* \param[in] val True - turn on, false - turn off.
-*/
+ * Implements GlobeViewer::setMapTilesView.
+ * \param[in] val True - turn on, false - turn off.
+ */
 void Renderer::setDrawMap( bool val )
 {
-    drawMap_ = val;
+    if ( drawMap_ != val )
+    {
+        drawMap_ = val;
+        listValid_ = false;
+        changed();
+    }
+}
+
+
+/*!
+ * Shaders get the new projection when they are used next time.
+ * \param[in] proj OpenGL projection.
+ */
+void Renderer::updateProjection( glm::mat4 proj )
+{
+    proj_ = proj;
+    ++projVersion_;
+}
+
+
+/*!
+ * \param[in] vao Vertex array object for wire-frame model of the Globe.
+ * \param[in] num Number of indices (unsigned shorts).
+ * \param[in] geographic Indicator of vertices being longitudes and latitudes to be projected on the GPU.
+ */
+void Renderer::updateWireGlobe( GLuint vao, GLsizei num, bool geographic )
+{
+    wire_.vao = vao;
+    wire_.num = num;
+    wire_.geographic = geographic;
+    listValid_ = false;
+}
+
+
+/*!
+ * \param[in] vao Vertex array object for map tiles.
+ * \param[in] tex Texture for map tiles.
+ * \param[in] num Number of indices.
+ * \param[in] type Type of indices.
+ * \param[in] geographic Indicator of vertices being longitudes and latitudes to be projected on the GPU.
+ */
+void Renderer::updateMapTiles( GLuint vao, GLuint tex, GLsizei num, GLenum type, bool geographic )
+{
+    map_.vao = vao;
+    map_.tex = tex;
+    map_.num = num;
+    map_.type = type;
+    map_.geographic = geographic;
+    listValid_ = false;
+}
+
+
+/*!
+ * \param[out] program Shader and locations of its uniforms.
+ * \param[in] vert Path to vertex shader.
+ * \param[in] frag Path to fragment shader.
+ * \exception std::logic_error If shader is not valid.
+ */
+void Renderer::loadProgram( Program& program, const std::string& vert, const std::string& frag )
+{
+    program.shader.reset( new support::Shader( vert, frag ) );
+
+    if ( !program.shader->isValid() )
+    {
+        throw std::logic_error( "Shader initialization failed!" );
+    }
+
+    const auto& shader = *program.shader;
+    program.proj = shader.uniformLocation( "proj" );
+    program.globe = { shader.uniformLocation( "geographic" ), shader.uniformLocation( "center" ), shader.uniformLocation( "earth" ) };
+    program.projVersion = 0;
+    program.geographic = -1;
+}
+
+
+/*!
+ * Map goes first, wire-frame model is drawn over it.
+ * Entities with nothing to draw are left out.
+ */
+void Renderer::buildDrawList()
+{
+    drawList_.clear();
+
+    if ( drawMap_ && mapReady_ && map_.num > 0 )
+    {
+        drawList_.emplace_back( map_ );
+    }
+
+    if ( drawWires_ && wire_.num > 0 )
+    {
+        drawList_.emplace_back( wire_ );
+    }
+}
+
+
+/*!
+ * Geographic vertices are projected on the GPU with parameters
+ * of the current projection, the same ones OrthoKernel uses. They are
+ * uploaded only when projection has changed since the shader got them.
+ * \param[in] program Shader in use.
+ * \param[in] geographic True - vertices are longitudes and latitudes, false - vertices are projected.
+ */
+void Renderer::setGlobeUniforms( Program& program, bool geographic )
+{
+    if ( program.geographic != static_cast<int>( geographic ) )
+    {
+        glUniform1i( program.globe.geographic, geographic ? GL_TRUE : GL_FALSE );
+        program.geographic = geographic;
+    }
+
+    if ( !geographic )
+    {
+        return;
+    }
+
+    if ( !projector_ )
+    {
+        boost::optional<std::shared_ptr<Projector>> optProjector = getProjector();
+        boost::optional<float> optUnitInMeter = getUnitInMeter();
+
+        if ( !optProjector )
+        {
+            throw std::logic_error( "Renderer cannot get projector!" );
+        }
+
+        if ( !optUnitInMeter )
+        {
+            throw std::logic_error( "Renderer cannot get units in meter!" );
+        }
+
+        projector_ = *optProjector;
+        unitInMeter_ = *optUnitInMeter;
+    }
+
+    auto projection = projector_->projection();
+
+    if ( projection == program.projection )
+    {
+        return;
+    }
+
+    const OrthoParams& params = projection->orthoParams();
+    glUniform4f( program.globe.center, static_cast<GLfloat>( params.lam0 ), static_cast<GLfloat>( params.sinPhi0 ),
+        static_cast<GLfloat>( params.cosPhi0 ), static_cast<GLfloat>( params.nu0 ) );
+    glUniform2f( program.globe.earth, static_cast<GLfloat>( params.a * unitInMeter_ ), static_cast<GLfloat>( params.e2 ) );
+    program.projection = std::move( projection );
 }
 
 
@@ -0,0 +1,406 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Defines.h"
+#include "Profiler.h"
+#include "Projection.h"
+#include "TileSelector.h"
+
+
+using namespace defs;
+
+
+namespace gv {
+
+
+using namespace support;
+
+
+TileSelector::TileSelector()
+    : projection_( nullptr )
+    , z_( 0 )
+    , x0_( 0.0 )
+    , x1_( 0.0 )
+    , y0_( 0.0 )
+    , y1_( 0.0 )
+{
+}
+
+
+TileSelector::~TileSelector()
+{
+}
+
+
+/*!
+ * Besides visible tiles the result contains their direct neighbours as a tile
+ * may be visible even if none of its corners are.
+ * \param[in] projection Projection to select tiles for.
+ * \param[in] vd Viewport data.
+ * \param[in] z Map zoom level.
+ * \param[in] x Tile coordinate x of a visible tile.
+ * \param[in] y Tile coordinate y of a visible tile.
+ * \return Vector of tile headers, valid till the next selection.
+ */
+const std::vector<TileHead>& TileSelector::select( const Projection& projection, const ViewData& vd, int z, int x, int y )
+{
+    Profiler prof( "TileSelector::select" );
+
+    projection_ = &projection;
+    z_ = z;
+    setView( vd );
+
+    // Containers are emptied before the arena they take memory from
+    visited_ = KeySet( KeySet::allocator_type( &arena_ ) );
+    corners_ = CornerMap( CornerMap::allocator_type( &arena_ ) );
+    arena_.release();
+    frontier_.clear();
+
+    auto& res = selected_;
+    res.clear();
+    res.emplace_back( z, x, y );
+    visited_.emplace( key( x, y ) );
+    frontier_.emplace_back( z, x, y );
+
+    const int maxInd = ( 1 << z ) - 1;
+
+    while ( !frontier_.empty() )
+    {
+        candidates_.clear();
+
+        for ( const auto& head : frontier_ )
+        {
+            const TileHead adj[4] = {
+                { head.z, head.x, head.y + 1 },
+                { head.z, head.x, head.y - 1 },
+                { head.z, head.x == maxInd ? 0 : head.x + 1, head.y },
+                { head.z, head.x == 0 ? maxInd : head.x - 1, head.y }
+            };
+
+            for ( const auto& item : adj )
+            {
+                if ( item.y < 0 || maxInd < item.y )
+                {
+                    continue;
+                }
+
+                if ( visited_.emplace( key( item.x, item.y ) ).second )
+                {
+                    candidates_.emplace_back( item );
+                }
+            }
+        }
+
+        res.insert( res.end(), candidates_.begin(), candidates_.end() );
+        projectCorners( candidates_ );
+        frontier_.clear();
+
+        for ( const auto& item : candidates_ )
+        {
+            if ( tileVisible( item ) )
+            {
+                frontier_.emplace_back( item );
+            }
+        }
+    }
+
+    return res;
+}
+
+
+/*!
+ * A tile is split while its projected size exceeds its side multiplied by
+ * square root of two, so the chosen tiles are displayed with a scale
+ * between 0.7 and 1.4. Tiles are never split beyond maxZ.
+ * \param[in] projection Projection to select tiles for.
+ * \param[in] vd Viewport data.
+ * \param[in] maxZ The highest map zoom level allowed.
+ * \return Vector of tile headers, zoom level may differ from tile to tile.
+ * It's valid till the next selection.
+ */
+const std::vector<TileHead>& TileSelector::selectLod( const Projection& projection, const ViewData& vd, int maxZ )
+{
+    Profiler prof( "TileSelector::selectLod" );
+
+    projection_ = &projection;
+    setView( vd );
+
+    const double splitSize = std::sqrt( 2.0 ) * defs::tileSide * vd.meterInPixel;
+    auto& res = selected_;
+    res.clear();
+    stack_.clear();
+    stack_.emplace_back( 0, 0, 0 );
+
+    while ( !stack_.empty() )
+    {
+        const TileHead head = stack_.back();
+        stack_.pop_back();
+        double size;
+
+        if ( !tileFootprint( head, size ) )
+        {
+            continue;
+        }
+
+        if ( head.z < maxZ && splitSize < size )
+        {
+            const int z = head.z + 1;
+            const int x = head.x * 2;
+            const int y = head.y * 2;
+            stack_.emplace_back( z, x, y );
+            stack_.emplace_back( z, x + 1, y );
+            stack_.emplace_back( z, x, y + 1 );
+            stack_.emplace_back( z, x + 1, y + 1 );
+        }
+        else
+        {
+            res.emplace_back( head );
+        }
+    }
+
+    return res;
+}
+
+
+/*!
+ * \param[in] lon Longitude.
+ * \param[in] z Map zoom level.
+ * \return Tile coordinate x.
+ */
+int TileSelector::lonToTileX( double lon, int z )
+{
+    return static_cast<int>( std::floor( ( lon + 180.0 ) / 360.0 * std::pow( 2.0, z ) ) );
+}
+
+
+/*!
+ * \param[in] lat Latitude.
+ * \param[in] z Map zoom level.
+ * \return Tile coordinate y.
+ */
+int TileSelector::latToTileY( double lat, int z )
+{
+    return static_cast<int>(
+        floor( ( 1.0 - log( tan( lat * degToRad ) + 1.0 / cos( lat * degToRad ) ) / pi ) /
+            2.0 * pow( 2.0, z ) ) );
+}
+
+
+/*!
+ * \param[in] x Tile coordinate x.
+ * \param[in] z Map zoom level.
+ * \return Longitude.
+ */
+double TileSelector::tileXToLon( int x, int z )
+{
+    return x / pow( 2.0, z ) * 360.0 - 180;
+}
+
+
+/*!
+ * \param[in] y Tile coordinate y.
+ * \param[in] z Map zoom level.
+ * \return Latitude.
+ */
+double TileSelector::tileYToLat( int y, int z )
+{
+    double n = pi - 2.0 * pi * y / std::pow( 2.0, z );
+    return 180.0 / pi * std::atan( 0.5 * ( std::exp( n ) - std::exp( -n ) ) );
+}
+
+
+/*!
+ * \param[in] vd Viewport data.
+ */
+void TileSelector::setView( const ViewData& vd )
+{
+    x0_ = vd.glX0 / vd.unitInMeter;
+    x1_ = vd.glX1 / vd.unitInMeter;
+    y0_ = vd.glY0 / vd.unitInMeter;
+    y1_ = vd.glY1 / vd.unitInMeter;
+}
+
+
+/*!
+ * \param[in] x Coordinate x.
+ * \param[in] y Coordinate y.
+ * \return Key unique for the pair.
+ */
+std::uint64_t TileSelector::key( int x, int y )
+{
+    return ( static_cast<std::uint64_t>( static_cast<std::uint32_t>( x ) ) << 32 ) | static_cast<std::uint32_t>( y );
+}
+
+
+/*!
+ * Corner is considered visible if it's projected inside the view.
+ * All corners are projected with a single call.
+ * \param[in] vec Tiles which corners are required.
+ */
+void TileSelector::projectCorners( const std::vector<TileHead>& vec )
+{
+    pending_.clear();
+
+    for ( const auto& head : vec )
+    {
+        for ( int i = 0; i < 4; ++i )
+        {
+            const auto k = key( head.x + i % 2, head.y + i / 2 );
+
+            if ( corners_.emplace( k, false ).second )
+            {
+                pending_.emplace_back( k );
+            }
+        }
+    }
+
+    const std::size_t count = pending_.size();
+    cornerX_.resize( count );
+    cornerY_.resize( count );
+
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        const int cx = static_cast<int>( pending_[i] >> 32 );
+        const int cy = static_cast<int>( pending_[i] & 0xFFFFFFFF );
+        cornerX_[i] = tileXToLon( cx, z_ );
+        cornerY_[i] = tileYToLat( cy, z_ );
+    }
+
+    projection_->projectFwd( cornerX_.data(), cornerY_.data(), cornerX_.data(), cornerY_.data(), count );
+
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        const double tx = cornerX_[i];
+        const double ty = cornerY_[i];
+        corners_[pending_[i]] = x0_ < tx && tx < x1_ && y0_ < ty && ty < y1_;
+    }
+}
+
+
+/*!
+ * \param[in] th Tile header.
+ * \return True - tile is visible, false - tile is not visible.
+ */
+bool TileSelector::tileVisible( const TileHead& th ) const
+{
+    for ( int i = 0; i < 4; ++i )
+    {
+        auto it = corners_.find( key( th.x + i % 2, th.y + i / 2 ) );
+
+        if ( it != corners_.end() && it->second )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/*!
+ * Tile is sampled with a regular grid, large tiles of low zoom levels get
+ * denser grid. Projected size is the geometric mean of the longest row and
+ * the longest column of the grid, so the tiles foreshortened near the limb are
+ * considered small. Bounding box of visible samples is padded by the longest
+ * distance between neighbouring samples to cover parts of the tile between
+ * the samples, therefore the check is conservative. Tiles entirely on the far
+ * side of the Globe are rejected in closed form without sampling.
+ * \param[in] th Tile header.
+ * \param[out] size Projected size of the tile (in meters).
+ * \return True - tile may be visible, false - tile is not visible.
+ */
+bool TileSelector::tileFootprint( const TileHead& th, double& size )
+{
+    size = 0.0;
+
+    if ( !projection_->facingArea( tileXToLon( th.x, th.z ), tileYToLat( th.y + 1, th.z ),
+        tileXToLon( th.x + 1, th.z ), tileYToLat( th.y, th.z ) ) )
+    {
+        return false;
+    }
+
+    const int shift = th.z < 3 ? 3 : 1;
+    const int segs = 1 << shift;
+    const int side = segs + 1;
+    sampleX_.resize( side * side );
+    sampleY_.resize( side * side );
+
+    for ( int j = 0; j < side; ++j )
+    {
+        const double lat = tileYToLat( ( th.y << shift ) + j, th.z + shift );
+
+        for ( int i = 0; i < side; ++i )
+        {
+            sampleX_[j * side + i] = tileXToLon( ( th.x << shift ) + i, th.z + shift );
+            sampleY_[j * side + i] = lat;
+        }
+    }
+
+    projection_->projectFwd( sampleX_.data(), sampleY_.data(), sampleX_.data(), sampleY_.data(), sampleX_.size() );
+
+    double bx0 = HUGE_VAL;
+    double bx1 = -HUGE_VAL;
+    double by0 = HUGE_VAL;
+    double by1 = -HUGE_VAL;
+
+    for ( std::size_t n = 0; n < sampleX_.size(); ++n )
+    {
+        if ( sampleX_[n] != HUGE_VAL )
+        {
+            bx0 = std::min( bx0, sampleX_[n] );
+            bx1 = std::max( bx1, sampleX_[n] );
+            by0 = std::min( by0, sampleY_[n] );
+            by1 = std::max( by1, sampleY_[n] );
+        }
+    }
+
+    if ( bx1 < bx0 )
+    {
+        return false;
+    }
+
+    double pad = 0.0;
+    double rowMax = 0.0;
+    double colMax = 0.0;
+
+    // n - sample index, step - index offset to the next sample along row or column
+    auto segment = [this, &pad]( int n, int step ) -> double
+    {
+        if ( sampleX_[n] == HUGE_VAL || sampleX_[n + step] == HUGE_VAL )
+        {
+            return 0.0;
+        }
+
+        const double d = std::hypot( sampleX_[n + step] - sampleX_[n], sampleY_[n + step] - sampleY_[n] );
+        pad = std::max( pad, d );
+        return d;
+    };
+
+    for ( int j = 0; j < side; ++j )
+    {
+        double rowLen = 0.0;
+        double colLen = 0.0;
+
+        for ( int i = 0; i < segs; ++i )
+        {
+            rowLen += segment( j * side + i, 1 );
+            colLen += segment( i * side + j, side );
+        }
+
+        rowMax = std::max( rowMax, rowLen );
+        colMax = std::max( colMax, colLen );
+    }
+
+    size = std::sqrt( rowMax * colMax );
+
+    if ( pad == 0.0 )
+    {   // isolated visible samples at the limb, take the largest possible extent of the tile
+        pad = 2.0 * pi * earthRadius / ( 1 << th.z );
+        size = pad;
+    }
+
+    return bx0 - pad < x1_ && x0_ < bx1 + pad && by0 - pad < y1_ && y0_ < by1 + pad;
+}
+
+
+}
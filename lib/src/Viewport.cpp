@@ -31,6 +31,7 @@ const std::map<float, float> Viewport::zoomMap_ = {
     { unitInMeter_ * 40000.0, 900 * unitInMeter_ },
     { maxUnitInPixel_, 1000 * unitInMeter_ }
 };
+const std::vector<float> Viewport::zoomScales_ = Viewport::zoomScales();
 
 Viewport::Viewport()
     : pixelW_( 0 )
@@ -41,7 +42,8 @@ Viewport::Viewport()
     , unitH_( 0.0f )
     , panX_( 0.0f )
     , panY_( 0.0f )
-    , unitInPixel_( maxUnitInPixel_ )
+    , zoomStep_( 0 )
+    , unitInPixel_( zoomScales_.front() )
     , meterInPixel_( unitInPixel_ / unitInMeter_ )
     , zNear_( 0.0f )
     , zFar_( 100.0f )
@@ -83,8 +85,7 @@ void Viewport::resize( int w, int h )
  */
 void Viewport::move( int x, int y )
 {
-    panX_ -= unitInPixel_ * x;
-    panY_ -= unitInPixel_ * y;
+    pan( x, y );
     setProjection();
 }
 
@@ -95,45 +96,45 @@ void Viewport::move( int x, int y )
  */
 void Viewport::zoom( int steps )
 {
-    const auto prevUnitInPixel = unitInPixel_;
-    const int sign = steps > 0 ? 1 : -1;
-
-    for ( int i = 0; i < std::abs( steps ); ++i )
+    if ( scale( steps ) )
     {
-        const auto er = zoomMap_.equal_range( unitInPixel_ );
-        float diff;
+        setProjection();
+    }
+}
 
-        if ( er.first == er.second )
-        {
-            diff = er.first->second;
-        }
-        else if ( sign < 0 && er.second != zoomMap_.end() )
-        {
-            diff = er.second->second;
-        }
-        else
+
+/*!
+ * Panning and zooming merged from several input events. Every panning is
+ * converted to GL units at the scale it was done at, which is found by zooming
+ * from the current scale, so the result is the same as applying the events
+ * one by one unless the scale hits its limits in between. Projection is
+ * recalculated once for all of them.
+ * \param[in] delta Merged input events.
+ */
+void Viewport::moveZoom( const support::InputQueue::Delta& delta )
+{
+    const int levels = support::InputQueue::panLevels;
+    bool moved = false;
+
+    for ( int i = 0; i < levels; ++i )
+    {
+        if ( delta.moveX[i] == 0 && delta.moveY[i] == 0 )
         {
-            diff = er.first->second;
+            continue;
         }
 
-        unitInPixel_ -= diff * sign;
-        unitInPixel_ = std::min( unitInPixel_, maxUnitInPixel_ );
-        unitInPixel_ = std::max( unitInPixel_, minUnitInPixel_ );
+        const float unitInPixel = zoomScales_[zoomed( i - levels / 2 )];
+        panX_ -= unitInPixel * delta.moveX[i];
+        panY_ -= unitInPixel * delta.moveY[i];
+        moved = true;
     }
 
-    if ( prevUnitInPixel == unitInPixel_)
+    const bool scaled = scale( delta.zoom );
+
+    if ( scaled || moved )
     {
-        return;
+        setProjection();
     }
-
-    meterInPixel_ = unitInPixel_ / unitInMeter_;
-    const auto prevUnitW = unitW_;
-    const auto prevUnitH = unitH_;
-    unitW_ = unitInPixel_ * pixelW_;
-    unitH_ = unitInPixel_ * pixelH_;
-    unitX_ -= ( unitW_ - prevUnitW ) / 2;
-    unitY_ -= ( unitH_ - prevUnitH ) / 2;
-    setProjection();
 }
 
 
@@ -210,6 +211,76 @@ std::tuple<double, double> Viewport::metersAtPixel( int x, int y ) const
 }
 
 
+/*!
+ * Shift the viewport without recalculating projection.
+ * \param[in] x Offset along x axis (in pixels).
+ * \param[in] y Offset along y axis (in pixels).
+ */
+void Viewport::pan( int x, int y )
+{
+    panX_ -= unitInPixel_ * x;
+    panY_ -= unitInPixel_ * y;
+}
+
+
+/*!
+ * Change units ratio without recalculating projection.
+ * \param[in] steps Number of steps to zoom. Positive - zooming in, negative - zooming out.
+ * \return True if the scale has changed, false if it's at its limit.
+ */
+bool Viewport::scale( int steps )
+{
+    const int step = zoomed( steps );
+
+    if ( step == zoomStep_ )
+    {
+        return false;
+    }
+
+    zoomStep_ = step;
+    unitInPixel_ = zoomScales_[zoomStep_];
+    meterInPixel_ = unitInPixel_ / unitInMeter_;
+    const auto prevUnitW = unitW_;
+    const auto prevUnitH = unitH_;
+    unitW_ = unitInPixel_ * pixelW_;
+    unitH_ = unitInPixel_ * pixelH_;
+    unitX_ -= ( unitW_ - prevUnitW ) / 2;
+    unitY_ -= ( unitH_ - prevUnitH ) / 2;
+    return true;
+}
+
+
+/*!
+ * Scales are found by zooming in from the maximum value of unitInPixel_ with steps
+ * of zoomMap_ until the minimum value is reached. Zooming out goes back the same way,
+ * so any sequence of steps that doesn't hit the limits depends only on their sum.
+ * \return Values of unitInPixel_ from the largest to the smallest one.
+ */
+std::vector<float> Viewport::zoomScales()
+{
+    std::vector<float> scales = { maxUnitInPixel_ };
+
+    while ( scales.back() > minUnitInPixel_ )
+    {
+        const float diff = zoomMap_.lower_bound( scales.back() )->second;
+        scales.push_back( std::max( scales.back() - diff, minUnitInPixel_ ) );
+    }
+
+    return scales;
+}
+
+
+/*!
+ * \param[in] steps Number of steps to zoom from the current scale. Positive - zooming in, negative - zooming out.
+ * \return Index in zoomScales_ clamped to its limits.
+ */
+int Viewport::zoomed( int steps ) const
+{
+    const int last = static_cast<int>( zoomScales_.size() ) - 1;
+    return std::max( 0, std::min( zoomStep_ + steps, last ) );
+}
+
+
 /*!
  * Uses glm::lookAt and glm::ortho.
  */
@@ -225,6 +296,7 @@ void Viewport::setProjection()
         unitY_ + panY_, unitY_ + panY_ + unitH_,
         zNear_, zFar_ ) *
         view;
+    projectionUpdated( proj_ );
     viewUpdated( viewData() );
 }
 
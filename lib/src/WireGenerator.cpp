@@ -0,0 +1,587 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "Defines.h"
+#include "Profiler.h"
+#include "Projector.h"
+#include "WireGenerator.h"
+
+
+namespace {
+
+
+const std::size_t buffersPooled = 2;    //!< Number of spare vertex and index buffers kept for reuse.
+const double gridGaps[] = { 30.0, 15.0, 10.0, 5.0, 2.0, 1.0, 0.5, 0.2, 0.1, 0.05, 0.02, 0.01,
+    0.005, 0.002, 0.001, 0.0005, 0.0002, 0.0001 };  //!< Spacing of graticule lines (in degrees) from the sparsest.
+const double minGapPixels = 60.0;       //!< The least spacing of graticule lines on the screen (in pixels).
+const long long segmentsInGap = 10;     //!< Number of segments between two neighbouring lines.
+const double gridLatLimit = 80.0;       //!< Graticule doesn't go closer to the poles (in degrees).
+const int viewSamples = 16;             //!< Number of parts each view side is split into when looking for visible area.
+const int horizonSamples = 180;         //!< Number of points of horizon checked when looking for visible area.
+
+
+/*!
+ * \param[in] a Dividend.
+ * \param[in] b Positive divisor.
+ * \return Quotient rounded down.
+ */
+long long floorDiv( long long a, long long b )
+{
+    return a >= 0 ? a / b : -( ( -a + b - 1 ) / b );
+}
+
+
+/*!
+ * \param[in] a Dividend.
+ * \param[in] b Positive divisor.
+ * \return Quotient rounded up.
+ */
+long long ceilDiv( long long a, long long b )
+{
+    return -floorDiv( -a, b );
+}
+
+
+}
+
+
+namespace gv {
+
+
+using namespace support;
+
+
+WireGenerator::WireGenerator()
+    : ioc_()
+    , work_( make_work_guard( ioc_ ) )
+    , gpuProjection_( false )
+    , generation_( 0 )
+    , composed_( false )
+    , geographic_( false )
+    , composedLon_( 0.0 )
+    , composedLat_( 0.0 )
+    , composedUnitInMeter_( 0.0f )
+    , grid_()
+    , verticesPool_( buffersPooled )
+    , indicesPool_( buffersPooled )
+{
+    threads_.emplace_back( [this]() { ioc_.run(); } );
+}
+
+
+WireGenerator::~WireGenerator()
+{
+    work_.reset();
+    ioc_.stop();
+
+    for ( auto&& t : threads_ )
+    {
+        if ( t.joinable() )
+        {
+            t.join();
+        }
+    }
+}
+
+
+/*!
+ * Request necessary data for composing wire-frame model and compose the first
+ * one so that there's the Globe displayed right after start.
+ * \param[in] vd Initial viewport data.
+ * \exception std::logic_error If getProjector is not connected.
+ */
+void WireGenerator::init( ViewData vd )
+{
+    if ( !getProjector() )
+    {
+        throw std::logic_error( "Cannot initialize WireGenerator: getProjector is not defined!" );
+    }
+    else
+    {
+        projector_ = *getProjector();
+    }
+
+    updateViewData( vd );
+}
+
+
+/*!
+ * Projected model must follow projection center, geographic one
+ * changes only if another part of the graticule becomes visible.
+ */
+void WireGenerator::updateGlobe()
+{
+    request();
+}
+
+
+/*!
+ * Visible part of the Globe and graticule spacing depend on the viewport.
+ * \param[in] vd New viewport data.
+ */
+void WireGenerator::updateViewData( ViewData vd )
+{
+    {
+        std::lock_guard<std::mutex> lock( mutexView_ );
+        newViewData_ = vd;
+    }
+
+    request();
+}
+
+
+/*!
+ * Implements GlobeViewer::setGpuProjection.
+ * Geographic wire-frame model of the Globe is composed only when visible part
+ * of the graticule changes, rotation of the Globe only changes projection
+ * center on the GPU. Views deeper than defs::gpuMaxZoom are projected on the CPU.
+ * \param[in] val True - project on the GPU, false - project on the CPU.
+ */
+void WireGenerator::updateGpuProjection( bool val )
+{
+    gpuProjection_.store( val );
+    request();
+}
+
+
+/*!
+ * Can be called from any thread. Composing happens in the worker thread
+ * with projection current at that moment.
+ */
+void WireGenerator::request()
+{
+    const unsigned long generation = ++generation_;
+    ioc_.post( [this, generation] { composeWireGlobe( generation ); } );
+}
+
+
+/*!
+ * \param[in] other Another part of the graticule.
+ * \return True if both parts consist of the same points.
+ */
+bool WireGenerator::Grid::operator==( const Grid& other ) const
+{
+    return step == other.step && lon0 == other.lon0 && lon1 == other.lon1
+        && lat0 == other.lat0 && lat1 == other.lat1 && closed == other.closed;
+}
+
+
+/*!
+ * Circles of latitude and meridians share points where they cross.
+ * \return Number of distinct points.
+ */
+std::size_t WireGenerator::Grid::points() const
+{
+    if ( step == 0.0 )
+    {
+        return 0;
+    }
+
+    const long long lonPoints = lon1 - lon0 + 1;
+    const long long latPoints = lat1 - lat0 + 1;
+    const long long circles = floorDiv( lat1, segmentsInGap ) - ceilDiv( lat0, segmentsInGap ) + 1;
+    const long long meridians = floorDiv( lon1, segmentsInGap ) - ceilDiv( lon0, segmentsInGap ) + 1;
+
+    return static_cast<std::size_t>( circles * lonPoints + meridians * ( latPoints - circles ) );
+}
+
+
+/*!
+ * View points and points of horizon inside the view are projected back to
+ * the Globe, the rectangle covers them all. If a pole is in the view,
+ * the rectangle goes around the Globe.
+ * \param[in] projection Current projection.
+ * \param[in] vd Viewport data.
+ * \param[out] lon0 The westernmost longitude, may be less than -180.
+ * \param[out] lon1 The easternmost longitude, may be greater than 180.
+ * \param[out] lat0 The southernmost latitude.
+ * \param[out] lat1 The northernmost latitude.
+ * \return True - some part of the Globe is visible, false - the view misses the Globe.
+ */
+bool WireGenerator::visibleArea( const Projection& projection, const ViewData& vd, double& lon0, double& lon1, double& lat0, double& lat1 )
+{
+    const double x0 = vd.glX0 / vd.unitInMeter;
+    const double x1 = vd.glX1 / vd.unitInMeter;
+    const double y0 = vd.glY0 / vd.unitInMeter;
+    const double y1 = vd.glY1 / vd.unitInMeter;
+    const double radius = projection.globeRadius();
+
+    // the view point nearest to the Globe center
+    const double nearX = std::min( std::max( 0.0, x0 ), x1 );
+    const double nearY = std::min( std::max( 0.0, y0 ), y1 );
+
+    if ( radius * radius <= nearX * nearX + nearY * nearY )
+    {
+        return false;
+    }
+
+    samplesX_.clear();
+    samplesY_.clear();
+    samplesX_.emplace_back( nearX );
+    samplesY_.emplace_back( nearY );
+
+    for ( int i = 0; i <= viewSamples; ++i )
+    {
+        for ( int j = 0; j <= viewSamples; ++j )
+        {
+            samplesX_.emplace_back( x0 + ( x1 - x0 ) * i / viewSamples );
+            samplesY_.emplace_back( y0 + ( y1 - y0 ) * j / viewSamples );
+        }
+    }
+
+    // slightly inside the horizon, so that projecting back doesn't fail
+    const double horizon = radius * 0.999;
+
+    for ( int i = 0; i < horizonSamples; ++i )
+    {
+        const double angle = 2.0 * defs::pi * i / horizonSamples;
+        const double x = horizon * std::cos( angle );
+        const double y = horizon * std::sin( angle );
+
+        if ( x0 <= x && x <= x1 && y0 <= y && y <= y1 )
+        {
+            samplesX_.emplace_back( x );
+            samplesY_.emplace_back( y );
+        }
+    }
+
+    // longitudes and latitudes replace coordinates
+    projection.projectInv( samplesX_.data(), samplesY_.data(), samplesX_.data(), samplesY_.data(), samplesX_.size() );
+
+    double centerLon;
+    double centerLat;
+    projection.projectionCenter( centerLon, centerLat );
+    double west = HUGE_VAL;
+    double east = -HUGE_VAL;
+    lat0 = HUGE_VAL;
+    lat1 = -HUGE_VAL;
+
+    for ( std::size_t i = 0; i < samplesX_.size(); ++i )
+    {
+        if ( samplesX_[i] == HUGE_VAL )
+        {
+            continue;
+        }
+
+        // longitudes are relative to projection center so that the rectangle doesn't break at 180
+        const double lon = std::remainder( samplesX_[i] - centerLon, 360.0 );
+        west = std::min( west, lon );
+        east = std::max( east, lon );
+        lat0 = std::min( lat0, samplesY_[i] );
+        lat1 = std::max( lat1, samplesY_[i] );
+    }
+
+    if ( west == HUGE_VAL )
+    {
+        return false;
+    }
+
+    for ( double pole : { -90.0, 90.0 } )
+    {
+        double x;
+        double y;
+
+        if ( projection.projectFwd( 0.0, pole, x, y ) && x0 <= x && x <= x1 && y0 <= y && y <= y1 )
+        {
+            west = -180.0;
+            east = 180.0;
+            lat0 = std::min( lat0, pole );
+            lat1 = std::max( lat1, pole );
+        }
+    }
+
+    lon0 = centerLon + west;
+    lon1 = centerLon + east;
+
+    return true;
+}
+
+
+/*!
+ * Lines are at least minGapPixels apart on the screen and there are ten
+ * segments between them. The rectangle is extended to whole spacings,
+ * so it stays the same while the view moves within them. If the part has too
+ * many points for unsigned short indices, a sparser spacing is taken.
+ * \param[in] vd Viewport data.
+ * \param[in] lon0 The westernmost visible longitude.
+ * \param[in] lon1 The easternmost visible longitude.
+ * \param[in] lat0 The southernmost visible latitude.
+ * \param[in] lat1 The northernmost visible latitude.
+ * \return Part of the graticule, it's empty if no line is visible.
+ */
+WireGenerator::Grid WireGenerator::chooseGrid( const ViewData& vd, double lon0, double lon1, double lat0, double lat1 ) const
+{
+    const double metersInDegree = defs::earthRadius * defs::degToRad;
+    const std::size_t levels = sizeof( gridGaps ) / sizeof( gridGaps[0] );
+    std::size_t level = 0;
+
+    while ( level + 1 < levels && minGapPixels <= gridGaps[level + 1] * metersInDegree / vd.meterInPixel )
+    {
+        ++level;
+    }
+
+    for ( ; ; --level )
+    {
+        const double gap = gridGaps[level];
+        const double step = gap / segmentsInGap;
+        const long long latLimit = static_cast<long long>( std::floor( gridLatLimit / gap + 1e-9 ) ) * segmentsInGap;
+
+        Grid grid;
+        grid.step = step;
+        grid.lat0 = std::max( static_cast<long long>( std::floor( lat0 / gap ) ) * segmentsInGap, -latLimit );
+        grid.lat1 = std::min( static_cast<long long>( std::ceil( lat1 / gap ) ) * segmentsInGap, latLimit );
+        grid.lon0 = static_cast<long long>( std::floor( lon0 / gap ) ) * segmentsInGap;
+        grid.lon1 = static_cast<long long>( std::ceil( lon1 / gap ) ) * segmentsInGap;
+        grid.closed = 360.0 <= ( grid.lon1 - grid.lon0 ) * step + gap;
+
+        if ( grid.closed )
+        {
+            grid.lon0 = std::llround( -180.0 / step );
+            grid.lon1 = std::llround( 180.0 / step ) - 1;
+        }
+
+        if ( grid.lat1 < grid.lat0 )
+        {
+            return Grid();
+        }
+
+        if ( grid.points() <= std::numeric_limits<GLushort>::max() || level == 0 )
+        {
+            return grid;
+        }
+    }
+}
+
+
+/*!
+ * Circles of latitude go first, then points of meridians which are not on
+ * circles of latitude, so every point of the graticule is listed once.
+ * Closed circles of latitude end with their first points.
+ * \param[in] grid Part of the graticule.
+ */
+void WireGenerator::composeGrid( const Grid& grid )
+{
+    lons_.clear();
+    lats_.clear();
+
+    if ( !segments_ || segments_.use_count() > 1 )
+    {
+        // the previous segments may be still referred to by a geographic model
+        segments_ = std::make_shared<std::vector<GLushort>>();
+    }
+
+    auto& seg = *segments_;
+    seg.clear();
+
+    if ( grid.points() == 0 )
+    {
+        x_.clear();
+        y_.clear();
+        visible_.clear();
+        return;
+    }
+
+    const long long lonPoints = grid.lon1 - grid.lon0 + 1;
+    const long long firstCircle = ceilDiv( grid.lat0, segmentsInGap ) * segmentsInGap;
+    const long long firstMeridian = ceilDiv( grid.lon0, segmentsInGap ) * segmentsInGap;
+
+    for ( long long lat = firstCircle; lat <= grid.lat1; lat += segmentsInGap )
+    {
+        for ( long long lon = grid.lon0; lon <= grid.lon1; ++lon )
+        {
+            lons_.emplace_back( lon * grid.step );
+            lats_.emplace_back( lat * grid.step );
+        }
+    }
+
+    const std::size_t meridianBase = lons_.size();
+    const long long ownPoints = grid.lat1 - grid.lat0 + 1 - ( floorDiv( grid.lat1, segmentsInGap ) - ceilDiv( grid.lat0, segmentsInGap ) + 1 );
+
+    for ( long long lon = firstMeridian; lon <= grid.lon1; lon += segmentsInGap )
+    {
+        for ( long long lat = grid.lat0; lat <= grid.lat1; ++lat )
+        {
+            if ( floorDiv( lat, segmentsInGap ) * segmentsInGap != lat )
+            {
+                lons_.emplace_back( lon * grid.step );
+                lats_.emplace_back( lat * grid.step );
+            }
+        }
+    }
+
+    auto pointOfMeridian = [&]( long long meridian, long long lat ) -> GLushort
+    {
+        const long long circlesBelow = floorDiv( lat, segmentsInGap ) - ceilDiv( grid.lat0, segmentsInGap ) + 1;
+
+        if ( floorDiv( lat, segmentsInGap ) * segmentsInGap == lat )
+        {
+            return static_cast<GLushort>( ( circlesBelow - 1 ) * lonPoints + meridian * segmentsInGap + firstMeridian - grid.lon0 );
+        }
+
+        return static_cast<GLushort>( meridianBase + meridian * ownPoints + lat - grid.lat0 - circlesBelow );
+    };
+
+    const long long circles = ( grid.lat1 - firstCircle ) / segmentsInGap + 1;
+    const long long circleSegments = grid.closed ? lonPoints : lonPoints - 1;
+
+    for ( long long circle = 0; circle < circles; ++circle )
+    {
+        for ( long long i = 0; i < circleSegments; ++i )
+        {
+            seg.emplace_back( static_cast<GLushort>( circle * lonPoints + i ) );
+            seg.emplace_back( static_cast<GLushort>( circle * lonPoints + ( i + 1 ) % lonPoints ) );
+        }
+    }
+
+    const long long meridians = ( grid.lon1 - firstMeridian ) / segmentsInGap + 1;
+
+    for ( long long meridian = 0; meridian < meridians; ++meridian )
+    {
+        for ( long long lat = grid.lat0; lat < grid.lat1; ++lat )
+        {
+            seg.emplace_back( pointOfMeridian( meridian, lat ) );
+            seg.emplace_back( pointOfMeridian( meridian, lat + 1 ) );
+        }
+    }
+
+    x_.resize( lons_.size() );
+    y_.resize( lons_.size() );
+    visible_.resize( lons_.size() );
+}
+
+
+/*!
+ * Requires direct access to Projector via pointer to speed up calculations.
+ * Composing the graticule requires projecting thousands of points, doing it
+ * for every frame makes a bottleneck, and access via Boost.Signal2
+ * makes performance unacceptable. So points of the graticule are generated
+ * only when its visible part changes, every point is projected only once
+ * and all of them with a single call.
+ * Lines are drawn with indices of their points, points and segments on the
+ * far side of the Globe are left out. The model is composed again only if
+ * projection center or the visible part of the graticule has changed since
+ * the latest one.
+ * When projecting on the GPU, points are kept as longitudes and latitudes
+ * (in radians) and projection center changes alone don't require a new model.
+ * \param[in] generation Generation of the request, it's skipped if there's a newer one.
+ */
+void WireGenerator::composeWireGlobe( unsigned long generation )
+{
+    if ( generation != generation_.load() )
+    {
+        return;
+    }
+
+    ViewData vd;
+    {
+        std::lock_guard<std::mutex> lock( mutexView_ );
+        vd = newViewData_;
+    }
+
+    const bool gpuProjection = gpuProjection_.load() && vd.mapZoomLevel <= defs::gpuMaxZoom;
+    const auto projection = projector_->projection();
+    double lon;
+    double lat;
+    projection->projectionCenter( lon, lat );
+
+    double lon0;
+    double lon1;
+    double lat0;
+    double lat1;
+    const Grid grid = visibleArea( *projection, vd, lon0, lon1, lat0, lat1 )
+        ? chooseGrid( vd, lon0, lon1, lat0, lat1 )
+        : Grid();
+
+    if ( composed_ && gpuProjection == geographic_ && grid == grid_ && vd.unitInMeter == composedUnitInMeter_
+        && ( gpuProjection || ( lon == composedLon_ && lat == composedLat_ ) ) )
+    {
+        return;
+    }
+
+    Profiler prof( "WireGenerator::composeWireGlobe" );
+
+    if ( !composed_ || !( grid == grid_ ) )
+    {
+        composeGrid( grid );
+    }
+
+    const std::size_t count = lons_.size();
+    auto vertices = verticesPool_.acquire();
+    auto& vec = *vertices;
+    std::shared_ptr<std::vector<GLushort>> indices;
+
+    if ( gpuProjection )
+    {
+        vec.resize( 2 * count );
+
+        for ( std::size_t i = 0; i < count; ++i )
+        {
+            vec[2 * i] = static_cast<GLfloat>( lons_[i] * defs::degToRad );
+            vec[2 * i + 1] = static_cast<GLfloat>( lats_[i] * defs::degToRad );
+        }
+
+        // the shader hides the far side
+        indices = segments_;
+    }
+    else
+    {
+        projection->projectFwd( lons_.data(), lats_.data(), x_.data(), y_.data(), count );
+
+        // only visible points are sent, visible_ maps graticule points to them
+        vec.clear();
+        GLushort next = 0;
+
+        for ( std::size_t i = 0; i < count; ++i )
+        {
+            if ( x_[i] != HUGE_VAL )
+            {
+                visible_[i] = next++;
+                vec.emplace_back( static_cast<GLfloat>( x_[i] * vd.unitInMeter ) );
+                vec.emplace_back( static_cast<GLfloat>( y_[i] * vd.unitInMeter ) );
+            }
+        }
+
+        indices = indicesPool_.acquire();
+        auto& ind = *indices;
+        ind.clear();
+
+        for ( std::size_t i = 0; i < segments_->size(); i += 2 )
+        {
+            const GLushort a = ( *segments_ )[i];
+            const GLushort b = ( *segments_ )[i + 1];
+
+            if ( x_[a] != HUGE_VAL && x_[b] != HUGE_VAL )
+            {
+                ind.emplace_back( visible_[a] );
+                ind.emplace_back( visible_[b] );
+            }
+        }
+    }
+
+    composed_ = true;
+    composedLon_ = lon;
+    composedLat_ = lat;
+    composedUnitInMeter_ = vd.unitInMeter;
+    geographic_ = gpuProjection;
+    grid_ = grid;
+
+    WireFrame frame;
+    frame.vertices = vertices;
+    frame.indices = indices;
+    frame.geographic = gpuProjection;
+    frame.generation = generation;
+    updateWireGlobe( frame );
+
+    verticesPool_.recycle( std::move( vertices ) );
+
+    if ( indices != segments_ )
+    {
+        indicesPool_.recycle( std::move( indices ) );
+    }
+}
+
+
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "Arena.h"
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * No memory is taken until the first allocation.
+ * \param[in] blockSize Size of the first block (in bytes).
+ */
+Arena::Arena( std::size_t blockSize )
+    : blockSize_( blockSize )
+    , total_( 0 )
+    , offset_( 0 )
+{
+}
+
+
+/*!
+ * Blocks grow twice, so the number of blocks stays small.
+ * \param[in] size Size of memory (in bytes).
+ * \param[in] alignment Alignment of memory (in bytes), a power of two.
+ * \return Pointer to allocated memory.
+ */
+void* Arena::allocate( std::size_t size, std::size_t alignment )
+{
+    std::size_t pad = blocks_.empty() ? 0 : padding( alignment );
+
+    if ( blocks_.empty() || blockSize_ < offset_ + pad + size )
+    {
+        grow( size + alignment );
+        pad = padding( alignment );
+    }
+
+    void* res = blocks_.back().get() + offset_ + pad;
+    offset_ += pad + size;
+    return res;
+}
+
+
+/*!
+ * If there's more than one block, they are replaced by a single block of their
+ * total size, so the same allocations fit there next time.
+ */
+void Arena::release()
+{
+    if ( 1 < blocks_.size() )
+    {
+        blocks_.clear();
+        blockSize_ = total_;
+        blocks_.emplace_back( new unsigned char[blockSize_] );
+    }
+
+    offset_ = 0;
+}
+
+
+/*!
+ * \param[in] size Size of memory (in bytes) the new block must fit.
+ */
+void Arena::grow( std::size_t size )
+{
+    if ( !blocks_.empty() )
+    {
+        blockSize_ *= 2;
+    }
+
+    blockSize_ = std::max( blockSize_, size );
+    blocks_.emplace_back( new unsigned char[blockSize_] );
+    total_ += blockSize_;
+    offset_ = 0;
+}
+
+
+/*!
+ * \param[in] alignment Alignment of memory (in bytes), a power of two.
+ * \return Number of bytes to skip in the last block to get aligned memory.
+ */
+std::size_t Arena::padding( std::size_t alignment ) const
+{
+    const auto address = reinterpret_cast<std::uintptr_t>( blocks_.back().get() + offset_ );
+    return ( alignment - address % alignment ) % alignment;
+}
+
+
+}
+}
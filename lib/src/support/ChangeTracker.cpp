@@ -0,0 +1,93 @@
+#include "ChangeTracker.h"
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * Nothing has been rendered yet, so the first frame is always required.
+ */
+ChangeTracker::ChangeTracker()
+    : dirty_( true )
+{
+}
+
+
+/*!
+ * The callback is called only if the image was up to date, so a burst
+ * of changes between two frames wakes the host once. It's called without
+ * holding the lock, so it may check the mark itself.
+ */
+void ChangeTracker::mark()
+{
+    std::function<void()> callback;
+
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+
+        if ( dirty_ )
+        {
+            return;
+        }
+
+        dirty_ = true;
+        callback = callback_;
+    }
+
+    cv_.notify_all();
+
+    if ( callback )
+    {
+        callback();
+    }
+}
+
+
+/*!
+ * Must be called before rendering a frame, not after it, so changes made
+ * while the frame is being rendered require the next one.
+ */
+void ChangeTracker::clear()
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    dirty_ = false;
+}
+
+
+/*!
+ * \return True - the image must be rendered again, false - it's up to date.
+ */
+bool ChangeTracker::dirty() const
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    return dirty_;
+}
+
+
+/*!
+ * Returns immediately if the image is out of date already.
+ * \param[in] timeout The longest time to wait.
+ * \return True - the image is out of date, false - timeout expired.
+ */
+bool ChangeTracker::wait( std::chrono::milliseconds timeout )
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    return cv_.wait_for( lock, timeout, [this] { return dirty_; } );
+}
+
+
+/*!
+ * The callable is called in the thread making the change, it must be quick
+ * and must not wait for that thread.
+ * \param[in] callback A callable or empty function to remove the previous one.
+ */
+void ChangeTracker::setCallback( std::function<void()> callback )
+{
+    std::lock_guard<std::mutex> lock( mutex_ );
+    callback_ = std::move( callback );
+}
+
+
+}
+}
@@ -0,0 +1,103 @@
+#include "FrameScheduler.h"
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \param[in] budget Time from request to the end of rendering a frame may take without being late.
+ */
+FrameScheduler::FrameScheduler( std::chrono::microseconds budget )
+    : budget_( std::chrono::duration_cast<Clock::duration>( budget ) )
+    , pending_( false )
+    , requestTime_( 0 )
+    , renderTime_( 0 )
+    , requested_( 0 )
+    , rendered_( 0 )
+    , dropped_( 0 )
+    , late_( 0 )
+    , lastLatency_( 0 )
+    , maxLatency_( 0 )
+{
+}
+
+
+/*!
+ * Can be called from any thread.
+ * \return True - there was no pending frame, the caller must schedule one
+ * and call begin() and end() around its rendering. False - a frame is already
+ * pending and the request is merged into it.
+ */
+bool FrameScheduler::request()
+{
+    ++requested_;
+
+    if ( pending_.exchange( true, std::memory_order_acq_rel ) )
+    {
+        ++dropped_;
+        return false;
+    }
+
+    requestTime_.store( Clock::now().time_since_epoch().count(), std::memory_order_relaxed );
+    return true;
+}
+
+
+/*!
+ * Must be called in the rendering thread before rendering the scheduled frame.
+ * Requests made from this moment schedule the next frame since the current
+ * one may miss the latest changes.
+ */
+void FrameScheduler::begin()
+{
+    renderTime_ = requestTime_.load( std::memory_order_relaxed );
+    pending_.store( false, std::memory_order_release );
+}
+
+
+/*!
+ * Must be called in the rendering thread after rendering the scheduled frame.
+ */
+void FrameScheduler::end()
+{
+    const Clock::rep latency = Clock::now().time_since_epoch().count() - renderTime_;
+
+    lastLatency_.store( latency, std::memory_order_relaxed );
+    if ( latency > maxLatency_.load( std::memory_order_relaxed ) )
+    {
+        maxLatency_.store( latency, std::memory_order_relaxed );
+    }
+
+    if ( latency > budget_.count() )
+    {
+        ++late_;
+    }
+
+    ++rendered_;
+}
+
+
+/*!
+ * Can be called from any thread. Counters are read one by one,
+ * so they may be slightly out of step with each other.
+ * \return Statistics of requested, rendered, dropped and late frames.
+ */
+FrameStats FrameScheduler::stats() const
+{
+    using Ms = std::chrono::duration<double, std::milli>;
+
+    FrameStats res;
+    res.requested = requested_.load();
+    res.rendered = rendered_.load();
+    res.dropped = dropped_.load();
+    res.late = late_.load();
+    res.lastLatency = Ms( Clock::duration( lastLatency_.load() ) ).count();
+    res.maxLatency = Ms( Clock::duration( maxLatency_.load() ) ).count();
+
+    return res;
+}
+
+
+}
+}
@@ -0,0 +1,48 @@
+#include <new>
+
+#include "HandlerMemory.h"
+
+
+namespace gv {
+namespace support {
+
+
+HandlerMemory::HandlerMemory()
+    : inUse_( false )
+{
+}
+
+
+/*!
+ * \param[in] size Size of memory (in bytes).
+ * \return Pointer to allocated memory.
+ */
+void* HandlerMemory::allocate( std::size_t size )
+{
+    if ( size <= sizeof( storage_ ) && !inUse_.exchange( true ) )
+    {
+        return &storage_;
+    }
+
+    return ::operator new( size );
+}
+
+
+/*!
+ * \param[in] p Pointer to memory obtained from allocate().
+ */
+void HandlerMemory::deallocate( void* p )
+{
+    if ( p == &storage_ )
+    {
+        inUse_.store( false );
+    }
+    else
+    {
+        ::operator delete( p );
+    }
+}
+
+
+}
+}
@@ -0,0 +1,137 @@
+#include <cstring>
+#include <stdexcept>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "HeadlessContext.h"
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * Surfaceless platform is preferred, the default display is used if it's
+ * not available. Framebuffer object is created later by resize() since
+ * OpenGL functions are not loaded yet.
+ * \exception std::logic_error If EGL or OpenGL context cannot be initialized.
+ */
+HeadlessContext::HeadlessContext()
+    : display_( EGL_NO_DISPLAY )
+    , context_( EGL_NO_CONTEXT )
+    , fbo_( 0 )
+    , color_( 0 )
+    , depth_( 0 )
+{
+    const char* extensions = eglQueryString( EGL_NO_DISPLAY, EGL_EXTENSIONS );
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress( "eglGetPlatformDisplayEXT" ) );
+
+    if ( extensions && std::strstr( extensions, "EGL_MESA_platform_surfaceless" ) && getPlatformDisplay )
+    {
+        display_ = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr );
+    }
+
+    if ( display_ == EGL_NO_DISPLAY )
+    {
+        display_ = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+    }
+
+    if ( display_ == EGL_NO_DISPLAY || !eglInitialize( display_, nullptr, nullptr ) )
+    {
+        throw std::logic_error( "Cannot initialize EGL display!" );
+    }
+
+    if ( !eglBindAPI( EGL_OPENGL_API ) )
+    {
+        eglTerminate( display_ );
+        throw std::logic_error( "EGL doesn't support OpenGL!" );
+    }
+
+    const EGLint attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+
+    // No config is needed since there's no surface (EGL_KHR_no_config_context)
+    context_ = eglCreateContext( display_, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs );
+
+    if ( context_ == EGL_NO_CONTEXT )
+    {
+        eglTerminate( display_ );
+        throw std::logic_error( "Cannot create headless OpenGL context!" );
+    }
+}
+
+
+/*!
+ * Objects of the context are deleted along with it.
+ */
+HeadlessContext::~HeadlessContext()
+{
+    eglMakeCurrent( display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+    eglDestroyContext( display_, context_ );
+    eglTerminate( display_ );
+}
+
+
+/*!
+ * \exception std::logic_error If the context cannot be made current.
+ */
+void HeadlessContext::makeCurrent() const
+{
+    if ( !eglMakeCurrent( display_, EGL_NO_SURFACE, EGL_NO_SURFACE, context_ ) )
+    {
+        throw std::logic_error( "Cannot make headless OpenGL context current!" );
+    }
+}
+
+
+/*!
+ * The first call creates framebuffer object and binds it, so everything
+ * rendered afterwards goes there. Storage is reallocated only if size changes.
+ * \param[in] w Width of the framebuffer (in pixels).
+ * \param[in] h Height of the framebuffer (in pixels).
+ * \exception std::logic_error If the framebuffer is incomplete.
+ */
+void HeadlessContext::resize( int w, int h )
+{
+    if ( fbo_ == 0 )
+    {
+        glGenFramebuffers( 1, &fbo_ );
+        glGenRenderbuffers( 1, &color_ );
+        glGenRenderbuffers( 1, &depth_ );
+        glBindFramebuffer( GL_FRAMEBUFFER, fbo_ );
+    }
+
+    glBindRenderbuffer( GL_RENDERBUFFER, color_ );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, w, h );
+    glBindRenderbuffer( GL_RENDERBUFFER, depth_ );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h );
+    glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_ );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_ );
+
+    if ( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+    {
+        throw std::logic_error( "Headless framebuffer is incomplete!" );
+    }
+}
+
+
+/*!
+ * Can be passed to gladLoadGLLoader.
+ * \param[in] name Name of OpenGL function.
+ * \return Address of the function, nullptr if it's not found.
+ */
+void* HeadlessContext::procAddress( const char* name )
+{
+    return reinterpret_cast<void*>( eglGetProcAddress( name ) );
+}
+
+
+}
+}
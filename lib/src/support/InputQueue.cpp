@@ -0,0 +1,125 @@
+#include "InputQueue.h"
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \return True if either panning has a non-zero element.
+ */
+bool InputQueue::Delta::moved() const
+{
+    for ( int i = 0; i < panLevels; ++i )
+    {
+        if ( moveX[i] != 0 || moveY[i] != 0 )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+InputQueue::InputQueue()
+    : zoomPosition_( 0 )
+    , takenPosition_( 0 )
+    , rotateX_( 0 )
+    , rotateY_( 0 )
+    , queued_( false )
+{
+    for ( int i = 0; i < panLevels; ++i )
+    {
+        moveX_[i].store( 0, std::memory_order_relaxed );
+        moveY_[i].store( 0, std::memory_order_relaxed );
+    }
+}
+
+
+/*!
+ * \param[in] x Offset along x axis (in pixels).
+ * \param[in] y Offset along y axis (in pixels).
+ * \return True - the queue had no input, the consumer must be notified to take it.
+ * False - the consumer has been notified already and will take the offset with earlier ones.
+ */
+bool InputQueue::move( int x, int y )
+{
+    const unsigned slot = zoomPosition_.load( std::memory_order_acquire ) % panLevels;
+    moveX_[slot].fetch_add( x, std::memory_order_relaxed );
+    moveY_[slot].fetch_add( y, std::memory_order_relaxed );
+    return notify();
+}
+
+
+/*!
+ * \param[in] steps Number of zoom steps.
+ * \return True - the consumer must be notified, false - it has been notified already.
+ */
+bool InputQueue::zoom( int steps )
+{
+    zoomPosition_.fetch_add( static_cast<unsigned>( steps ), std::memory_order_acq_rel );
+    return notify();
+}
+
+
+/*!
+ * \param[in] x Offset along x axis (in pixels).
+ * \param[in] y Offset along y axis (in pixels).
+ * \return True - the consumer must be notified, false - it has been notified already.
+ */
+bool InputQueue::rotate( int x, int y )
+{
+    rotateX_.fetch_add( x, std::memory_order_relaxed );
+    rotateY_.fetch_add( y, std::memory_order_relaxed );
+    return notify();
+}
+
+
+/*!
+ * Must be called by a single consumer thread. Input added while taking
+ * either gets into the result or stays for the next take, nothing is lost.
+ * Panning added at a zoom position read before the take but summed after it
+ * stays for the next take, which still applies it at the scale of that position.
+ * \return Sum of input since the previous take, all zeros if there was none.
+ */
+InputQueue::Delta InputQueue::take()
+{
+    // Clear the flag first: input added after that notifies the consumer again
+    queued_.exchange( false, std::memory_order_acq_rel );
+
+    const unsigned position = zoomPosition_.load( std::memory_order_acquire );
+
+    Delta res;
+    res.zoom = static_cast<int>( position - takenPosition_ );
+    res.moveX.fill( 0 );
+    res.moveY.fill( 0 );
+
+    for ( unsigned slot = 0; slot < panLevels; ++slot )
+    {
+        // Slot holds zoom positions congruent to it, the one nearest to the previous take is meant
+        int steps = static_cast<int>( ( slot - takenPosition_ ) % panLevels );
+        steps = steps < panLevels / 2 ? steps : steps - panLevels;
+        res.moveX[steps + panLevels / 2] += moveX_[slot].exchange( 0, std::memory_order_relaxed );
+        res.moveY[steps + panLevels / 2] += moveY_[slot].exchange( 0, std::memory_order_relaxed );
+    }
+
+    takenPosition_ = position;
+    res.rotateX = rotateX_.exchange( 0, std::memory_order_relaxed );
+    res.rotateY = rotateY_.exchange( 0, std::memory_order_relaxed );
+
+    return res;
+}
+
+
+/*!
+ * \return True if the queue had no input since the last notification.
+ */
+bool InputQueue::notify()
+{
+    return !queued_.exchange( true, std::memory_order_acq_rel );
+}
+
+
+}
+}
@@ -0,0 +1,174 @@
+#include <cstdio>
+#include <cstring>
+
+#include <zlib.h>
+
+#include "PngWriter.h"
+
+
+namespace {
+
+
+/*!
+ * \brief Append 32-bit number in network byte order.
+ *
+ * \param[in,out] out Buffer.
+ * \param[in] value Number.
+ */
+void putUint32( std::vector<unsigned char>& out, unsigned long value )
+{
+    out.push_back( static_cast<unsigned char>( ( value >> 24 ) & 0xff ) );
+    out.push_back( static_cast<unsigned char>( ( value >> 16 ) & 0xff ) );
+    out.push_back( static_cast<unsigned char>( ( value >> 8 ) & 0xff ) );
+    out.push_back( static_cast<unsigned char>( value & 0xff ) );
+}
+
+
+/*!
+ * \brief Finish PNG chunk which length, type and data are already in the buffer.
+ *
+ * Length is written in place and CRC of type and data is appended.
+ * \param[in,out] out Buffer.
+ * \param[in] start Position of the chunk in the buffer.
+ */
+void closeChunk( std::vector<unsigned char>& out, std::size_t start )
+{
+    const unsigned long length = static_cast<unsigned long>( out.size() - start - 8 );
+    out[start] = static_cast<unsigned char>( ( length >> 24 ) & 0xff );
+    out[start + 1] = static_cast<unsigned char>( ( length >> 16 ) & 0xff );
+    out[start + 2] = static_cast<unsigned char>( ( length >> 8 ) & 0xff );
+    out[start + 3] = static_cast<unsigned char>( length & 0xff );
+
+    const auto crc = crc32( crc32( 0L, Z_NULL, 0 ), &out[start + 4], static_cast<uInt>( length + 4 ) );
+    putUint32( out, crc );
+}
+
+
+/*!
+ * \brief Start PNG chunk with a placeholder for its length.
+ *
+ * \param[in,out] out Buffer.
+ * \param[in] type Chunk type (four letters).
+ * \return Position of the chunk in the buffer.
+ */
+std::size_t openChunk( std::vector<unsigned char>& out, const char* type )
+{
+    const std::size_t start = out.size();
+    putUint32( out, 0 );
+    out.insert( out.end(), type, type + 4 );
+
+    return start;
+}
+
+
+}
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \param[in] level Compression level from 0 (none) to 9 (best), 1 is a good trade-off for servers.
+ */
+PngWriter::PngWriter( int level )
+    : level_( level )
+{
+}
+
+
+/*!
+ * Image is written as 8-bit RGB without interlacing.
+ * \param[in] rgb Pixels row by row from the top one.
+ * \param[in] width Width of the image.
+ * \param[in] height Height of the image.
+ * \param[out] png Encoded image.
+ * \return True - image is encoded, false - image is empty or zlib failed.
+ */
+bool PngWriter::encode( const std::vector<unsigned char>& rgb, int width, int height, std::vector<unsigned char>& png )
+{
+    const std::size_t stride = static_cast<std::size_t>( width ) * 3;
+
+    if ( width <= 0 || height <= 0 || rgb.size() < stride * height )
+    {
+        return false;
+    }
+
+    filtered_.resize( ( stride + 1 ) * height );
+
+    for ( int j = 0; j < height; ++j )
+    {
+        const unsigned char* src = &rgb[stride * j];
+        unsigned char* dst = &filtered_[( stride + 1 ) * j];
+        dst[0] = 1;     // Sub: every byte minus the same byte of the pixel to the left
+        std::memcpy( dst + 1, src, 3 );
+
+        for ( std::size_t i = 3; i < stride; ++i )
+        {
+            dst[i + 1] = static_cast<unsigned char>( src[i] - src[i - 3] );
+        }
+    }
+
+    static const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    png.assign( signature, signature + sizeof( signature ) );
+
+    auto chunk = openChunk( png, "IHDR" );
+    putUint32( png, static_cast<unsigned long>( width ) );
+    putUint32( png, static_cast<unsigned long>( height ) );
+    png.push_back( 8 );     // bit depth
+    png.push_back( 2 );     // color type RGB
+    png.push_back( 0 );     // compression method
+    png.push_back( 0 );     // filter method
+    png.push_back( 0 );     // no interlacing
+    closeChunk( png, chunk );
+
+    chunk = openChunk( png, "IDAT" );
+    const std::size_t dataStart = png.size();
+    uLongf packed = compressBound( static_cast<uLong>( filtered_.size() ) );
+    png.resize( dataStart + packed );
+
+    if ( compress2( &png[dataStart], &packed, filtered_.data(), static_cast<uLong>( filtered_.size() ), level_ ) != Z_OK )
+    {
+        png.clear();
+        return false;
+    }
+
+    png.resize( dataStart + packed );
+    closeChunk( png, chunk );
+
+    chunk = openChunk( png, "IEND" );
+    closeChunk( png, chunk );
+
+    return true;
+}
+
+
+/*!
+ * \param[in] path File name.
+ * \param[in] rgb Pixels row by row from the top one.
+ * \param[in] width Width of the image.
+ * \param[in] height Height of the image.
+ * \return True - file is written, false - otherwise.
+ */
+bool PngWriter::write( const std::string& path, const std::vector<unsigned char>& rgb, int width, int height )
+{
+    if ( !encode( rgb, width, height, png_ ) )
+    {
+        return false;
+    }
+
+    FILE* file = std::fopen( path.c_str(), "wb" );
+
+    if ( !file )
+    {
+        return false;
+    }
+
+    const bool ok = std::fwrite( png_.data(), 1, png_.size(), file ) == png_.size();
+
+    return std::fclose( file ) == 0 && ok;
+}
+
+
+}
+}
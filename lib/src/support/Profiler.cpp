@@ -13,10 +13,10 @@ namespace gv {
 namespace support {
 
 
-std::map<std::string, std::pair<int, int>> Profiler::map_;
+std::map<std::string, std::pair<int, int>, std::less<>> Profiler::map_;
 
 
-Profiler::Profiler( const std::string& name, bool print, std::ostream& out )
+Profiler::Profiler( const char* name, bool print, std::ostream& out )
     : name_( name )
     , print_( print )
     , out_( out )
@@ -82,7 +82,7 @@ std::string Profiler::getStatistics()
 }
 
 
-void Profiler::addStatistic( const std::string& name, int milli )
+void Profiler::addStatistic( const char* name, int milli )
 {
     std::lock_guard<std::mutex> lock( mutexMap );
 
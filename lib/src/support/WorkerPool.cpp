@@ -0,0 +1,129 @@
+#include "WorkerPool.h"
+
+
+namespace gv {
+namespace support {
+
+
+/*!
+ * \param[in] helpers Number of threads besides the calling one.
+ */
+WorkerPool::WorkerPool( unsigned helpers )
+    : job_( nullptr )
+    , count_( 0 )
+    , next_( 0 )
+    , busy_( 0 )
+    , loop_( 0 )
+    , stop_( false )
+{
+    for ( unsigned i = 0; i < helpers; ++i )
+    {
+        threads_.emplace_back( [this]() { work(); } );
+    }
+}
+
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        stop_ = true;
+    }
+
+    wake_.notify_all();
+
+    for ( auto&& t : threads_ )
+    {
+        if ( t.joinable() )
+        {
+            t.join();
+        }
+    }
+}
+
+
+/*!
+ * Short loops are run by the calling thread alone.
+ * \param[in] count Number of iterations.
+ * \param[in] job Job taking index of an iteration.
+ */
+void WorkerPool::parallelFor( std::size_t count, const std::function<void( std::size_t )>& job )
+{
+    if ( count < 2 || threads_.empty() )
+    {
+        for ( std::size_t i = 0; i < count; ++i )
+        {
+            job( i );
+        }
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mutex_ );
+        job_ = &job;
+        count_ = count;
+        next_.store( 0 );
+        busy_ = threads_.size();
+        ++loop_;
+    }
+
+    wake_.notify_all();
+    runJobs();
+
+    std::unique_lock<std::mutex> lock( mutex_ );
+    done_.wait( lock, [this]() { return busy_ == 0; } );
+    job_ = nullptr;
+}
+
+
+/*!
+ * \return Number of helper threads plus the calling one.
+ */
+std::size_t WorkerPool::size() const
+{
+    return threads_.size() + 1;
+}
+
+
+void WorkerPool::work()
+{
+    std::uint64_t seen = 0;
+
+    for ( ;; )
+    {
+        {
+            std::unique_lock<std::mutex> lock( mutex_ );
+            wake_.wait( lock, [this, seen]() { return stop_ || loop_ != seen; } );
+
+            if ( stop_ )
+            {
+                return;
+            }
+
+            seen = loop_;
+        }
+
+        runJobs();
+
+        std::lock_guard<std::mutex> lock( mutex_ );
+
+        if ( --busy_ == 0 )
+        {
+            done_.notify_one();
+        }
+    }
+}
+
+
+void WorkerPool::runJobs()
+{
+    for ( std::size_t i = next_++; i < count_; i = next_++ )
+    {
+        ( *job_ )( i );
+    }
+}
+
+
+}
+}
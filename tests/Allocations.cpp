@@ -0,0 +1,82 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "Allocations.h"
+
+
+namespace {
+
+
+std::atomic<long> allocations( 0 );
+
+
+void* allocate( std::size_t size )
+{
+    allocations.fetch_add( 1, std::memory_order_relaxed );
+
+    void* p = std::malloc( size ? size : 1 );
+
+    if ( !p )
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+
+}
+
+
+void* operator new( std::size_t size )
+{
+    return allocate( size );
+}
+
+
+void* operator new[]( std::size_t size )
+{
+    return allocate( size );
+}
+
+
+void operator delete( void* p ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete[]( void* p ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+    std::free( p );
+}
+
+
+void operator delete[]( void* p, std::size_t ) noexcept
+{
+    std::free( p );
+}
+
+
+namespace gv {
+namespace test {
+
+
+/*!
+ * \return Allocations of all threads since the start.
+ */
+long Allocations::count()
+{
+    return allocations.load( std::memory_order_relaxed );
+}
+
+
+}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+
+namespace gv {
+namespace test {
+
+
+/*!
+ * \brief Counts heap allocations made through global operator new.
+ *
+ * Linking Allocations.cpp into a test replaces global operator new and delete,
+ * allocations of every thread are counted.
+ */
+class Allocations
+{
+public:
+    //! Number of allocations made so far.
+    static long count();
+};
+
+
+}
+}
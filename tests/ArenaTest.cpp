@@ -0,0 +1,136 @@
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "Allocations.h"
+#include "Arena.h"
+#include "Check.h"
+
+
+/*
+ * Arena hands out aligned memory not overlapping with other allocations.
+ * Release keeps a single block large enough for everything allocated
+ * before, so repeating the same allocations takes no memory from the heap.
+ */
+
+
+namespace {
+
+
+using gv::support::Arena;
+using gv::support::ArenaAllocator;
+
+
+const std::size_t alignments[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256 };
+const std::size_t sizes[] = { 1, 3, 7, 24, 100, 1000 };
+
+
+//! Allocate every size at every alignment, check alignment and that allocations don't overlap.
+void allocateAll( Arena& arena )
+{
+    // Not a vector, so checking takes nothing from the heap
+    std::pair<unsigned char*, std::size_t> blocks[sizeof( alignments ) / sizeof( *alignments ) * sizeof( sizes ) / sizeof( *sizes )];
+    std::size_t count = 0;
+    unsigned char fill = 0;
+
+    for ( std::size_t alignment : alignments )
+    {
+        for ( std::size_t size : sizes )
+        {
+            auto p = static_cast<unsigned char*>( arena.allocate( size, alignment ) );
+            GV_CHECK( reinterpret_cast<std::uintptr_t>( p ) % alignment == 0 );
+            std::memset( p, ++fill, size );
+            blocks[count++] = std::make_pair( p, size );
+        }
+    }
+
+    fill = 0;
+
+    for ( const auto& block : blocks )
+    {
+        ++fill;
+
+        for ( std::size_t i = 0; i < block.second; ++i )
+        {
+            if ( block.first[i] != fill )
+            {
+                GV_CHECK( block.first[i] == fill );
+                break;
+            }
+        }
+    }
+}
+
+
+void alignment()
+{
+    // Small first block makes allocations cross several blocks
+    Arena arena( 64 );
+    allocateAll( arena );
+    arena.release();
+    allocateAll( arena );
+}
+
+
+void release()
+{
+    Arena arena( 64 );
+    allocateAll( arena );
+
+    for ( int i = 0; i < 3; ++i )
+    {
+        arena.release();
+        const long before = gv::test::Allocations::count();
+        allocateAll( arena );
+        GV_CHECK( gv::test::Allocations::count() - before == 0 );
+    }
+
+    // Single block is kept as is
+    arena.release();
+    const long before = gv::test::Allocations::count();
+    arena.release();
+    arena.allocate( 100, 8 );
+    GV_CHECK( gv::test::Allocations::count() - before == 0 );
+}
+
+
+void allocator()
+{
+    Arena arena( 64 );
+    const auto fillVector = [&]()
+    {
+        std::vector<int, ArenaAllocator<int>> vec( &arena );
+
+        for ( int i = 0; i < 1000; ++i )
+        {
+            vec.push_back( i );
+        }
+
+        return vec.back() == 999;
+    };
+
+    GV_CHECK( fillVector() );
+    arena.release();
+    const long before = gv::test::Allocations::count();
+    GV_CHECK( fillVector() );
+    GV_CHECK( gv::test::Allocations::count() - before == 0 );
+
+    // Without arena memory comes from the heap
+    std::vector<int, ArenaAllocator<int>> heap;
+    heap.push_back( 1 );
+    GV_CHECK( gv::test::Allocations::count() - before == 1 );
+}
+
+
+}
+
+
+int main()
+{
+    alignment();
+    release();
+    allocator();
+
+    return gv::test::Check::result( "ArenaTest" );
+}
@@ -0,0 +1,99 @@
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Allocations.h"
+#include "BufferPool.h"
+#include "Check.h"
+
+
+/*
+ * BufferPool hands a buffer out again only once the last reference
+ * elsewhere is gone, whichever thread releases it, and keeps contents
+ * and capacity of the buffer, so reissuing takes no memory from the heap.
+ */
+
+
+namespace {
+
+
+using Buffer = std::vector<unsigned char>;
+using Pool = gv::support::BufferPool<Buffer>;
+
+
+void reissue()
+{
+    Pool pool( 2 );
+    auto buffer = pool.acquire();
+    buffer->assign( 1000, 7 );
+    const Buffer* raw = buffer.get();
+
+    auto consumer = buffer;
+    pool.recycle( std::move( buffer ) );
+
+    // Still referenced by the consumer
+    auto other = pool.acquire();
+    GV_CHECK( other.get() != raw );
+    pool.recycle( std::move( other ) );
+
+    consumer.reset();
+    const long before = gv::test::Allocations::count();
+    auto again = pool.acquire();
+    GV_CHECK( gv::test::Allocations::count() - before == 0 );
+    GV_CHECK( again.get() == raw );
+    GV_CHECK( again->size() == 1000 && again->capacity() >= 1000 && ( *again )[999] == 7 );
+}
+
+
+void otherThread()
+{
+    Pool pool( 2 );
+    auto buffer = pool.acquire();
+    const Buffer* raw = buffer.get();
+    auto consumer = buffer;
+    pool.recycle( std::move( buffer ) );
+
+    std::promise<void> done;
+    std::thread thread( [consumer = std::move( consumer ), ready = done.get_future()]() mutable
+        {
+            ready.wait();
+            consumer.reset();
+        } );
+
+    // The thread holds the last reference
+    auto other = pool.acquire();
+    GV_CHECK( other.get() != raw );
+    pool.recycle( std::move( other ) );
+
+    done.set_value();
+    thread.join();
+    GV_CHECK( pool.acquire().get() == raw );
+}
+
+
+void capacity()
+{
+    Pool pool( 1 );
+    auto first = pool.acquire();
+    auto second = pool.acquire();
+    const Buffer* raw = first.get();
+    pool.recycle( std::move( first ) );
+    pool.recycle( std::move( second ) );
+
+    // Only the first one is kept
+    GV_CHECK( pool.acquire().get() == raw );
+}
+
+
+}
+
+
+int main()
+{
+    reissue();
+    otherThread();
+    capacity();
+
+    return gv::test::Check::result( "BufferPoolTest" );
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <iostream>
+
+
+namespace gv {
+namespace test {
+
+
+/*!
+ * \brief Counts failed checks of a test executable.
+ *
+ * Tests are plain executables registered with CTest, a test passes
+ * if its main returns zero. Checks don't stop the test, so one run
+ * reports every failure.
+ */
+class Check
+{
+public:
+    //! Record a check, report it if it failed.
+    static bool expect( bool ok, const char* what, const char* file, int line )
+    {
+        if ( !ok )
+        {
+            ++failures();
+            std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+        }
+
+        return ok;
+    }
+
+    //! Print summary and provide exit code of the test.
+    static int result( const char* name )
+    {
+        if ( failures() )
+        {
+            std::cerr << name << ": " << failures() << " check(s) failed" << std::endl;
+            return 1;
+        }
+
+        std::cout << name << ": passed" << std::endl;
+        return 0;
+    }
+
+private:
+    //! Number of failed checks.
+    static int& failures()
+    {
+        static int count = 0;
+        return count;
+    }
+};
+
+
+}
+}
+
+
+//! Check a condition and carry on with the test whatever the outcome.
+#define GV_CHECK( condition ) ::gv::test::Check::expect( ( condition ), #condition, __FILE__, __LINE__ )
@@ -0,0 +1,55 @@
+#include "Check.h"
+#include "MapHarness.h"
+
+
+/*
+ * Tiles that arrive empty aren't requested again while the view moves
+ * over them, the map is still sent. Changing the tile server requests
+ * them anew, and once they arrive with images they stay loaded.
+ */
+
+
+namespace {
+
+
+void failed( bool gpuProjection )
+{
+    gv::test::MapHarness harness( gpuProjection );
+    auto& generator = harness.generator();
+
+    // Every tile of the new server fails
+    harness.failTiles( true );
+    harness.generate( [&]() { generator.updateTileServer( gv::TileServer::GIS ); } );
+    const long requests = harness.requests();
+
+    for ( int i = 0; i < 10; ++i )
+    {
+        harness.pan( i % 2 ? 4 : -4, 0 );
+    }
+
+    GV_CHECK( harness.requests() == requests );
+
+    // Tiles are requested from the next server
+    harness.failTiles( false );
+    harness.generate( [&]() { generator.updateTileServer( gv::TileServer::OSM ); } );
+    GV_CHECK( harness.requests() == requests + 1 );
+
+    for ( int i = 0; i < 10; ++i )
+    {
+        harness.pan( i % 2 ? 4 : -4, 0 );
+    }
+
+    GV_CHECK( harness.requests() == requests + 1 );
+}
+
+
+}
+
+
+int main()
+{
+    failed( false );
+    failed( true );
+
+    return gv::test::Check::result( "MapFailedTilesTest" );
+}
@@ -0,0 +1,222 @@
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include "Allocations.h"
+#include "Check.h"
+#include "DataKeeper.h"
+#include "MapHarness.h"
+#include "Projector.h"
+
+
+/*
+ * Handing a map over from MapGenerator to DataKeeper makes at most one
+ * allocation, the one of posting the frame to the OpenGL thread the way
+ * GlobeViewer does: MapGenerator writes texture data into the pixel buffer
+ * DataKeeper has mapped, sharing the frame copies nothing and DataKeeper
+ * keeps geometry without copying it. Panning back and forth doesn't change
+ * the tiles, so the pixel buffer keeps its size.
+ */
+
+
+namespace {
+
+
+GLuint names = 0;
+GLuint unpackBuffer = 0;
+std::vector<std::vector<unsigned char>> buffers;
+bool fromBuffer = true;
+
+
+// OpenGL with pixel buffers in memory, every transfer completes at once
+
+void APIENTRY genNames( GLsizei n, GLuint* out )
+{
+    for ( GLsizei i = 0; i < n; ++i )
+    {
+        out[i] = ++names;
+    }
+}
+
+
+void APIENTRY bindVertexArray( GLuint )
+{
+}
+
+
+void APIENTRY bindBuffer( GLenum target, GLuint buffer )
+{
+    if ( target == GL_PIXEL_UNPACK_BUFFER )
+    {
+        unpackBuffer = buffer;
+    }
+}
+
+
+void APIENTRY vertexAttribPointer( GLuint, GLint, GLenum, GLboolean, GLsizei, const void* )
+{
+}
+
+
+void APIENTRY enableVertexAttribArray( GLuint )
+{
+}
+
+
+void APIENTRY bindTexture( GLenum, GLuint )
+{
+}
+
+
+void APIENTRY texParameteri( GLenum, GLenum, GLint )
+{
+}
+
+
+void APIENTRY bufferData( GLenum target, GLsizeiptr size, const void*, GLenum )
+{
+    if ( target == GL_PIXEL_UNPACK_BUFFER )
+    {
+        if ( buffers.size() <= unpackBuffer )
+        {
+            buffers.resize( unpackBuffer + 1 );
+        }
+
+        buffers[unpackBuffer].resize( size );
+    }
+}
+
+
+void* APIENTRY mapBufferRange( GLenum, GLintptr offset, GLsizeiptr, GLbitfield )
+{
+    return buffers[unpackBuffer].data() + offset;
+}
+
+
+GLboolean APIENTRY unmapBuffer( GLenum )
+{
+    return GL_TRUE;
+}
+
+
+void APIENTRY texSubImage2D( GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void* )
+{
+    fromBuffer = fromBuffer && unpackBuffer != 0;
+}
+
+
+void APIENTRY texImage2D( GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void* )
+{
+}
+
+
+GLsync APIENTRY fenceSync( GLenum, GLbitfield )
+{
+    return reinterpret_cast<GLsync>( 1 );
+}
+
+
+void APIENTRY flush()
+{
+}
+
+
+void APIENTRY deleteSync( GLsync )
+{
+}
+
+
+GLenum APIENTRY clientWaitSync( GLsync, GLbitfield, GLuint64 )
+{
+    return GL_ALREADY_SIGNALED;
+}
+
+
+void stubOpenGL()
+{
+    glad_glGenVertexArrays = genNames;
+    glad_glGenBuffers = genNames;
+    glad_glGenTextures = genNames;
+    glad_glBindVertexArray = bindVertexArray;
+    glad_glBindBuffer = bindBuffer;
+    glad_glVertexAttribPointer = vertexAttribPointer;
+    glad_glEnableVertexAttribArray = enableVertexAttribArray;
+    glad_glBindTexture = bindTexture;
+    glad_glTexParameteri = texParameteri;
+    glad_glBufferData = bufferData;
+    glad_glMapBufferRange = mapBufferRange;
+    glad_glUnmapBuffer = unmapBuffer;
+    glad_glTexSubImage2D = texSubImage2D;
+    glad_glTexImage2D = texImage2D;
+    glad_glFenceSync = fenceSync;
+    glad_glFlush = flush;
+    glad_glDeleteSync = deleteSync;
+    glad_glClientWaitSync = clientWaitSync;
+}
+
+
+}
+
+
+int main()
+{
+    stubOpenGL();
+
+    boost::asio::io_context ioc;
+    auto projector = std::make_shared<gv::Projector>();
+    gv::DataKeeper keeper;
+    keeper.getMeterInPixel.connect( []() { return 1.0f; } );
+    keeper.getMetersAtPixel.connect( []( int, int ) { return std::make_tuple( 0.0, 0.0 ); } );
+    keeper.getProjector.connect( [&]() { return projector; } );
+    keeper.init();
+
+    gv::test::MapHarness harness( false );
+    auto& generator = harness.generator();
+
+    // The same slot as GlobeViewer has
+    generator.updateMapTexture.connect( [&]( const gv::MapFrame& frame )
+        {
+            boost::asio::post( ioc, [frame = frame.share(), &keeper]() mutable
+            {
+                keeper.updateTexture( std::move( frame ) );
+            } );
+        }, boost::signals2::at_front );
+    keeper.mapStaged.connect( [&]( gv::MapStage stage ) { generator.updateStage( stage ); } );
+
+    // The handoff starts once the map is sent
+    long sent = 0;
+    generator.updateMapTexture.connect( [&]( const gv::MapFrame& ) { sent = gv::test::Allocations::count(); },
+        boost::signals2::at_front );
+
+    // Allocations from sending the map till DataKeeper is done with it
+    const auto handOver = [&]( int x )
+    {
+        harness.pan( x, 0 );
+        ioc.restart();
+        ioc.poll();
+        return gv::test::Allocations::count() - sent;
+    };
+
+    // Warm up: the first frame maps a pixel buffer, the next ones are written into it
+    for ( int i = 0; i < 4; ++i )
+    {
+        handOver( i % 2 ? -4 : 4 );
+    }
+
+    const long requests = harness.requests();
+    const int handoffs = 100;
+    fromBuffer = true;
+
+    for ( int i = 0; i < handoffs; ++i )
+    {
+        GV_CHECK( handOver( i % 2 ? -4 : 4 ) <= 1 );
+    }
+
+    GV_CHECK( harness.requests() == requests );
+    GV_CHECK( fromBuffer );
+
+    return gv::test::Check::result( "MapHandoffTest" );
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Defines.h"
+#include "MapGenerator.h"
+#include "Projector.h"
+
+
+namespace gv {
+namespace test {
+
+
+/*!
+ * \brief MapGenerator with a tile server answering right away.
+ *
+ * Every requested tile arrives at once from the thread of MapGenerator
+ * as a plain gray image. The view of 1024x1024 pixels is centered at
+ * the projection center and shows the given map zoom level, panning moves it,
+ * rotating moves the projection center. Both wait for the new map.
+ */
+class MapHarness
+{
+public:
+    //! Connect MapGenerator and initialize it with the view.
+    explicit MapHarness( bool gpuProjection, int zoom = 6 )
+        : projector_( std::make_shared<Projector>() )
+        , tile_( "P6\n256 256\n255\n" )
+        , failing_( false )
+        , requests_( 0 )
+        , frames_( 0 )
+    {
+        tile_.resize( tile_.size() + defs::tileSide * defs::tileSide * 3, '\x80' );
+        projector_->setProjectionAt( 20.0, 40.0 );
+
+        vd_.unitInMeter = 0.001f;
+        vd_.meterInPixel = static_cast<float>( defs::earthRadius * 4 / defs::tileSide / std::pow( 2.0, zoom ) );
+        vd_.mapZoomLevel = zoom;
+        vd_.pixWidth = 1024;
+        vd_.pixHeight = 1024;
+        vd_.glX0 = -vd_.pixWidth / 2 * vd_.meterInPixel * vd_.unitInMeter;
+        vd_.glX1 = vd_.pixWidth / 2 * vd_.meterInPixel * vd_.unitInMeter;
+        vd_.glY0 = -vd_.pixHeight / 2 * vd_.meterInPixel * vd_.unitInMeter;
+        vd_.glY1 = vd_.pixHeight / 2 * vd_.meterInPixel * vd_.unitInMeter;
+
+        generator_.getProjector.connect( [this]() { return projector_; } );
+        generator_.requestTiles.connect( [this]( std::vector<TileHead> heads, TileServer )
+            {
+                ++requests_;
+                std::vector<TileImage> images;
+
+                for ( const auto& head : heads )
+                {
+                    images.emplace_back( head, TileData( failing_
+                        ? std::vector<unsigned char>()
+                        : std::vector<unsigned char>( tile_.begin(), tile_.end() ) ) );
+                }
+
+                generator_.getTiles( images );
+            } );
+        generator_.updateMapTexture.connect( [this]( const MapFrame& )
+            {
+                std::lock_guard<std::mutex> lock( mutex_ );
+                ++frames_;
+                cv_.notify_one();
+            }, boost::signals2::at_back );
+
+        generator_.init( vd_ );
+        generate( [&]() { generator_.updateGpuProjection( gpuProjection ); } );
+    }
+
+    //! Move the view by pixels and wait for the new map.
+    void pan( int x, int y )
+    {
+        const float dx = x * vd_.meterInPixel * vd_.unitInMeter;
+        const float dy = y * vd_.meterInPixel * vd_.unitInMeter;
+        vd_.glX0 += dx;
+        vd_.glX1 += dx;
+        vd_.glY0 += dy;
+        vd_.glY1 += dy;
+
+        generate( [&]() { generator_.updateViewData( vd_ ); } );
+    }
+
+    //! Move the projection center and wait for the new map.
+    void rotate( double lon, double lat )
+    {
+        projector_->setProjectionAt( lon, lat );
+        generate( [&]() { generator_.updateGlobe(); } );
+    }
+
+    //! Notify MapGenerator of a change and wait for the new map.
+    template<class Fn>
+    void generate( Fn&& notify )
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+        const long frames = frames_;
+
+        notify();
+
+        cv_.wait( lock, [&]() { return frames_ > frames; } );
+    }
+
+    //! Current view.
+    const ViewData& viewData() const
+    {
+        return vd_;
+    }
+
+    //! Projector providing the projection center.
+    const std::shared_ptr<Projector>& projector() const
+    {
+        return projector_;
+    }
+
+    //! Map generator under test.
+    MapGenerator& generator()
+    {
+        return generator_;
+    }
+
+    //! Make the tile server answer with empty tiles or with images.
+    void failTiles( bool val )
+    {
+        failing_ = val;
+    }
+
+    //! Number of times MapGenerator requested tiles.
+    long requests() const
+    {
+        return requests_;
+    }
+
+private:
+    std::shared_ptr<Projector> projector_;  //!< Fixed projection center.
+    std::string tile_;                      //!< Binary PNM image of a tile.
+    ViewData vd_;                           //!< Current view.
+    std::atomic<bool> failing_;             //!< Indicator of tiles arriving empty.
+    std::atomic<long> requests_;            //!< Number of tile requests.
+    long frames_;                           //!< Number of maps sent.
+    std::mutex mutex_;                      //!< Protects frames_.
+    std::condition_variable cv_;            //!< Notifies of a new map.
+    MapGenerator generator_;                //!< Map generator under test, destroyed first.
+};
+
+
+}
+}
@@ -0,0 +1,63 @@
+#include <algorithm>
+
+#include "Allocations.h"
+#include "Check.h"
+#include "MapHarness.h"
+
+
+/*
+ * Once the cache of tile meshes is full, rotating drops the least recently
+ * used meshes: returning to a recent projection center still takes meshes
+ * from the cache, while an old center has them tessellated anew.
+ */
+
+
+namespace {
+
+
+void leastRecent()
+{
+    gv::test::MapHarness harness( false );
+    auto& generator = harness.generator();
+
+    long sent = 0;
+    generator.updateMapTexture.connect( [&]( const gv::MapFrame& ) { sent = gv::test::Allocations::count(); },
+        boost::signals2::at_front );
+
+    // Allocations from rotating till the map is sent
+    const auto rotate = [&]( int step )
+    {
+        const long before = gv::test::Allocations::count();
+        harness.rotate( 20.0 + step * 1.0e-5, 40.0 );
+        return sent - before;
+    };
+
+    // Far more meshes than the cache keeps, a center of a few steps ago
+    // takes nothing but the new projection itself
+    const int steps = 300;
+    long recent = 0;
+
+    for ( int i = 0; i < steps; ++i )
+    {
+        rotate( i );
+
+        if ( i >= 3 )
+        {
+            recent = std::max( recent, rotate( i - 3 ) );
+        }
+    }
+
+    GV_CHECK( recent <= 1 );
+    GV_CHECK( rotate( 0 ) > 10 );
+}
+
+
+}
+
+
+int main()
+{
+    leastRecent();
+
+    return gv::test::Check::result( "MapMeshCacheTest" );
+}
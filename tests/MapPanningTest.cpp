@@ -0,0 +1,60 @@
+#include "Allocations.h"
+#include "Check.h"
+#include "MapHarness.h"
+
+
+/*
+ * Once MapGenerator has warmed up, generating the map while the view is
+ * panned without changing the tiles takes no memory from the heap, whether
+ * the map is projected on the CPU or on the GPU. The request is posted
+ * in handler memory, temporaries live in arenas, map buffers come from pools
+ * and tile meshes from the cache.
+ */
+
+
+namespace {
+
+
+void panning( bool gpuProjection )
+{
+    gv::test::MapHarness harness( gpuProjection );
+    auto& generator = harness.generator();
+
+    long sent = 0;
+    generator.updateMapTexture.connect( [&]( const gv::MapFrame& ) { sent = gv::test::Allocations::count(); },
+        boost::signals2::at_front );
+
+    // Allocations from notifying MapGenerator till the map is sent
+    const auto generate = [&]( int x, int y )
+    {
+        const long before = gv::test::Allocations::count();
+        harness.pan( x, y );
+        return sent - before;
+    };
+
+    for ( int i = 0; i < 8; ++i )
+    {
+        generate( i % 2 ? -4 : 4, i % 4 < 2 ? 2 : -2 );
+    }
+
+    const long requests = harness.requests();
+
+    for ( int i = 0; i < 100; ++i )
+    {
+        GV_CHECK( generate( i % 2 ? -4 : 4, i % 4 < 2 ? 2 : -2 ) == 0 );
+    }
+
+    GV_CHECK( harness.requests() == requests );
+}
+
+
+}
+
+
+int main()
+{
+    panning( false );
+    panning( true );
+
+    return gv::test::Check::result( "MapPanningTest" );
+}
@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <proj.h>
+
+#include "Check.h"
+#include "OrthoKernel.h"
+
+
+/*
+ * Native orthographic kernels are checked against PROJ point by point
+ * for every instruction set compiled in and supported by the processor.
+ * Besides a regular grid, points are taken just in front of and just behind
+ * the horizon and just inside and outside the outline of the Globe, where
+ * a wrong visibility decision would show.
+ */
+
+
+namespace {
+
+
+using gv::OrthoKernel;
+
+
+const double pi = 3.14159265358979323846;
+const double degToRad = pi / 180.0;
+const double semiMajor = 6378137.0;                 //!< WGS84 semi-major axis (in meters).
+const double tolerance = 1.0e-3;                    //!< Allowed error (in meters).
+const double mercatorTolerance = 1.0e-10;           //!< Allowed error of normalized Mercator coordinates.
+const double mercatorSinLimit = std::tanh( pi );    //!< Sine of latitude of Web Mercator edges.
+const double horizonGap = 1.0e-7;                   //!< Angular distance of points around the horizon (in radians).
+const double ambiguousDot = 1.0e-9;                 //!< Grid points this close to the horizon are not judged.
+
+
+//! Projection center and Earth model of a test case.
+struct Case
+{
+    double lon;
+    double lat;
+    OrthoKernel::Shape shape;
+};
+
+
+//! Geographic points with their expected visibility.
+struct GeoPoints
+{
+    std::vector<double> lon;
+    std::vector<double> lat;
+    std::vector<int> side;      //!< 1 - visible, -1 - hidden, 0 - decided by PROJ.
+};
+
+
+//! Projected points with their expected validity.
+struct PlanePoints
+{
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<int> side;      //!< 1 - inside the Globe, -1 - outside, 0 - decided by PROJ.
+};
+
+
+//! Worst errors of a test case.
+struct Errors
+{
+    double forward = 0.0;
+    double inverse = 0.0;
+    double roundTrip = 0.0;
+    double mercator = 0.0;
+};
+
+
+const char* setName( OrthoKernel::InstructionSet set )
+{
+    switch ( set )
+    {
+    case OrthoKernel::InstructionSet::Scalar:
+        return "Scalar";
+    case OrthoKernel::InstructionSet::SSE2:
+        return "SSE2";
+    case OrthoKernel::InstructionSet::AVX2:
+        return "AVX2";
+    case OrthoKernel::InstructionSet::NEON:
+        return "NEON";
+    }
+
+    return "unknown";
+}
+
+
+std::string definition( const Case& c )
+{
+    char buf[128];
+    std::snprintf( buf, sizeof( buf ), "+proj=ortho %s +lon_0=%.6f +lat_0=%.6f",
+        c.shape == OrthoKernel::Shape::Sphere ? "+R=6378137" : "+ellps=WGS84", c.lon, c.lat );
+    return buf;
+}
+
+
+//! Unit normal of the Earth surface at geographic point.
+void normal( double lon, double lat, double n[3] )
+{
+    n[0] = std::cos( lat * degToRad ) * std::cos( lon * degToRad );
+    n[1] = std::cos( lat * degToRad ) * std::sin( lon * degToRad );
+    n[2] = std::sin( lat * degToRad );
+}
+
+
+/*!
+ * Horizon is where surface normal is perpendicular to the one at projection
+ * center, for both the sphere and the ellipsoid (latitudes are geodetic).
+ */
+void horizonPoint( const Case& c, double theta, double offset, double& lon, double& lat )
+{
+    const double lam0 = c.lon * degToRad;
+    const double phi0 = c.lat * degToRad;
+    const double east[3] = { -std::sin( lam0 ), std::cos( lam0 ), 0.0 };
+    const double north[3] = { -std::sin( phi0 ) * std::cos( lam0 ), -std::sin( phi0 ) * std::sin( lam0 ), std::cos( phi0 ) };
+    double center[3];
+    normal( c.lon, c.lat, center );
+
+    double p[3];
+
+    for ( int k = 0; k < 3; ++k )
+    {
+        const double h = std::cos( theta ) * east[k] + std::sin( theta ) * north[k];
+        p[k] = std::cos( offset ) * h + std::sin( offset ) * center[k];
+    }
+
+    lon = std::atan2( p[1], p[0] ) / degToRad;
+    lat = std::asin( std::max( -1.0, std::min( 1.0, p[2] ) ) ) / degToRad;
+}
+
+
+GeoPoints geoPoints( const Case& c )
+{
+    GeoPoints pts;
+    double center[3];
+    normal( c.lon, c.lat, center );
+
+    for ( int lat = -90; lat <= 90; lat += 5 )
+    {
+        for ( int lon = -180; lon <= 180; lon += 5 )
+        {
+            double n[3];
+            normal( lon, lat, n );
+            const double dot = n[0] * center[0] + n[1] * center[1] + n[2] * center[2];
+
+            if ( std::fabs( dot ) > ambiguousDot )
+            {
+                pts.lon.push_back( lon );
+                pts.lat.push_back( lat );
+                pts.side.push_back( 0 );
+            }
+        }
+    }
+
+    for ( int i = 0; i < 360; ++i )
+    {
+        for ( int side : { 1, -1 } )
+        {
+            double lon, lat;
+            horizonPoint( c, i * degToRad, side * horizonGap, lon, lat );
+            pts.lon.push_back( lon );
+            pts.lat.push_back( lat );
+            pts.side.push_back( side );
+        }
+    }
+
+    return pts;
+}
+
+
+/*!
+ * Outline of the Globe is the projected horizon, points are placed along
+ * rays from its center just inside and just outside of it.
+ */
+PlanePoints planePoints( const Case& c, PJ* pj )
+{
+    PlanePoints pts;
+    const double extent = 1.05 * semiMajor;
+
+    for ( int j = -20; j <= 20; ++j )
+    {
+        for ( int i = -20; i <= 20; ++i )
+        {
+            pts.x.push_back( extent * i / 20 );
+            pts.y.push_back( extent * j / 20 );
+            pts.side.push_back( std::hypot( i, j ) > 20 * 1.0001 / 1.05 ? -1 : 0 );
+        }
+    }
+
+    std::vector<double> outX, outY;
+
+    for ( int i = 0; i < 360; ++i )
+    {
+        double lon, lat;
+        horizonPoint( c, i * degToRad, horizonGap, lon, lat );
+        const auto p = proj_trans( pj, PJ_FWD, proj_coord( lon * degToRad, lat * degToRad, 0.0, 0.0 ) );
+        outX.push_back( p.xy.x );
+        outY.push_back( p.xy.y );
+    }
+
+    for ( int i = 0; i < 360; ++i )
+    {
+        const double cx = ( outX[i] + outX[( i + 180 ) % 360] ) / 2;
+        const double cy = ( outY[i] + outY[( i + 180 ) % 360] ) / 2;
+
+        for ( double scale : { 0.99, 0.9999, 1.0001, 1.01 } )
+        {
+            pts.x.push_back( cx + scale * ( outX[i] - cx ) );
+            pts.y.push_back( cy + scale * ( outY[i] - cy ) );
+            pts.side.push_back( scale < 1.0 ? 1 : -1 );
+        }
+    }
+
+    return pts;
+}
+
+
+bool failed( double v )
+{
+    return v == HUGE_VAL;
+}
+
+
+double wrapDegrees( double d )
+{
+    return std::remainder( d, 360.0 );
+}
+
+
+void checkForward( const Case& c, PJ* pj, Errors& err )
+{
+    const OrthoKernel kernel( c.lon, c.lat, c.shape );
+    const GeoPoints pts = geoPoints( c );
+    const std::size_t n = pts.lon.size();
+    std::vector<double> x( n ), y( n );
+
+    const std::size_t projected = kernel.forward( pts.lon.data(), pts.lat.data(), x.data(), y.data(), n );
+    std::size_t visible = 0;
+
+    for ( std::size_t i = 0; i < n; ++i )
+    {
+        const auto ref = proj_trans( pj, PJ_FWD, proj_coord( pts.lon[i] * degToRad, pts.lat[i] * degToRad, 0.0, 0.0 ) );
+        const bool refVisible = !failed( ref.xy.x );
+        const bool gotVisible = !failed( x[i] );
+
+        GV_CHECK( failed( x[i] ) == failed( y[i] ) );
+        GV_CHECK( gotVisible == refVisible );
+
+        if ( pts.side[i] )
+        {
+            GV_CHECK( refVisible == ( pts.side[i] > 0 ) );
+        }
+
+        if ( gotVisible && refVisible )
+        {
+            err.forward = std::max( err.forward, std::hypot( x[i] - ref.xy.x, y[i] - ref.xy.y ) );
+        }
+
+        visible += gotVisible ? 1 : 0;
+    }
+
+    GV_CHECK( projected == visible );
+}
+
+
+void checkInverse( const Case& c, PJ* pj, Errors& err )
+{
+    const OrthoKernel kernel( c.lon, c.lat, c.shape );
+    const PlanePoints pts = planePoints( c, pj );
+    const std::size_t n = pts.x.size();
+    std::vector<double> lon( n ), lat( n ), mx( n ), my( n );
+
+    const std::size_t projected = kernel.inverse( pts.x.data(), pts.y.data(), lon.data(), lat.data(), n );
+    const std::size_t onMap = kernel.inverseMercator( pts.x.data(), pts.y.data(), mx.data(), my.data(), n );
+    std::size_t inside = 0;
+    std::size_t mapped = 0;
+
+    for ( std::size_t i = 0; i < n; ++i )
+    {
+        const auto ref = proj_trans( pj, PJ_INV, proj_coord( pts.x[i], pts.y[i], 0.0, 0.0 ) );
+        const bool refInside = !failed( ref.lp.lam );
+        const bool gotInside = !failed( lon[i] );
+
+        GV_CHECK( failed( lon[i] ) == failed( lat[i] ) );
+        GV_CHECK( gotInside == refInside );
+
+        if ( pts.side[i] )
+        {
+            GV_CHECK( refInside == ( pts.side[i] > 0 ) );
+        }
+
+        inside += gotInside ? 1 : 0;
+        mapped += failed( mx[i] ) ? 0 : 1;
+
+        if ( !gotInside )
+        {
+            GV_CHECK( failed( mx[i] ) && failed( my[i] ) );
+            continue;
+        }
+
+        // Near the outline geographic coordinates are ill-conditioned, so they are compared
+        // directly only well inside the Globe, and everywhere by projecting them back
+        const auto back = proj_trans( pj, PJ_FWD, proj_coord( lon[i] * degToRad, lat[i] * degToRad, 0.0, 0.0 ) );
+        err.roundTrip = std::max( err.roundTrip, std::hypot( back.xy.x - pts.x[i], back.xy.y - pts.y[i] ) );
+
+        const double refLon = ref.lp.lam / degToRad;
+        const double refLat = ref.lp.phi / degToRad;
+
+        if ( std::hypot( pts.x[i], pts.y[i] ) < 0.99 * semiMajor )
+        {
+            const double dLat = ( lat[i] - refLat ) * degToRad * semiMajor;
+            const double dLon = wrapDegrees( lon[i] - refLon ) * degToRad * semiMajor * std::cos( refLat * degToRad );
+            err.inverse = std::max( err.inverse, std::hypot( dLat, dLon ) );
+        }
+
+        const double s = std::sin( ref.lp.phi );
+
+        if ( std::fabs( std::fabs( s ) - mercatorSinLimit ) < 1.0e-12 )
+        {
+            continue;
+        }
+
+        GV_CHECK( failed( mx[i] ) == ( std::fabs( s ) > mercatorSinLimit ) );
+
+        if ( !failed( mx[i] ) )
+        {
+            const double refMx = wrapDegrees( refLon ) / 360.0 + 0.5;
+            const double refMy = 0.5 - std::log( ( 1.0 + s ) / ( 1.0 - s ) ) / ( 4.0 * pi );
+            const double dMx = std::fabs( std::remainder( mx[i] - refMx, 1.0 ) );
+            err.mercator = std::max( err.mercator, std::max( dMx, std::fabs( my[i] - refMy ) ) );
+        }
+    }
+
+    GV_CHECK( projected == inside );
+    GV_CHECK( onMap == mapped );
+}
+
+
+}
+
+
+int main()
+{
+    PJ_CONTEXT* ctx = proj_context_create();
+
+    std::vector<OrthoKernel::Shape> shapes = { OrthoKernel::Shape::Sphere };
+
+    // PROJ projects the ellipsoid only since version 7.2
+#if PROJ_VERSION_MAJOR > 7 || ( PROJ_VERSION_MAJOR == 7 && PROJ_VERSION_MINOR >= 2 )
+    shapes.push_back( OrthoKernel::Shape::Ellipsoid );
+#else
+    std::cout << "PROJ is older than 7.2, ellipsoid is not checked" << std::endl;
+#endif
+
+    const double centers[][2] = { { 0.0, 0.0 }, { 30.0, 45.0 }, { -120.0, -60.0 }, { 179.5, 10.0 }, { 0.0, 90.0 }, { 45.0, -90.0 } };
+    const auto best = OrthoKernel::best();
+
+    for ( auto set : { OrthoKernel::InstructionSet::Scalar, OrthoKernel::InstructionSet::SSE2,
+        OrthoKernel::InstructionSet::AVX2, OrthoKernel::InstructionSet::NEON } )
+    {
+        if ( !OrthoKernel::select( set ) )
+        {
+            continue;
+        }
+
+        for ( auto shape : shapes )
+        {
+            Errors err;
+
+            for ( const auto& center : centers )
+            {
+                const Case c = { center[0], center[1], shape };
+                PJ* pj = proj_create( ctx, definition( c ).c_str() );
+
+                if ( !GV_CHECK( pj != nullptr ) )
+                {
+                    continue;
+                }
+
+                checkForward( c, pj, err );
+                checkInverse( c, pj, err );
+                proj_destroy( pj );
+            }
+
+            std::printf( "%-6s %-9s forward %.2e m, inverse %.2e m, round trip %.2e m, mercator %.2e\n",
+                setName( set ), shape == OrthoKernel::Shape::Sphere ? "sphere" : "ellipsoid",
+                err.forward, err.inverse, err.roundTrip, err.mercator );
+
+            GV_CHECK( err.forward < tolerance );
+            GV_CHECK( err.inverse < tolerance );
+            GV_CHECK( err.roundTrip < tolerance );
+            GV_CHECK( err.mercator < mercatorTolerance );
+        }
+    }
+
+    OrthoKernel::select( best );
+    proj_context_destroy( ctx );
+
+    return gv::test::Check::result( "OrthoKernelTest" );
+}
@@ -0,0 +1,146 @@
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+#include "Allocations.h"
+#include "Check.h"
+#include "Projector.h"
+
+
+/*
+ * Projector gives every thread the latest projection center, taking nothing
+ * from the heap while the center stays the same, keeps projections of
+ * several Projectors apart and doesn't mistake a new Projector for
+ * a destroyed one at the same address.
+ */
+
+
+namespace {
+
+
+using gv::Projector;
+
+
+bool centeredAt( const Projector& projector, double lon, double lat )
+{
+    double centerLon;
+    double centerLat;
+    projector.projection()->projectionCenter( centerLon, centerLat );
+
+    return std::fabs( centerLon - lon ) < 1.0e-9 && std::fabs( centerLat - lat ) < 1.0e-9;
+}
+
+
+void latest()
+{
+    Projector projector;
+    projector.setProjectionAt( 10.0, 20.0 );
+    GV_CHECK( centeredAt( projector, 10.0, 20.0 ) );
+
+    const auto first = projector.projection();
+    GV_CHECK( projector.projection() == first );
+
+    const long before = gv::test::Allocations::count();
+
+    for ( int i = 0; i < 100; ++i )
+    {
+        projector.projection();
+    }
+
+    GV_CHECK( gv::test::Allocations::count() - before == 0 );
+
+    // The old projection stays as it was
+    projector.setProjectionAt( 30.0, 40.0 );
+    GV_CHECK( centeredAt( projector, 30.0, 40.0 ) );
+    GV_CHECK( projector.projection() != first );
+
+    double lon;
+    double lat;
+    first->projectionCenter( lon, lat );
+    GV_CHECK( std::fabs( lon - 10.0 ) < 1.0e-9 && std::fabs( lat - 20.0 ) < 1.0e-9 );
+}
+
+
+void severalProjectors()
+{
+    // More Projectors than a thread keeps projections of
+    Projector projectors[6];
+
+    for ( int i = 0; i < 6; ++i )
+    {
+        projectors[i].setProjectionAt( i, -i );
+    }
+
+    for ( int round = 0; round < 3; ++round )
+    {
+        for ( int i = 0; i < 6; ++i )
+        {
+            GV_CHECK( centeredAt( projectors[i], i, -i ) );
+        }
+    }
+
+    // Destroyed Projector is likely to leave its address to the next one
+    std::unique_ptr<Projector> projector( new Projector() );
+    projector->setProjectionAt( 1.0, 2.0 );
+    GV_CHECK( centeredAt( *projector, 1.0, 2.0 ) );
+
+    projector.reset();
+    projector.reset( new Projector() );
+    GV_CHECK( centeredAt( *projector, 0.0, 0.0 ) );
+}
+
+
+void otherThread()
+{
+    Projector projector;
+    std::atomic<int> published( 0 );
+    std::atomic<bool> ordered( true );
+
+    std::thread reader( [&]()
+        {
+            double last = 0.0;
+
+            while ( published.load() < 1000 )
+            {
+                double lon;
+                double lat;
+                projector.projection()->projectionCenter( lon, lat );
+
+                // Centers are set in ascending order
+                if ( lon < last )
+                {
+                    ordered = false;
+                }
+
+                last = lon;
+            }
+
+            if ( !centeredAt( projector, 100.0, 0.0 ) )
+            {
+                ordered = false;
+            }
+        } );
+
+    for ( int i = 1; i <= 1000; ++i )
+    {
+        projector.setProjectionAt( i * 0.1, 0.0 );
+        published = i;
+    }
+
+    reader.join();
+    GV_CHECK( ordered );
+}
+
+
+}
+
+
+int main()
+{
+    latest();
+    severalProjectors();
+    otherThread();
+
+    return gv::test::Check::result( "ProjectorTest" );
+}
@@ -0,0 +1,165 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "InputQueue.h"
+#include "Viewport.h"
+
+
+/*
+ * Panning and zooming merged by InputQueue and applied by Viewport::moveZoom
+ * must leave the view where applying the same events one by one leaves it,
+ * whichever order panning and zooming came in.
+ */
+
+
+namespace {
+
+
+using gv::Viewport;
+using gv::support::InputQueue;
+
+
+//! Panning (steps == 0) or zooming event.
+struct Event
+{
+    int x;
+    int y;
+    int steps;
+};
+
+
+//! Viewport has no OpenGL context here.
+void APIENTRY noViewport( GLint, GLint, GLsizei, GLsizei )
+{
+}
+
+
+//! Viewport of full HD screen zoomed in far enough from its limits.
+void prepare( Viewport& viewport )
+{
+    viewport.resize( 1920, 1080 );
+    viewport.zoom( 10 );
+}
+
+
+//! Edges differ by float rounding of panning summed in another order, far less than a pixel.
+bool close( float a, float b, float unitInPixel )
+{
+    return std::fabs( a - b ) <= 1.0e-3f * unitInPixel;
+}
+
+
+//! Compare events applied one by one with the same events merged by takes of given sizes.
+void compare( const std::vector<Event>& events, const std::vector<std::size_t>& takes )
+{
+    Viewport sequential;
+    Viewport merged;
+    prepare( sequential );
+    prepare( merged );
+    InputQueue queue;
+    std::size_t next = 0;
+
+    for ( std::size_t take : takes )
+    {
+        for ( std::size_t i = next; i < next + take && i < events.size(); ++i )
+        {
+            const auto& e = events[i];
+
+            if ( e.steps )
+            {
+                sequential.zoom( e.steps );
+                queue.zoom( e.steps );
+            }
+            else
+            {
+                sequential.move( e.x, e.y );
+                queue.move( e.x, e.y );
+            }
+        }
+
+        merged.moveZoom( queue.take() );
+        next += take;
+    }
+
+    const auto a = sequential.viewData();
+    const auto b = merged.viewData();
+
+    const float unitInPixel = a.meterInPixel * a.unitInMeter;
+
+    GV_CHECK( a.meterInPixel == b.meterInPixel );
+    GV_CHECK( a.mapZoomLevel == b.mapZoomLevel );
+    GV_CHECK( close( a.glX0, b.glX0, unitInPixel ) );
+    GV_CHECK( close( a.glX1, b.glX1, unitInPixel ) );
+    GV_CHECK( close( a.glY0, b.glY0, unitInPixel ) );
+    GV_CHECK( close( a.glY1, b.glY1, unitInPixel ) );
+}
+
+
+//! Events of random kinds with zoom staying within three steps of the start, so any two takes are less than panLevels / 2 apart.
+std::vector<Event> randomEvents( std::mt19937& rng, std::size_t count )
+{
+    std::uniform_int_distribution<int> kind( 0, 2 );
+    std::uniform_int_distribution<int> pixels( -300, 300 );
+    std::uniform_int_distribution<int> steps( -2, 2 );
+    std::vector<Event> events;
+    int zoom = 0;
+
+    while ( events.size() < count )
+    {
+        if ( kind( rng ) == 0 )
+        {
+            const int s = steps( rng );
+
+            if ( s != 0 && std::abs( zoom + s ) <= 3 )
+            {
+                zoom += s;
+                events.push_back( { 0, 0, s } );
+            }
+        }
+        else
+        {
+            events.push_back( { pixels( rng ), pixels( rng ), 0 } );
+        }
+    }
+
+    return events;
+}
+
+
+}
+
+
+int main()
+{
+    glad_glViewport = noViewport;
+
+    // Panning before zooming, after zooming and in between
+    compare( { { 100, 50, 0 }, { 0, 0, 2 } }, { 2 } );
+    compare( { { 0, 0, 2 }, { 100, 50, 0 } }, { 2 } );
+    compare( { { 0, 0, -3 }, { -80, 20, 0 } }, { 2 } );
+    compare( { { 10, 0, 0 }, { 0, 0, 1 }, { 20, 5, 0 }, { 0, 0, 1 }, { -30, 7, 0 }, { 0, 0, -3 }, { 4, 4, 0 } }, { 7 } );
+
+    // Zooming in and back out with panning at the far scale
+    compare( { { 0, 0, 5 }, { 200, -100, 0 }, { 0, 0, -5 } }, { 3 } );
+
+    std::mt19937 rng( 1 );
+    std::uniform_int_distribution<std::size_t> takeSize( 1, 8 );
+
+    for ( int n = 0; n < 200; ++n )
+    {
+        const auto events = randomEvents( rng, 24 );
+        std::vector<std::size_t> takes;
+
+        for ( std::size_t sum = 0; sum < events.size(); sum += takes.back() )
+        {
+            takes.push_back( takeSize( rng ) );
+        }
+
+        compare( events, takes );
+        compare( events, { events.size() } );
+    }
+
+    return gv::test::Check::result( "ViewportInputTest" );
+}